@@ -0,0 +1,84 @@
+#include "alert_rule.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool ar_parse(AlertRule* rule, const char* text) {
+    memset(rule, 0, sizeof(AlertRule));
+    rule->text = text;
+
+    int patternLength = 0;
+    unsigned threshold = 0;
+    unsigned window = 0;
+    char unit[16];
+    int end = 0;
+    if (sscanf(text, "%*s%n > %u in %u %15s %n", &patternLength, &threshold, &window, unit, &end) != 3 || text[end] != '\0') {
+        return false;
+    }
+    if (window == 0) {
+        return false;
+    }
+
+    if (strcmp(unit, "frames") == 0 || strcmp(unit, "frame") == 0) {
+        rule->perFrame = true;
+    }
+    else if (strcmp(unit, "lines") != 0 && strcmp(unit, "line") != 0) {
+        return false;
+    }
+
+    // %*s skipped leading spaces as well.
+    const char* pattern = text;
+    while (*pattern == ' ') {
+        ++pattern;
+    }
+    rule->pattern.txt = pattern;
+    rule->pattern.len = (uint32_t)(text + patternLength - pattern);
+    rule->threshold = threshold;
+    rule->window = window;
+    return true;
+}
+
+bool ar_update(AlertRule* rule, uint64_t step, uint32_t matches) {
+    if (rule->counts == NULL) {
+        if (matches == 0) {
+            rule->step = step;
+            return false;
+        }
+        rule->counts = (uint32_t*)calloc(rule->window, sizeof(uint32_t));
+        assert(rule->counts != NULL && "Buy more RAM lel");
+        rule->step = step;
+    }
+
+    if (step < rule->step) {
+        memset(rule->counts, 0, rule->window * sizeof(uint32_t));
+        rule->total = 0;
+    }
+    else {
+        // Steps that slide out of the window, at most all of it.
+        uint64_t expired = step - rule->step < rule->window ? step - rule->step : rule->window;
+        for (uint64_t s = step - expired + 1; s <= step; ++s) {
+            uint32_t* count = rule->counts + s % rule->window;
+            rule->total -= *count;
+            *count = 0;
+        }
+    }
+    rule->step = step;
+
+    rule->counts[step % rule->window] += matches;
+    rule->total += matches;
+
+    bool above = rule->total > rule->threshold;
+    bool fires = above && !rule->firing;
+    rule->firing = above;
+    return fires;
+}
+
+void ar_reset(AlertRule* rule) {
+    free(rule->counts);
+    rule->counts = NULL;
+    rule->step = 0;
+    rule->total = 0;
+    rule->firing = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "dynamic_array.h"
+
+// Rule that fires when a text shows up too often, e.g. "OutOfMemory > 50 in 1000 frames".
+// Matches are counted in a sliding window of the last `window` lines or frames: a ring with one counter
+// per step and their running total, so every line costs O(1) (amortized when steps are skipped).
+// A rule fires when the total goes above the threshold and can fire again once it dropped back to it.
+
+typedef struct {
+    // Rule as given on the command line.
+    const char* text;
+    StrView pattern;
+    uint32_t threshold;
+    uint32_t window;
+    // Steps are frames instead of lines.
+    bool perFrame;
+
+    // Matches per step, counts[step % window], allocated with the first match.
+    uint32_t* counts;
+    // Latest step seen, the window covers (step - window, step].
+    uint64_t step;
+    uint32_t total;
+    bool firing;
+} AlertRule;
+
+DEFINE_DYNAMIC_ARRAY(AlertRules, AlertRule)
+
+// Parses "<pattern> > <threshold> in <window> lines|frames", returns false if text does not have that form.
+// The pattern cannot contain spaces, rule->pattern points into text.
+bool ar_parse(AlertRule* rule, const char* text);
+
+// Moves the window to step (steps only grow, a smaller step starts over) and adds the matches of that step.
+// Returns true if the rule starts firing.
+bool ar_update(AlertRule* rule, uint64_t step, uint32_t matches);
+
+// Clears the window and frees the counters, the rule itself is kept.
+void ar_reset(AlertRule* rule);
@@ -1,8 +1,10 @@
 #include "app_interface.h"
 
+#include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "util.h"
 #include "dynamic_array.h"
@@ -15,6 +17,8 @@
 #define SPLITTER_SIZE 10.f
 #define SPLIT_MIN_CONTENT_SIZE 100.f
 
+#define APP_MAX_SHOWN_HITCHES 100
+
 // NOTE: The memory for the state is automatically allocated.
 // To ensure compatibility between States when hot-reloading,
 // ONLY EVER add stuff to the end of this struct (it is allowed to grow).
@@ -29,6 +33,52 @@ typedef struct {
 
     BuschlaFile* buschlaFile;
 
+    // Bit i is set if log lines with LogLevel i are hidden.
+    uint32_t levelHiddenMask;
+    // The levelHiddenMask that filteredLines was built for.
+    uint32_t filteredLevelHiddenMask;
+    // Indices of the visible log lines, NULL if no line is hidden.
+    uint32_t* filteredLines;
+    uint32_t filteredLineCount;
+
+    uint32_t selectedLine;
+    bool scrollToSelectedLine;
+
+    // 0 shows all channels, otherwise only lines of channel id (channelFilter - 1) are shown.
+    uint32_t channelFilter;
+    // The channelFilter that filteredLines was built for.
+    uint32_t filteredChannelFilter;
+
+    // Only lines containing searchText are shown (if it is not empty).
+    char searchText[256];
+    // The searchText that searchLines/filteredLines were built for.
+    char searchedText[256];
+    // Indices of all lines containing searchedText, sorted.
+    Uint32s searchLines;
+
+    // Scopes containing selectedLine, innermost first.
+    Uint32s selectedScopes;
+
+    // Latest sample of each key at selectedLine, see buschlaValuesAt.
+    Uint32s selectedSamples;
+
+    // Lines selected with shift-click or by clicking a scope, rangeLineCount is 0 if there are none.
+    uint32_t rangeFirstLine;
+    uint32_t rangeLineCount;
+
+    // 0 shows all lines, otherwise only lines where field (fieldFilter - 1) has the value with code fieldFilterCode.
+    uint32_t fieldFilter;
+    uint32_t fieldFilterCode;
+    // The fieldFilter/fieldFilterCode that filteredLines was built for.
+    uint32_t filteredFieldFilter;
+    uint32_t filteredFieldFilterCode;
+
+    // 0 shows all lines, otherwise only lines mentioning entity (entityFilter - 1).
+    // Field and entity filter exclude each other.
+    uint32_t entityFilter;
+    // The entityFilter that filteredLines was built for.
+    uint32_t filteredEntityFilter;
+
 } State;
 
 // TODO: RIGHT CLICK => reset split!
@@ -77,6 +127,360 @@ struct ScopedStyleVar {
 
 char filePath[PATH_MAX];
 
+// Returns index of first item >= value.
+static uint32_t lowerBound(const uint32_t* items, uint32_t count, uint32_t value) {
+    uint32_t first = 0;
+    while (count > 0) {
+        uint32_t step = count / 2;
+        if (items[first + step] < value) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+static uint32_t levelLineCount(BuschlaFile* file, int level) {
+    if (level == LOG_LEVEL_NONE) {
+        uint32_t count = buschlaLineCount(file);
+        for (int i = 1; i < LOG_LEVEL_COUNT; ++i) {
+            count -= file->levelRanges[i].count;
+        }
+        return count;
+    }
+
+    return file->levelRanges[level].count;
+}
+
+// Applies the level, channel and search filter to a line of a sorted candidate list (field or entity postings).
+// searchIndex walks through the search result along with the candidates, start it at 0.
+static bool isCandidateLineHidden(State* state, uint32_t line, uint32_t* searchIndex) {
+    BuschlaFile* file = state->buschlaFile;
+    if (state->levelHiddenMask & (1 << file->levels[line])) {
+        return true;
+    }
+    if (state->channelFilter != 0 && file->lineChannels[line] != (uint16_t)(state->channelFilter - 1)) {
+        return true;
+    }
+    if (state->searchedText[0] != '\0') {
+        while (*searchIndex < state->searchLines.count && state->searchLines.items[*searchIndex] < line) {
+            ++*searchIndex;
+        }
+        return *searchIndex == state->searchLines.count || state->searchLines.items[*searchIndex] != line;
+    }
+    return false;
+}
+
+static void updateLineFilter(State* state) {
+    bool searchChanged = strcmp(state->searchText, state->searchedText) != 0;
+    if (state->levelHiddenMask == state->filteredLevelHiddenMask &&
+        state->channelFilter == state->filteredChannelFilter &&
+        state->fieldFilter == state->filteredFieldFilter &&
+        state->fieldFilterCode == state->filteredFieldFilterCode &&
+        state->entityFilter == state->filteredEntityFilter &&
+        !searchChanged) {
+        return;
+    }
+
+    BuschlaFile* file = state->buschlaFile;
+    free(state->filteredLines);
+    state->filteredLines = NULL;
+    state->filteredLineCount = 0;
+    state->filteredLevelHiddenMask = state->levelHiddenMask;
+    state->filteredChannelFilter = state->channelFilter;
+    state->filteredFieldFilter = state->fieldFilter;
+    state->filteredFieldFilterCode = state->fieldFilterCode;
+    state->filteredEntityFilter = state->entityFilter;
+
+    if (searchChanged) {
+        memcpy(state->searchedText, state->searchText, sizeof(state->searchText));
+        state->searchLines.count = 0;
+        if (state->searchedText[0] != '\0') {
+            StrView needle;
+            needle.txt = state->searchedText;
+            needle.len = strlen(state->searchedText);
+            TIME_SCOPE(searchTimer) {
+                buschlaFindLines(file, needle, &state->searchLines);
+            }
+            printf("[APP] Search for '%s' found %u lines in %.3fms\n", state->searchedText, state->searchLines.count, searchTimer.elapsedMs);
+        }
+    }
+
+    bool searching = state->searchedText[0] != '\0';
+    if (state->levelHiddenMask == 0 && state->channelFilter == 0 && state->fieldFilter == 0 && state->entityFilter == 0 && !searching) {
+        return;
+    }
+
+    uint32_t logLineCount = buschlaLineCount(file);
+    state->filteredLines = (uint32_t*)malloc(logLineCount * sizeof(uint32_t) + 1);
+    assert(state->filteredLines != NULL);
+
+    // Only the field's samples can match, compare their codes instead of the strings.
+    if (state->fieldFilter != 0) {
+        const BuschlaField* field = file->fields + state->fieldFilter - 1;
+        const uint32_t* fieldLines = file->fieldLines + field->samples.first;
+        uint32_t searchIndex = 0;
+        uint32_t lastLine = UINT32_MAX;
+        for (uint32_t s = 0; s < field->samples.count; ++s) {
+            uint32_t i = fieldLines[s];
+            // A line can have the same field more than once.
+            if (i == lastLine || buschlaFieldCode(file->fieldCodes, field, s) != state->fieldFilterCode) {
+                continue;
+            }
+            if (isCandidateLineHidden(state, i, &searchIndex)) {
+                continue;
+            }
+            state->filteredLines[state->filteredLineCount++] = i;
+            lastLine = i;
+        }
+        return;
+    }
+
+    // Only the entity's postings can match.
+    if (state->entityFilter != 0) {
+        BuschlaRange lines = file->entities[state->entityFilter - 1].lines;
+        uint32_t searchIndex = 0;
+        for (uint32_t s = 0; s < lines.count; ++s) {
+            uint32_t i = file->entityLines[lines.first + s];
+            if (!isCandidateLineHidden(state, i, &searchIndex)) {
+                state->filteredLines[state->filteredLineCount++] = i;
+            }
+        }
+        return;
+    }
+
+    // The search result is usually small, only check those lines.
+    if (searching) {
+        uint16_t channel = (uint16_t)(state->channelFilter - 1);
+        for (uint32_t s = 0; s < state->searchLines.count; ++s) {
+            uint32_t i = state->searchLines.items[s];
+            if (state->levelHiddenMask & (1 << file->levels[i])) {
+                continue;
+            }
+            if (state->channelFilter != 0 && file->lineChannels[i] != channel) {
+                continue;
+            }
+            state->filteredLines[state->filteredLineCount++] = i;
+        }
+        return;
+    }
+
+    // Lines without a level are not part of the level index and channels have no line index,
+    // so we have to look at the level/channel columns of every line.
+    if (!(state->levelHiddenMask & (1 << LOG_LEVEL_NONE)) || state->channelFilter != 0) {
+        uint16_t channel = (uint16_t)(state->channelFilter - 1);
+        for (uint32_t i = 0; i < logLineCount; ++i) {
+            if (state->levelHiddenMask & (1 << file->levels[i])) {
+                continue;
+            }
+            if (state->channelFilter != 0 && file->lineChannels[i] != channel) {
+                continue;
+            }
+            state->filteredLines[state->filteredLineCount++] = i;
+        }
+        return;
+    }
+
+    // Otherwise merge the sorted line lists of all visible levels.
+    uint32_t heads[LOG_LEVEL_COUNT];
+    memset(heads, 0, sizeof(heads));
+    while (true) {
+        int minLevel = -1;
+        uint32_t minLine = 0;
+        for (int level = 1; level < LOG_LEVEL_COUNT; ++level) {
+            BuschlaRange range = file->levelRanges[level];
+            if ((state->levelHiddenMask & (1 << level)) || heads[level] >= range.count) {
+                continue;
+            }
+
+            uint32_t line = file->levelLines[range.first + heads[level]];
+            if (minLevel < 0 || line < minLine) {
+                minLevel = level;
+                minLine = line;
+            }
+        }
+
+        if (minLevel < 0) {
+            break;
+        }
+
+        state->filteredLines[state->filteredLineCount++] = minLine;
+        ++heads[minLevel];
+    }
+}
+
+// Returns true if a line was found.
+static bool findNextLineWithLevel(BuschlaFile* file, int minLevel, uint32_t afterLine, uint32_t* lineOut) {
+    bool found = false;
+    for (int level = minLevel; level < LOG_LEVEL_COUNT; ++level) {
+        BuschlaRange range = file->levelRanges[level];
+        const uint32_t* lines = file->levelLines + range.first;
+        uint32_t index = lowerBound(lines, range.count, afterLine + 1);
+        if (index < range.count && (!found || lines[index] < *lineOut)) {
+            *lineOut = lines[index];
+            found = true;
+        }
+    }
+    return found;
+}
+
+static ImVec4 logLevelColor(uint8_t level) {
+    switch (level) {
+    case LOG_LEVEL_TRACE:
+    case LOG_LEVEL_DEBUG:
+        return ImVec4(.5f, .5f, .5f, 1.f);
+    case LOG_LEVEL_WARNING:
+        return (ImVec4)ImColor::HSV(55.f / 360.f, .83f, .83f);
+    case LOG_LEVEL_ERROR:
+    case LOG_LEVEL_FATAL:
+        return (ImVec4)ImColor::HSV(4.f / 360.f, .83f, .83f);
+    }
+    return ImGui::GetStyle().Colors[ImGuiCol_Text];
+}
+
+static void entitySelectable(State* state, const BuschlaEntity* entity) {
+    BuschlaFile* file = state->buschlaFile;
+    uint32_t entityIndex = (uint32_t)(entity - file->entities);
+    bool filtered = state->entityFilter == entityIndex + 1;
+    const char* label = tmpf("%s (%u lines)##entity%u", buschlaString(file, entity->name), entity->lines.count, entityIndex);
+    if (ImGui::Selectable(label, filtered)) {
+        state->entityFilter = filtered ? 0 : entityIndex + 1;
+        state->fieldFilter = 0;
+    }
+}
+
+// Offers the entities of the selected line (hex values) and the one named by the search text as filters.
+static void drawEntityFilter(State* state) {
+    BuschlaFile* file = state->buschlaFile;
+    ImGui::SeparatorText("Entities");
+
+    const BuschlaEntity* filtered = state->entityFilter != 0 ? file->entities + state->entityFilter - 1 : NULL;
+    if (filtered != NULL) {
+        entitySelectable(state, filtered);
+    }
+
+    StrView searchText = { state->searchedText, (uint32_t)strlen(state->searchedText) };
+    const BuschlaEntity* searched = searchText.len > 0 ? buschlaFindEntity(file, searchText) : NULL;
+    if (searched != NULL && searched != filtered) {
+        entitySelectable(state, searched);
+    }
+
+    if (state->selectedLine >= buschlaLineCount(file)) {
+        return;
+    }
+    // Entity names of hex values are lower case.
+    StrView line = buschlaLine(file, state->selectedLine);
+    char name[128];
+    for (uint32_t i = 0; i + 2 < line.len; ++i) {
+        bool wordStart = i == 0 || !(isLetter(line.txt[i - 1]) || isDigit(line.txt[i - 1]));
+        if (!wordStart || line.txt[i] != '0' || line.txt[i + 1] != 'x' || !isHexDigit(line.txt[i + 2])) {
+            continue;
+        }
+
+        uint32_t length = 2;
+        while (i + length < line.len && isHexDigit(line.txt[i + length]) && length < sizeof(name)) {
+            char c = line.txt[i + length];
+            name[length] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+            ++length;
+        }
+        name[0] = '0';
+        name[1] = 'x';
+        StrView hex = { name, length };
+        const BuschlaEntity* entity = buschlaFindEntity(file, hex);
+        if (entity != NULL && entity != searched && entity != filtered) {
+            entitySelectable(state, entity);
+        }
+        i += length - 1;
+    }
+}
+
+// Draws all scopes as a flame graph, x is the line index and y the nesting depth.
+// Above it the scopes containing the selected line, clicking a scope selects its first line.
+static void drawScopeTimeline(State* state) {
+    BuschlaFile* file = state->buschlaFile;
+    uint32_t scopeCount = file->header->sections[SECTION_SCOPES].count;
+    uint32_t lineCount = buschlaLineCount(file);
+
+    state->selectedScopes.count = 0;
+    buschlaScopesAt(file, state->selectedLine, &state->selectedScopes);
+    for (uint32_t i = state->selectedScopes.count; i > 0; --i) {
+        BuschlaScope* scope = file->scopes + state->selectedScopes.items[i - 1];
+        ImGui::PushID((int)state->selectedScopes.items[i - 1]);
+        if (ImGui::SmallButton(buschlaString(file, scope->name))) {
+            state->selectedLine = scope->firstLine;
+            state->scrollToSelectedLine = true;
+        }
+        ImGui::PopID();
+        ImGui::SameLine(0.f, 4.f);
+        if (i > 1) {
+            ImGui::TextDisabled(">");
+            ImGui::SameLine(0.f, 4.f);
+        }
+    }
+    ImGui::NewLine();
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    if (size.x <= 0.f || size.y <= 0.f || lineCount == 0) {
+        return;
+    }
+    ImGui::InvisibleButton("##scope_timeline", size);
+    bool clicked = ImGui::IsItemClicked();
+    bool hovered = ImGui::IsItemHovered();
+    ImVec2 mouse = ImGui::GetMousePos();
+
+    float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    float lineWidth = size.x / lineCount;
+    drawList->PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+    for (uint32_t i = 0; i < scopeCount; ++i) {
+        BuschlaScope* scope = file->scopes + i;
+        ImVec2 min(origin.x + scope->firstLine * lineWidth, origin.y + scope->depth * rowHeight);
+        ImVec2 max(origin.x + (scope->lastLine + 1) * lineWidth, min.y + rowHeight - 1.f);
+        if (min.y > origin.y + size.y) {
+            continue;
+        }
+        // Scopes narrower than a pixel are still drawn.
+        if (max.x - min.x < 1.f) {
+            max.x = min.x + 1.f;
+        }
+
+        bool selected = scope->firstLine <= state->selectedLine && state->selectedLine <= scope->lastLine;
+        bool mouseOver = hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y;
+        const char* name = buschlaString(file, scope->name);
+        // Color from the name, so the same scope looks the same everywhere.
+        uint32_t hue = (uint32_t)hashBytes(name, scope->name.len);
+        ImVec4 color = ImColor::HSV((hue % 360) / 360.f, selected ? .7f : .45f, mouseOver ? 1.f : .8f);
+        drawList->AddRectFilled(min, max, ImGui::ColorConvertFloat4ToU32(color));
+        if (max.x - min.x > ImGui::CalcTextSize(name).x + 4.f) {
+            drawList->AddText(ImVec2(min.x + 2.f, min.y), IM_COL32_BLACK, name);
+        }
+
+        if (mouseOver) {
+            if (scope->duration == scope->duration) {
+                ImGui::SetTooltip("%s\nlines %u to %u\n%g ms", name, scope->firstLine + 1, scope->lastLine + 1, scope->duration);
+            }
+            else {
+                ImGui::SetTooltip("%s\nlines %u to %u", name, scope->firstLine + 1, scope->lastLine + 1);
+            }
+            if (clicked) {
+                state->selectedLine = scope->firstLine;
+                state->scrollToSelectedLine = true;
+                state->rangeFirstLine = scope->firstLine;
+                state->rangeLineCount = scope->lastLine - scope->firstLine + 1;
+            }
+        }
+    }
+
+    // Marker for the selected line.
+    float selectedX = origin.x + (state->selectedLine + .5f) * lineWidth;
+    drawList->AddLine(ImVec2(selectedX, origin.y), ImVec2(selectedX, origin.y + size.y), IM_COL32_WHITE);
+    drawList->PopClipRect();
+}
+
 static void gui(AppState* appState, State* state) {
     if (ImGui::BeginMainMenuBar()) {
         // if (ImGui::BeginMenu("File")) {
@@ -147,18 +551,57 @@ static void gui(AppState* appState, State* state) {
             0, ImGuiWindowFlags_HorizontalScrollbar);
         {
             if (state->buschlaFile != NULL) {
-                uint32_t logLineCount = state->buschlaFile->header->logLineCount;
-                for (uint32_t i = 0; i < logLineCount; ++i) {
-                    ImGui::PushID(i);
-
-                    LogLine* logLine = state->buschlaFile->logLines + i;
-                    // TODO: determine width of line num with line count!
-                    ImGui::Text("%6d", logLine->lineNum);
-                    ImGui::SameLine(0.f, 4.f);
-                    const char* txt = logLine->str.txt;
-                    ImGui::TextEx(txt, txt + logLine->str.len);
-
-                    ImGui::PopID();
+                BuschlaFile* file = state->buschlaFile;
+                updateLineFilter(state);
+
+                uint32_t rowCount = state->filteredLines != NULL ? state->filteredLineCount : buschlaLineCount(file);
+                float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+
+                if (state->scrollToSelectedLine) {
+                    uint32_t row = state->selectedLine;
+                    if (state->filteredLines != NULL) {
+                        row = lowerBound(state->filteredLines, state->filteredLineCount, state->selectedLine);
+                    }
+                    ImGui::SetScrollY(row * rowHeight - ImGui::GetWindowHeight() * .5f);
+                    state->scrollToSelectedLine = false;
+                }
+
+                ImGuiListClipper clipper;
+                clipper.Begin((int)rowCount, rowHeight);
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                        uint32_t i = state->filteredLines != NULL ? state->filteredLines[row] : (uint32_t)row;
+                        ImGui::PushID(i);
+
+                        // Merged logs: line numbers count the lines of each input.
+                        const BuschlaSource* lineSource = buschlaLineSource(file, i);
+                        if (lineSource != NULL) {
+                            const char* source = buschlaString(file, lineSource->name);
+                            const char* slash = strrchr(source, '/');
+                            ImGui::TextDisabled("%s", slash != NULL ? slash + 1 : source);
+                            ImGui::SameLine(0.f, 4.f);
+                        }
+                        // TODO: determine width of line num with line count!
+                        ImGui::Text("%6u", buschlaLineNumber(file, i));
+                        ImGui::SameLine(0.f, 4.f);
+                        ImVec4 col = (i == state->selectedLine) ? ImVec4(1.f, 1.f, 1.f, 1.f) : logLevelColor(file->levels[i]);
+                        ImGui::PushStyleColor(ImGuiCol_Text, col);
+                        StrView txt = buschlaLine(file, i);
+                        ImGui::TextEx(txt.txt, txt.txt + txt.len);
+                        ImGui::PopStyleColor();
+                        if (ImGui::IsItemClicked()) {
+                            if (ImGui::GetIO().KeyShift) {
+                                state->rangeFirstLine = state->selectedLine < i ? state->selectedLine : i;
+                                state->rangeLineCount = (state->selectedLine < i ? i - state->selectedLine : state->selectedLine - i) + 1;
+                            }
+                            else {
+                                state->rangeLineCount = 0;
+                            }
+                            state->selectedLine = i;
+                        }
+
+                        ImGui::PopID();
+                    }
                 }
             }
         }
@@ -167,7 +610,10 @@ static void gui(AppState* appState, State* state) {
         splitter("##region_left_splitter_v", &state->ySplitLeft, false);
 
         ImGui::BeginChild("region_left_bot", ImVec2(widthLeft, 0));
-        {
+        if (state->buschlaFile != NULL && state->buschlaFile->header->sections[SECTION_SCOPES].count > 0) {
+            drawScopeTimeline(state);
+        }
+        else {
             static float xs1[1001], ys1[1001];
             for (int i = 0; i < 1001; ++i) {
                 xs1[i] = i * 0.001f;
@@ -219,6 +665,100 @@ static void gui(AppState* appState, State* state) {
 
             ImGui::Text("Top Right");
 
+            if (state->buschlaFile != NULL) {
+                BuschlaFile* file = state->buschlaFile;
+
+                ImGui::SeparatorText("Levels");
+                for (int level = LOG_LEVEL_COUNT - 1; level >= 0; --level) {
+                    // Strip the "LOG_LEVEL_" prefix.
+                    const char* name = logLevelStrs[level] + 10;
+                    bool visible = !(state->levelHiddenMask & (1 << level));
+                    if (ImGui::Checkbox(tmpf("%s (%u)", name, levelLineCount(file, level)), &visible)) {
+                        state->levelHiddenMask ^= 1 << level;
+                    }
+                }
+
+                if (ImGui::Button("Next Error")) {
+                    uint32_t line;
+                    if (findNextLineWithLevel(file, LOG_LEVEL_ERROR, state->selectedLine, &line)) {
+                        state->selectedLine = line;
+                        state->scrollToSelectedLine = true;
+                    }
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Errors Only")) {
+                    state->levelHiddenMask = ~((1u << LOG_LEVEL_ERROR) | (1u << LOG_LEVEL_FATAL)) & ((1u << LOG_LEVEL_COUNT) - 1);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("All")) {
+                    state->levelHiddenMask = 0;
+                }
+
+                ImGui::SeparatorText("Search");
+                ImGui::InputText("##search", state->searchText, sizeof(state->searchText));
+                if (state->searchedText[0] != '\0') {
+                    ImGui::Text("%u lines", state->searchLines.count);
+                }
+
+                uint32_t channelCount = file->header->sections[SECTION_CHANNELS].count;
+                if (channelCount > 0) {
+                    ImGui::SeparatorText("Channels");
+
+                    const char* preview = "All";
+                    if (state->channelFilter != 0) {
+                        preview = buschlaString(file, file->channels[state->channelFilter - 1].name);
+                    }
+
+                    if (ImGui::BeginCombo("##channel", preview)) {
+                        if (ImGui::Selectable("All", state->channelFilter == 0)) {
+                            state->channelFilter = 0;
+                        }
+                        for (uint32_t i = 0; i < channelCount; ++i) {
+                            BuschlaChannel* channel = file->channels + i;
+                            const char* label = tmpf("%s (%u)##%u", buschlaString(file, channel->name), channel->lineCount, i);
+                            if (ImGui::Selectable(label, state->channelFilter == i + 1)) {
+                                state->channelFilter = i + 1;
+                            }
+                        }
+                        ImGui::EndCombo();
+                    }
+                }
+
+                uint32_t fieldCount = file->header->sections[SECTION_FIELDS].count;
+                if (fieldCount > 0) {
+                    ImGui::SeparatorText("Fields");
+                    for (uint32_t i = 0; i < fieldCount; ++i) {
+                        const BuschlaField* field = file->fields + i;
+                        const BuschlaFieldValue* values = file->fieldValues + field->values.first;
+                        bool filtered = state->fieldFilter == i + 1;
+
+                        const char* preview = filtered ? buschlaString(file, values[state->fieldFilterCode].str) : "All";
+                        ImGui::PushID((int)i);
+                        if (ImGui::BeginCombo(buschlaString(file, field->name), preview)) {
+                            if (ImGui::Selectable("All", !filtered)) {
+                                if (filtered) {
+                                    state->fieldFilter = 0;
+                                }
+                            }
+                            for (uint32_t code = 0; code < field->values.count; ++code) {
+                                const char* label = tmpf("%s (%u)##%u", buschlaString(file, values[code].str), values[code].count, code);
+                                if (ImGui::Selectable(label, filtered && state->fieldFilterCode == code)) {
+                                    state->fieldFilter = i + 1;
+                                    state->fieldFilterCode = code;
+                                    state->entityFilter = 0;
+                                }
+                            }
+                            ImGui::EndCombo();
+                        }
+                        ImGui::PopID();
+                    }
+                }
+
+                if (file->header->sections[SECTION_ENTITIES].count > 0) {
+                    drawEntityFilter(state);
+                }
+            }
+
         }
         ImGui::EndChild();
 
@@ -226,7 +766,157 @@ static void gui(AppState* appState, State* state) {
 
         ImGui::BeginChild("region_right_bot", ImVec2(0, 0));
         {
-            ImGui::Text("Bot Right");
+            SCOPE_STYLE2(ImGuiStyleVar_ItemSpacing, 5.f, 5.f);
+
+            if (state->buschlaFile != NULL) {
+                BuschlaFile* file = state->buschlaFile;
+
+                // Statistics come from the stored sketches, the samples are not touched.
+                uint32_t keyStatCount = file->header->sections[SECTION_KEY_STATS].count;
+                ImGui::SeparatorText(tmpf("Values (%u)", keyStatCount));
+                ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ScrollX;
+                if (keyStatCount > 0 && ImGui::BeginTable("##key_stats", 9, tableFlags)) {
+                    const char* columnNames[] = { "key", "count", "min", "max", "mean", "stddev", "p50", "p95", "p99" };
+                    for (size_t i = 0; i < ARRAY_SIZE(columnNames); ++i) {
+                        ImGui::TableSetupColumn(columnNames[i]);
+                    }
+                    ImGui::TableHeadersRow();
+
+                    for (uint32_t i = 0; i < keyStatCount; ++i) {
+                        BuschlaKeyStats* stats = file->keyStats + i;
+                        double stddev = stats->count > 0 ? sqrt(stats->m2 / stats->count) : 0.0;
+                        double columns[] = {
+                            stats->min, stats->max, stats->mean, stddev,
+                            buschlaKeyPercentile(file, i, 0.50),
+                            buschlaKeyPercentile(file, i, 0.95),
+                            buschlaKeyPercentile(file, i, 0.99),
+                        };
+
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(buschlaString(file, file->keys[i].name));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%u", stats->count);
+                        for (size_t c = 0; c < ARRAY_SIZE(columns); ++c) {
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%g", columns[c]);
+                        }
+                    }
+                    ImGui::EndTable();
+                }
+
+                // Latest value of every key when the selected line was written.
+                uint32_t keyCount = file->header->sections[SECTION_KEYS].count;
+                if (keyCount > 0) {
+                    da_reserve(&state->selectedSamples, keyCount);
+                    uint32_t* samples = state->selectedSamples.items;
+                    uint32_t foundCount = buschlaValuesAt(file, state->selectedLine, samples);
+                    ImGui::SeparatorText(tmpf("State at line %u (%u)", state->selectedLine + 1, foundCount));
+                    if (foundCount > 0 && ImGui::BeginTable("##line_state", 3, tableFlags)) {
+                        ImGui::TableSetupColumn("key");
+                        ImGui::TableSetupColumn("value");
+                        ImGui::TableSetupColumn("line");
+                        ImGui::TableHeadersRow();
+
+                        for (uint32_t i = 0; i < keyCount; ++i) {
+                            if (samples[i] == BUSCHLA_SAMPLE_NONE) {
+                                continue;
+                            }
+                            uint32_t line = file->valueLines[samples[i]];
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(buschlaString(file, file->keys[i].name));
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%g", file->values[samples[i]]);
+                            ImGui::TableNextColumn();
+                            ImGui::PushID((int)i);
+                            if (ImGui::Selectable(tmpf("%u", line + 1), line == state->selectedLine)) {
+                                state->selectedLine = line;
+                                state->scrollToSelectedLine = true;
+                            }
+                            ImGui::PopID();
+                        }
+                        ImGui::EndTable();
+                    }
+                }
+
+                // Statistics of the selected range come from the segment trees, not a scan of the samples.
+                if (keyCount > 0 && state->rangeLineCount > 0) {
+                    uint32_t rangeLastLine = state->rangeFirstLine + state->rangeLineCount - 1;
+                    ImGui::SeparatorText(tmpf("Lines %u to %u", state->rangeFirstLine + 1, rangeLastLine + 1));
+                    if (ImGui::BeginTable("##range_stats", 6, tableFlags)) {
+                        const char* columnNames[] = { "key", "count", "min", "max", "sum", "mean" };
+                        for (size_t i = 0; i < ARRAY_SIZE(columnNames); ++i) {
+                            ImGui::TableSetupColumn(columnNames[i]);
+                        }
+                        ImGui::TableHeadersRow();
+
+                        for (uint32_t i = 0; i < keyCount; ++i) {
+                            BuschlaAggregate aggregate;
+                            uint32_t count = buschlaKeyRangeStats(file, i, state->rangeFirstLine, rangeLastLine, &aggregate);
+                            if (count == 0) {
+                                continue;
+                            }
+                            double columns[] = { aggregate.min, aggregate.max, aggregate.sum, aggregate.sum / count };
+
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(buschlaString(file, file->keys[i].name));
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%u", count);
+                            for (size_t c = 0; c < ARRAY_SIZE(columns); ++c) {
+                                ImGui::TableNextColumn();
+                                ImGui::Text("%g", columns[c]);
+                            }
+                        }
+                        ImGui::EndTable();
+                    }
+                }
+
+                // Templates are stored most frequent first.
+                uint32_t templateCount = file->header->sections[SECTION_TEMPLATES].count;
+                ImGui::SeparatorText(tmpf("Most frequent lines (%u)", templateCount));
+                for (uint32_t i = 0; i < templateCount; ++i) {
+                    BuschlaTemplate* lineTemplate = file->templates + i;
+                    const char* label = tmpf("%8u  %s##template%u", lineTemplate->count, buschlaString(file, lineTemplate->text), i);
+                    if (ImGui::Selectable(label, state->selectedLine == lineTemplate->firstLine)) {
+                        state->selectedLine = lineTemplate->firstLine;
+                        state->scrollToSelectedLine = true;
+                    }
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("lines %u to %u, count overestimated by at most %u",
+                            lineTemplate->firstLine + 1, lineTemplate->lastLine + 1, lineTemplate->error);
+                    }
+                }
+
+                uint32_t alertCount = file->header->sections[SECTION_ALERTS].count;
+                if (alertCount > 0) {
+                    ImGui::SeparatorText(tmpf("Alerts (%u)", alertCount));
+                    for (uint32_t i = 0; i < alertCount; ++i) {
+                        BuschlaAlert* alert = file->alerts + i;
+                        const char* label = tmpf("line %u: %s (%u)##alert%u", buschlaLineNumber(file, alert->line), buschlaString(file, alert->rule), alert->count, i);
+                        if (ImGui::Selectable(label, state->selectedLine == alert->line)) {
+                            state->selectedLine = alert->line;
+                            state->scrollToSelectedLine = true;
+                        }
+                    }
+                }
+
+                // Hitches are stored worst first.
+                uint32_t hitchCount = file->header->sections[SECTION_HITCHES].count;
+                ImGui::SeparatorText(tmpf("Hitches (%u)", hitchCount));
+                uint32_t shownHitchCount = hitchCount < APP_MAX_SHOWN_HITCHES ? hitchCount : APP_MAX_SHOWN_HITCHES;
+                for (uint32_t i = 0; i < shownHitchCount; ++i) {
+                    BuschlaHitch* hitch = file->hitches + i;
+                    uint32_t lastLine = hitch->lines.first + hitch->lines.count - 1;
+                    const char* label = tmpf("frame %u: %.2f (median %.2f, severity %.1f)##%u",
+                        hitch->frame, hitch->duration, hitch->median, hitch->severity, i);
+                    if (ImGui::Selectable(label, state->selectedLine == lastLine)) {
+                        state->selectedLine = lastLine;
+                        state->scrollToSelectedLine = true;
+                    }
+                }
+            }
         }
         ImGui::EndChild();
 
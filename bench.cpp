@@ -0,0 +1,309 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buschla_log.h"
+#include "json_lines.h"
+#include "lexer.h"
+
+// Micro benchmarks for the hot loops of buschla-parser.
+// Build with 'make bench', the benchmarks are compiled with optimizations.
+
+typedef struct {
+    char* data;
+    size_t size;
+
+    // Start of each line in data, lines are null-terminated.
+    Uint32s lineStarts;
+} BenchCorpus;
+
+static bool loadCorpus(BenchCorpus* corpus, const char* fileName)
+{
+    memset(corpus, 0, sizeof(BenchCorpus));
+
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open '%s'\n", fileName);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    corpus->data = (char*)malloc(size + 1);
+    corpus->size = fread(corpus->data, 1, size, file);
+    corpus->data[corpus->size] = '\0';
+    fclose(file);
+
+    uint32_t lineStart = 0;
+    for (uint32_t i = 0; i < corpus->size; ++i) {
+        if (corpus->data[i] == '\n' || corpus->data[i] == '\r') {
+            corpus->data[i] = '\0';
+            if (i > lineStart) {
+                da_append(&corpus->lineStarts, lineStart);
+            }
+            lineStart = i + 1;
+        }
+    }
+    if (corpus->size > lineStart) {
+        da_append(&corpus->lineStarts, lineStart);
+    }
+
+    return true;
+}
+
+static void freeCorpus(BenchCorpus* corpus)
+{
+    free(corpus->data);
+    da_free(&corpus->lineStarts);
+}
+
+typedef struct {
+    uint64_t tokenCount;
+    // Sum of token kinds and lengths, so the compiler can't drop the lexing.
+    uint64_t checksum;
+} LexStats;
+
+template <typename LexFunc>
+static float benchLexer(BenchCorpus* corpus, int iterations, LexStats* statsOut, LexFunc lexNext)
+{
+    LexStats stats = { 0, 0 };
+    TIME_SCOPE(timer) {
+        for (int it = 0; it < iterations; ++it) {
+            for (uint32_t i = 0; i < corpus->lineStarts.count; ++i) {
+                Lexer lex;
+                lex.str.txt = corpus->data + corpus->lineStarts.items[i];
+                lex.pos = lex.str.txt;
+                while (lexNext(&lex)) {
+                    ++stats.tokenCount;
+                    stats.checksum += lex.token.kind * 31 + lex.token.str.len;
+                }
+            }
+        }
+    }
+    *statsOut = stats;
+    return timer.elapsedMs;
+}
+
+template <const LexerDialect& Dialect>
+static bool benchLexerDialect(BenchCorpus* corpus, int iterations)
+{
+    LexStats genericStats, specializedStats;
+    float genericMs = benchLexer(corpus, iterations, &genericStats, [](Lexer* lex) { return nextToken(lex, &Dialect); });
+    float specializedMs = benchLexer(corpus, iterations, &specializedStats, [](Lexer* lex) { return nextTokenSpecialized<Dialect>(lex); });
+
+    double megaBytes = (double)corpus->size * iterations / (1024.0 * 1024.0);
+    printf("%-8s generic: %8.2f ms (%7.1f MB/s)  specialized: %8.2f ms (%7.1f MB/s)  speedup: %.2fx  tokens: %lu\n",
+           Dialect.name,
+           genericMs, megaBytes / (genericMs * 1e-3),
+           specializedMs, megaBytes / (specializedMs * 1e-3),
+           genericMs / specializedMs,
+           (unsigned long)specializedStats.tokenCount);
+
+    if (genericStats.tokenCount != specializedStats.tokenCount || genericStats.checksum != specializedStats.checksum) {
+        fprintf(stderr, "%s: generic and specialized lexer disagree!\n", Dialect.name);
+        return false;
+    }
+    return true;
+}
+
+// JSON-lines path, in three stages: the SIMD structural index alone, the index plus field extraction
+// (json_parseLine), and the full parse path of buschla-parser --dialect json (without writing the file).
+// The parser is part of the bench unity build, so its static functions are used directly.
+static bool benchJson(BenchCorpus* corpus, int iterations)
+{
+    uint32_t lineCount = corpus->lineStarts.count;
+    StrView* lines = (StrView*)malloc(lineCount * sizeof(StrView) + 1);
+    assert(lines != NULL);
+    for (uint32_t i = 0; i < lineCount; ++i) {
+        lines[i].txt = corpus->data + corpus->lineStarts.items[i];
+        lines[i].len = (uint32_t)strlen(lines[i].txt);
+    }
+
+    JsonLineParser json;
+    memset(&json, 0, sizeof(JsonLineParser));
+    uint64_t structuralCount = 0;
+    TIME_SCOPE(indexTimer) {
+        for (int it = 0; it < iterations; ++it) {
+            for (uint32_t i = 0; i < lineCount; ++i) {
+                _json_indexStructurals(&json, lines[i]);
+                structuralCount += json.structurals.count;
+            }
+        }
+    }
+
+    uint64_t fieldCount = 0;
+    uint32_t invalidLineCount = 0;
+    TIME_SCOPE(fieldTimer) {
+        for (int it = 0; it < iterations; ++it) {
+            for (uint32_t i = 0; i < lineCount; ++i) {
+                if (!json_parseLine(&json, lines[i])) {
+                    ++invalidLineCount;
+                }
+                fieldCount += json.fields.count;
+            }
+        }
+    }
+    json_free(&json);
+
+    // Only appending the lines is timed, resetParser between the iterations is not.
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.frameKey = "frame";
+    parser.frameTimeKey = "time";
+    parser.dialect = DIALECT_JSON;
+    float parseMs = 0.0f;
+    for (int it = 0; it < iterations; ++it) {
+        resetParser(&parser);
+        TIME_SCOPE(parseTimer) {
+            for (uint32_t i = 0; i < lineCount; ++i) {
+                appendLine(&parser, lines[i], i + 1);
+            }
+        }
+        parseMs += parseTimer.elapsedMs;
+    }
+    uint32_t keyCount = parser.keyNames.strings.count;
+    uint32_t valueCount = parser.values.count;
+    free(lines);
+
+    double megaBytes = (double)corpus->size * iterations / (1024.0 * 1024.0);
+    printf("json index:     %8.2f ms (%7.1f MB/s)  structurals: %lu\n",
+           indexTimer.elapsedMs, megaBytes / (indexTimer.elapsedMs * 1e-3), (unsigned long)structuralCount);
+    printf("json fields:    %8.2f ms (%7.1f MB/s)  fields: %lu, %u lines are not JSON objects\n",
+           fieldTimer.elapsedMs, megaBytes / (fieldTimer.elapsedMs * 1e-3), (unsigned long)fieldCount, invalidLineCount);
+    printf("json parse:     %8.2f ms (%7.1f MB/s)  keys: %u, values per iteration: %u\n",
+           parseMs, megaBytes / (parseMs * 1e-3), keyCount, valueCount);
+    return true;
+}
+
+// Game side of the binary logging path: BUSCHLA_LOG vs snprintf + fwrite of the same lines.
+// Writes <path>.bblog and <path>.log, the parser side is compared by running buschla-parser on both.
+static bool benchBinaryLog(const char* path, long eventCount)
+{
+    static const char* assets[] = { "mesh_rock.pak", "tex_grass.pak", "anim_run.pak", "level_02.pak" };
+
+    char binaryPath[1024];
+    char textPath[1024];
+    snprintf(binaryPath, sizeof(binaryPath), "%s.bblog", path);
+    snprintf(textPath, sizeof(textPath), "%s.log", path);
+
+    BuschlaLogger logger;
+    if (!buschla_log_open(&logger, binaryPath)) {
+        fprintf(stderr, "failed to open '%s'\n", binaryPath);
+        return false;
+    }
+
+    TIME_SCOPE(binaryTimer) {
+        for (long i = 0; i < eventCount; ++i) {
+            buschla_log_set_frame(&logger, (uint64_t)(i / 8));
+            switch (i % 4) {
+            case 0:
+                BUSCHLA_LOG(&logger, "[Render] INFO Frame: %ld time: %.3f draw calls: %d", i / 8, 16.6 + (i % 97) * 0.01, (int)(i % 3000));
+                break;
+            case 1:
+                BUSCHLA_LOG(&logger, "[Physics] DEBUG bodies: %d contacts: %d step: %f", (int)(i % 500), (int)(i % 1200), 0.0166);
+                break;
+            case 2:
+                BUSCHLA_LOG(&logger, "[Asset] WARN slow load %s took: %.2f", assets[i % 4], (i % 50) * 0.5);
+                break;
+            default:
+                BUSCHLA_LOG(&logger, "[Net] INFO rtt: %u packets: %u id=0x%lx", (unsigned)(i % 200), (unsigned)(i % 64), (unsigned long)i * 2654435761ul);
+                break;
+            }
+        }
+        buschla_log_close(&logger);
+    }
+
+    FILE* textFile = fopen(textPath, "wb");
+    if (textFile == NULL) {
+        fprintf(stderr, "failed to open '%s'\n", textPath);
+        return false;
+    }
+
+    char line[1024];
+    TIME_SCOPE(textTimer) {
+        for (long i = 0; i < eventCount; ++i) {
+            int length = 0;
+            switch (i % 4) {
+            case 0:
+                length = snprintf(line, sizeof(line), "[Render] INFO Frame: %ld time: %.3f draw calls: %d\n", i / 8, 16.6 + (i % 97) * 0.01, (int)(i % 3000));
+                break;
+            case 1:
+                length = snprintf(line, sizeof(line), "[Physics] DEBUG bodies: %d contacts: %d step: %f\n", (int)(i % 500), (int)(i % 1200), 0.0166);
+                break;
+            case 2:
+                length = snprintf(line, sizeof(line), "[Asset] WARN slow load %s took: %.2f\n", assets[i % 4], (i % 50) * 0.5);
+                break;
+            default:
+                length = snprintf(line, sizeof(line), "[Net] INFO rtt: %u packets: %u id=0x%lx\n", (unsigned)(i % 200), (unsigned)(i % 64), (unsigned long)i * 2654435761ul);
+                break;
+            }
+            fwrite(line, 1, length, textFile);
+        }
+        fclose(textFile);
+    }
+
+    printf("game side, %ld events:\n", eventCount);
+    printf("  binary (buschla_log.h): %8.2f ms (%5.1f ns/event)\n", binaryTimer.elapsedMs, binaryTimer.elapsedMs * 1e6 / eventCount);
+    printf("  text (snprintf):        %8.2f ms (%5.1f ns/event)\n", textTimer.elapsedMs, textTimer.elapsedMs * 1e6 / eventCount);
+    printf("parser side, compare the parse times of:\n");
+    printf("  buschla-parser --dialect binary -o %s.binary.buschla %s\n", path, binaryPath);
+    printf("  buschla-parser -o %s.text.buschla %s\n", path, textPath);
+    return true;
+}
+
+static void printUsage(int argc, char** argv)
+{
+    printf("Usage: %s lexer <corpus file> [iterations]\n", argv[0]);
+    printf("       %s json <corpus file> [iterations]\n", argv[0]);
+    printf("       %s binlog <output path> [event count]\n", argv[0]);
+    printf("Benchmarks:\n");
+    printf("  lexer    generic vs compile-time specialized lexer, per dialect\n");
+    printf("  json     JSON-lines structural index, field extraction and full parse (parser --dialect json)\n");
+    printf("  binlog   binary logging (buschla_log.h) vs text logging, game side\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        printUsage(argc, argv);
+        return 1;
+    }
+
+    const char* benchmark = argv[1];
+    if (strcmp(benchmark, "binlog") == 0) {
+        long eventCount = argc > 3 ? atol(argv[3]) : 1000000;
+        return benchBinaryLog(argv[2], eventCount > 0 ? eventCount : 1) ? 0 : 1;
+    }
+
+    int iterations = argc > 3 ? atoi(argv[3]) : 10;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    BenchCorpus corpus;
+    if (!loadCorpus(&corpus, argv[2])) {
+        return 1;
+    }
+    printf("corpus: %zu bytes, %u lines, %d iterations\n", corpus.size, corpus.lineStarts.count, iterations);
+
+    bool ok = true;
+    if (strcmp(benchmark, "lexer") == 0) {
+#define X(name, dialectName, tokens, separators) ok &= benchLexerDialect<name>(&corpus, iterations);
+        LEXER_DIALECTS(X)
+#undef X
+    }
+    else if (strcmp(benchmark, "json") == 0) {
+        ok = benchJson(&corpus, iterations);
+    }
+    else {
+        fprintf(stderr, "unknown benchmark '%s'\n", benchmark);
+        printUsage(argc, argv);
+        ok = false;
+    }
+
+    freeCorpus(&corpus);
+    return ok ? 0 : 1;
+}
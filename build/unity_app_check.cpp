@@ -0,0 +1,5 @@
+#include "../util.cpp"
+#include "../dynamic_array.cpp"
+#include "../lz_block.cpp"
+#include "../buschla_file.cpp"
+#include "../app.cpp"
@@ -0,0 +1,14 @@
+
+#include "../util.cpp" 
+#include "../directory_watcher.cpp" 
+#include "../dynamic_array.cpp" 
+#include "../string_table.cpp" 
+#include "../value_sketch.cpp" 
+#include "../top_k.cpp" 
+#include "../chunk_store.cpp" 
+#include "../lz_block.cpp" 
+#include "../alert_rule.cpp" 
+#include "../parse_cache.cpp" 
+#include "../lexer.cpp" 
+#include "../json_lines.cpp" 
+#include "../parser.cpp"
@@ -1,90 +1,1087 @@
 #include "buschla_file.h"
+#include "lz_block.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+const char* logLevelStrs[] = {
+#define X(x) #x,
+    LOG_LEVELS(X)
+#undef X
+};
+
+const char* buschlaSectionStrs[] = {
+#define X(id, name, type) #id,
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
+};
+
+const char* buschlaString(BuschlaFile* file, BuschlaString str) {
+    // The null terminator has to be in the section as well.
+    if ((uint64_t)str.offset + str.len >= file->header->sections[SECTION_STRINGS].count) {
+        return "";
+    }
+    return file->strings + str.offset;
+}
+
+uint32_t buschlaLineNumber(BuschlaFile* file, uint32_t lineIndex) {
+    // Find the last run starting on or before the line.
+    // Runs that are not sorted only give wrong numbers, the run found always starts on or before the line.
+    uint32_t first = 0;
+    uint32_t count = (uint32_t)file->header->sections[SECTION_LINE_NUMBERS].count;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        if (file->lineNumbers[first + half].line <= lineIndex) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+
+    if (first == 0) {
+        return lineIndex + 1;
+    }
+    const BuschlaLineNumber* run = file->lineNumbers + first - 1;
+    return run->lineNum + (lineIndex - run->line);
+}
+
+// Returns the index of the text block holding a line.
+static uint32_t findTextBlock(BuschlaFile* file, uint32_t lineIndex) {
+    // Last block starting on or before the line, the loader made sure that the first one starts at line 0.
+    uint32_t first = 0;
+    uint32_t count = (uint32_t)file->header->sections[SECTION_TEXT_BLOCKS].count;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        if (file->textBlocks[first + half].firstLine <= lineIndex) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return first - 1;
+}
+
+// Gets the lines of a text block, returns false if the block index is damaged (a block has no lines).
+static bool textBlockLines(BuschlaFile* file, uint32_t block, uint32_t* firstLineOut, uint32_t* endLineOut) {
+    uint32_t lineCount = buschlaLineCount(file);
+    *firstLineOut = file->textBlocks[block].firstLine;
+    *endLineOut = block + 1 < file->header->sections[SECTION_TEXT_BLOCKS].count ? file->textBlocks[block + 1].firstLine : lineCount;
+    return *firstLineOut < *endLineOut && *endLineOut <= lineCount;
+}
+
+// Returns the cache entry of a block (or of chunkCount chunks starting at block), *cachedOut is false if it was not cached:
+// then it is the least recently used entry, with room for size bytes, which the caller fills.
+static BuschlaTextCacheEntry* useTextCacheEntry(BuschlaFile* file, uint32_t block, uint32_t chunkCount, uint32_t size, bool* cachedOut) {
+    BuschlaTextCacheEntry* entry = file->textCache;
+    for (uint32_t i = 0; i < BUSCHLA_TEXT_CACHE_BLOCKS; ++i) {
+        if (file->textCache[i].block == block && file->textCache[i].chunkCount == chunkCount) {
+            file->textCache[i].lastUse = ++file->textCacheClock;
+            *cachedOut = true;
+            return file->textCache + i;
+        }
+        if (file->textCache[i].lastUse < entry->lastUse) {
+            entry = file->textCache + i;
+        }
+    }
+
+    if (entry->capacity < size) {
+        free(entry->text);
+        entry->text = (char*)malloc(size);
+        assert(entry->text != NULL && "Buy more RAM lel");
+        entry->capacity = size;
+    }
+    entry->block = block;
+    entry->chunkCount = chunkCount;
+    entry->lastUse = ++file->textCacheClock;
+    *cachedOut = false;
+    return entry;
+}
+
+// Returns the decompressed text of a block (size bytes), NULL if it is damaged.
+// Blocks that are not cached are decompressed into the least recently used cache entry.
+static const char* loadTextBlock(BuschlaFile* file, uint32_t block, uint32_t size) {
+    bool cached;
+    BuschlaTextCacheEntry* entry = useTextCacheEntry(file, block, 1, size, &cached);
+    if (cached) {
+        return entry->damaged ? NULL : entry->text;
+    }
+
+    const BuschlaTextBlock* textBlock = file->textBlocks + block;
+    uint64_t dataSize = file->header->sections[SECTION_TEXT_BLOCK_DATA].count;
+    entry->damaged = textBlock->offset > dataSize || textBlock->size > dataSize - textBlock->offset ||
+        !lz_decompress(file->textBlockData + textBlock->offset, textBlock->size, entry->text, size);
+    if (entry->damaged) {
+        fprintf(stderr, "text block %u is damaged\n", block);
+        return NULL;
+    }
+    return entry->text;
+}
+
+// Returns the index of the text chunk holding a byte of the text section (offset < text size).
+static uint32_t findTextChunk(BuschlaFile* file, uint64_t offset) {
+    uint32_t first = 0;
+    uint32_t count = (uint32_t)file->header->sections[SECTION_TEXT_CHUNKS].count;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        if (file->chunkOffsets[first + half] <= offset) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return first - 1;
+}
+
+// Returns the text of chunkCount chunks starting at firstChunk, read from the chunk store (size bytes).
+// Returns NULL if a chunk is missing or damaged, every chunk is checked against its hash.
+// Runs of chunks that are not cached are read into the least recently used cache entry.
+static const char* loadTextChunks(BuschlaFile* file, uint32_t firstChunk, uint32_t chunkCount, uint32_t size) {
+    bool cached;
+    BuschlaTextCacheEntry* entry = useTextCacheEntry(file, firstChunk, chunkCount, size, &cached);
+    if (cached) {
+        return entry->damaged ? NULL : entry->text;
+    }
+
+    entry->damaged = false;
+    char path[PATH_MAX + 64];
+    for (uint32_t i = firstChunk; i < firstChunk + chunkCount && !entry->damaged; ++i) {
+        const BuschlaChunk* chunk = file->textChunks + i;
+        char* text = entry->text + (file->chunkOffsets[i] - file->chunkOffsets[firstChunk]);
+        buschlaChunkPath(file->chunkStorePath, chunk, path, sizeof(path));
+        FILE* chunkFile = fopen(path, "r");
+        if (chunkFile == NULL) {
+            fprintf(stderr, "fopen(%s): %s\n", path, strerror(errno));
+            entry->damaged = true;
+            break;
+        }
+        size_t read = fread(text, 1, chunk->size, chunkFile);
+        fclose(chunkFile);
+
+        if (read != chunk->size ||
+            hashBytes(text, chunk->size, BUSCHLA_CHUNK_HASH_SEED_0) != chunk->hash[0] ||
+            hashBytes(text, chunk->size, BUSCHLA_CHUNK_HASH_SEED_1) != chunk->hash[1]) {
+            fprintf(stderr, "chunk '%s' is damaged\n", path);
+            entry->damaged = true;
+        }
+    }
+    return entry->damaged ? NULL : entry->text;
+}
+
+// Returns the buffer holding the text of a line, bytes [*offsetOut, *offsetOut + *sizeOut) of the text section.
+// Returns NULL if the text is damaged.
+static const char* lineBuffer(BuschlaFile* file, uint32_t lineIndex, uint64_t* offsetOut, uint64_t* sizeOut) {
+    if (file->chunkOffsets != NULL) {
+        // The chunks are cut by content, a line can continue in the next ones.
+        uint64_t begin = buschlaLineOffset(file, lineIndex);
+        uint64_t end = buschlaLineOffset(file, lineIndex + 1);
+        uint32_t chunkCount = (uint32_t)file->header->sections[SECTION_TEXT_CHUNKS].count;
+        if (end <= begin || end > file->chunkOffsets[chunkCount]) {
+            return NULL;
+        }
+        uint32_t firstChunk = findTextChunk(file, begin);
+        uint32_t lastChunk = findTextChunk(file, end - 1);
+        *offsetOut = file->chunkOffsets[firstChunk];
+        *sizeOut = file->chunkOffsets[lastChunk + 1] - *offsetOut;
+        if (*sizeOut > UINT32_MAX) {
+            return NULL;
+        }
+        return loadTextChunks(file, firstChunk, lastChunk - firstChunk + 1, (uint32_t)*sizeOut);
+    }
+
+    if (file->textBlocks == NULL) {
+        *offsetOut = 0;
+        *sizeOut = file->header->sections[SECTION_TEXT_BUFFER].count;
+        return file->textBuffer;
+    }
+
+    uint32_t block = findTextBlock(file, lineIndex);
+    uint32_t firstLine, endLine;
+    if (!textBlockLines(file, block, &firstLine, &endLine) || lineIndex >= endLine) {
+        return NULL;
+    }
+    uint64_t blockOffset = buschlaLineOffset(file, firstLine);
+    uint64_t blockEnd = buschlaLineOffset(file, endLine);
+    if (blockEnd <= blockOffset || blockEnd - blockOffset > UINT32_MAX) {
+        return NULL;
+    }
+    *offsetOut = blockOffset;
+    *sizeOut = blockEnd - blockOffset;
+    return loadTextBlock(file, block, (uint32_t)*sizeOut);
+}
+
+StrView buschlaLine(BuschlaFile* file, uint32_t lineIndex) {
+    StrView str = { "", 0 };
+    if (lineIndex >= buschlaLineCount(file)) {
+        return str;
+    }
+    uint64_t offset = buschlaLineOffset(file, lineIndex);
+    uint64_t end = buschlaLineOffset(file, lineIndex + 1);
+    uint64_t bufferOffset, bufferSize;
+    const char* buffer = lineBuffer(file, lineIndex, &bufferOffset, &bufferSize);
+    if (buffer == NULL || end <= offset || offset < bufferOffset || end - bufferOffset > bufferSize || end - offset - 1 > UINT32_MAX) {
+        return str;
+    }
+
+    str.txt = buffer + (offset - bufferOffset);
+    str.len = (uint32_t)(end - offset - 1);
+    return str;
+}
+
+uint32_t buschlaLineTokens(BuschlaFile* file, uint32_t lineIndex, const BuschlaToken** tokensOut) {
+    *tokensOut = NULL;
+    if (file->lineTokens == NULL) {
+        return 0;
+    }
+
+    assert(lineIndex < buschlaLineCount(file));
+    uint32_t first = file->lineTokens[lineIndex];
+    uint32_t end = file->lineTokens[lineIndex + 1];
+    if (end < first || end > file->header->sections[SECTION_TOKENS].count) {
+        return 0;
+    }
+    *tokensOut = file->tokens + first;
+    return end - first;
+}
+
+const BuschlaSource* buschlaLineSource(BuschlaFile* file, uint32_t lineIndex) {
+    if (file->lineSources == NULL) {
+        return NULL;
+    }
+
+    assert(lineIndex < buschlaLineCount(file));
+    uint16_t source = file->lineSources[lineIndex];
+    if (source >= file->header->sections[SECTION_SOURCES].count) {
+        return NULL;
+    }
+    return file->sources + source;
+}
+
+double buschlaKeyPercentile(BuschlaFile* file, uint32_t keyIndex, double p) {
+    if (file->keyStats == NULL) {
+        return NAN;
+    }
+
+    assert(keyIndex < file->header->sections[SECTION_KEY_STATS].count);
+    const BuschlaKeyStats* stats = file->keyStats + keyIndex;
+    if (stats->count == 0) {
+        return NAN;
+    }
+
+    // Rank of the wanted sample (1-based), then find the bucket it falls into.
+    double rank = p * (double)stats->count;
+    uint64_t target = rank < 1.0 ? 1 : rank >= (double)stats->count ? stats->count : (uint64_t)ceil(rank);
+    uint64_t seen = 0;
+    const BuschlaBucket* buckets = file->keyBuckets + stats->buckets.first;
+    for (uint32_t i = 0; i < stats->buckets.count; ++i) {
+        seen += buckets[i].count;
+        if (seen >= target) {
+            double value = buschlaBucketValue(buckets[i].bucket);
+            return value < stats->min ? stats->min : value > stats->max ? stats->max : value;
+        }
+    }
+    return stats->max;
+}
+
+static void addAggregate(BuschlaAggregate* aggregate, const BuschlaAggregate* other) {
+    aggregate->min = other->min < aggregate->min ? other->min : aggregate->min;
+    aggregate->max = other->max > aggregate->max ? other->max : aggregate->max;
+    aggregate->sum += other->sum;
+}
+
+static void addSamples(BuschlaAggregate* aggregate, const double* values, uint32_t first, uint32_t end) {
+    for (uint32_t i = first; i < end; ++i) {
+        aggregate->min = values[i] < aggregate->min ? values[i] : aggregate->min;
+        aggregate->max = values[i] > aggregate->max ? values[i] : aggregate->max;
+        aggregate->sum += values[i];
+    }
+}
+
+// Returns the index of the first entry of lines that is >= line (count if there is none).
+static uint32_t lowerBoundLine(const uint32_t* lines, uint32_t count, uint32_t line) {
+    uint32_t first = 0;
+    while (count > 0) {
+        uint32_t step = count / 2;
+        if (lines[first + step] < line) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+uint32_t buschlaKeyRangeStats(BuschlaFile* file, uint32_t keyIndex, uint32_t firstLine, uint32_t lastLine, BuschlaAggregate* statsOut) {
+    assert(keyIndex < file->header->sections[SECTION_KEYS].count);
+    BuschlaRange samples = file->keys[keyIndex].samples;
+    const uint32_t* lines = file->valueLines + samples.first;
+    const double* values = file->values + samples.first;
+
+    uint32_t first = lowerBoundLine(lines, samples.count, firstLine);
+    uint32_t end = lastLine == UINT32_MAX ? samples.count : lowerBoundLine(lines, samples.count, lastLine + 1);
+    if (first >= end) {
+        return 0;
+    }
+
+    BuschlaAggregate aggregate = { INFINITY, -INFINITY, 0.0 };
+    BuschlaRange tree = { 0, 0 };
+    if (file->keyStats != NULL) {
+        tree = file->keyStats[keyIndex].aggregates;
+    }
+
+    uint32_t firstBlock = (first + BUSCHLA_AGGREGATE_BLOCK_SAMPLES - 1) / BUSCHLA_AGGREGATE_BLOCK_SAMPLES;
+    uint32_t endBlock = end / BUSCHLA_AGGREGATE_BLOCK_SAMPLES;
+    if (tree.count == 0 || firstBlock >= endBlock) {
+        addSamples(&aggregate, values, first, end);
+    }
+    else {
+        // Partial blocks at both ends, then the whole blocks in between from the tree.
+        addSamples(&aggregate, values, first, firstBlock * BUSCHLA_AGGREGATE_BLOCK_SAMPLES);
+        addSamples(&aggregate, values, endBlock * BUSCHLA_AGGREGATE_BLOCK_SAMPLES, end);
+
+        const BuschlaAggregate* nodes = file->keyAggregates + tree.first;
+        uint32_t blockCount = tree.count / 2;
+        for (uint32_t l = firstBlock + blockCount, r = endBlock + blockCount; l < r; l /= 2, r /= 2) {
+            if (l & 1) {
+                addAggregate(&aggregate, nodes + l++);
+            }
+            if (r & 1) {
+                addAggregate(&aggregate, nodes + --r);
+            }
+        }
+    }
+
+    *statsOut = aggregate;
+    return end - first;
+}
+
+// Returns the number of samples of a key before a checkpoint, from the key's last entry in valueCheckpoints up to it.
+// Returns 0 if there is none (or it is damaged), then the samples are replayed from the first one.
+static uint32_t samplesBeforeCheckpoint(BuschlaFile* file, uint32_t keyIndex, uint32_t checkpoint) {
+    uint32_t first = 0;
+    uint32_t count = (uint32_t)file->header->sections[SECTION_VALUE_CHECKPOINTS].count;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        const BuschlaValueCheckpoint* entry = file->valueCheckpoints + first + half;
+        if (entry->key < keyIndex || (entry->key == keyIndex && entry->checkpoint <= checkpoint)) {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+
+    if (first == 0 || file->valueCheckpoints[first - 1].key != keyIndex) {
+        return 0;
+    }
+    uint32_t before = file->valueCheckpoints[first - 1].before;
+    return before <= file->keys[keyIndex].samples.count ? before : 0;
+}
+
+uint32_t buschlaValuesAt(BuschlaFile* file, uint32_t lineIndex, uint32_t* samplesOut) {
+    uint32_t keyCount = file->header->sections[SECTION_KEYS].count;
+    uint32_t checkpoint = lineIndex / BUSCHLA_CHECKPOINT_LINES;
+
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        BuschlaRange samples = file->keys[i].samples;
+        const uint32_t* lines = file->valueLines + samples.first;
+        // Without checkpoints (or with a damaged one), replay from the first sample.
+        uint32_t before = file->valueCheckpoints != NULL ? samplesBeforeCheckpoint(file, i, checkpoint) : 0;
+        while (before < samples.count && lines[before] <= lineIndex) {
+            ++before;
+        }
+
+        if (before > 0) {
+            samplesOut[i] = samples.first + before - 1;
+            ++found;
+        }
+        else {
+            samplesOut[i] = BUSCHLA_SAMPLE_NONE;
+        }
+    }
+    return found;
+}
+
+uint32_t buschlaScopesAt(BuschlaFile* file, uint32_t lineIndex, Uint32s* scopesOut) {
+    // Last scope that begins at or before the line.
+    uint32_t first = 0;
+    uint32_t count = file->header->sections[SECTION_SCOPES].count;
+    while (count > 0) {
+        uint32_t step = count / 2;
+        if (file->scopes[first + step].firstLine <= lineIndex) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    if (first == 0) {
+        return 0;
+    }
+
+    // Scopes that begin before it and still contain the line enclose it, so they are all on its parent chain.
+    // The chain is sorted from inner to outer, once a scope contains the line all of its parents do too.
+    // Parents come before their children, the walk stops at a parent that does not.
+    uint32_t found = 0;
+    for (uint32_t scope = first - 1; scope != BUSCHLA_SCOPE_NONE; ) {
+        if (file->scopes[scope].lastLine >= lineIndex) {
+            da_append(scopesOut, scope);
+            ++found;
+        }
+        uint32_t parent = file->scopes[scope].parent;
+        scope = parent < scope ? parent : BUSCHLA_SCOPE_NONE;
+    }
+    return found;
+}
+
+const BuschlaEntity* buschlaFindEntity(BuschlaFile* file, StrView name) {
+    uint32_t first = 0;
+    uint32_t count = file->header->sections[SECTION_ENTITIES].count;
+    while (count > 0) {
+        uint32_t step = count / 2;
+        BuschlaString entityName = file->entities[first + step].name;
+        int order = memcmp(buschlaString(file, entityName), name.txt, entityName.len < name.len ? entityName.len : name.len);
+        if (order < 0 || (order == 0 && entityName.len < name.len)) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+
+    if (first == file->header->sections[SECTION_ENTITIES].count) {
+        return NULL;
+    }
+    const BuschlaEntity* entity = file->entities + first;
+    if (entity->name.len != name.len || memcmp(buschlaString(file, entity->name), name.txt, name.len) != 0) {
+        return NULL;
+    }
+    // Entities whose lines are not stored are left out.
+    if ((uint64_t)entity->lines.first + entity->lines.count > file->header->sections[SECTION_ENTITY_LINES].count) {
+        return NULL;
+    }
+    return entity;
+}
+
+static const BuschlaTrigram* findTrigram(BuschlaFile* file, uint32_t trigram) {
+    uint32_t first = 0;
+    uint32_t count = file->header->sections[SECTION_TRIGRAMS].count;
+    while (count > 0) {
+        uint32_t step = count / 2;
+        if (file->trigrams[first + step].trigram < trigram) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+
+    uint32_t trigramCount = file->header->sections[SECTION_TRIGRAMS].count;
+    if (first < trigramCount && file->trigrams[first].trigram == trigram) {
+        return file->trigrams + first;
+    }
+    return NULL;
+}
+
+// The text of consecutive log lines is stored back to back (null-terminated),
+// so the whole range is searched at once instead of line by line.
+// The lines have to be in the same text block if the text is compressed.
+static uint32_t findLinesInText(BuschlaFile* file, StrView needle, uint32_t firstLine, uint32_t endLine, Uint32s* linesOut) {
+    if (firstLine >= endLine) {
+        return 0;
+    }
+
+    // Positions are taken from the line offsets, which are checked against the buffer here instead of when opening the file.
+    uint64_t bufferOffset, bufferSize;
+    const char* buffer = lineBuffer(file, firstLine, &bufferOffset, &bufferSize);
+    uint64_t begin = buschlaLineOffset(file, firstLine);
+    uint64_t finish = buschlaLineOffset(file, endLine);
+    if (buffer == NULL || finish <= begin || begin < bufferOffset || finish - bufferOffset > bufferSize) {
+        return 0;
+    }
+
+    const char* p = buffer + (begin - bufferOffset);
+    const char* end = buffer + (finish - bufferOffset) - 1;
+    uint32_t line = firstLine;
+    uint32_t found = 0;
+    while (line < endLine) {
+        const char* match = findBytes(p, end - p, needle.txt, needle.len);
+        if (match == NULL) {
+            break;
+        }
+
+        // The needle contains no null terminator, so a match never spans two lines.
+        uint64_t matchOffset = bufferOffset + (uint64_t)(match - buffer);
+        while (line + 1 < endLine && buschlaLineOffset(file, line + 1) <= matchOffset) {
+            ++line;
+        }
+        da_append(linesOut, line);
+        ++found;
+
+        ++line;
+        if (line < endLine) {
+            // Offsets that do not grow are damaged, the rest of the range is skipped.
+            uint64_t next = buschlaLineOffset(file, line);
+            if (next <= matchOffset || next >= finish) {
+                break;
+            }
+            p = buffer + (next - bufferOffset);
+        }
+    }
+    return found;
+}
+
+// Returns the end of the lines from firstLine on (up to endLine) whose text lies before the byte offset bufferEnd.
+static uint32_t linesBefore(BuschlaFile* file, uint32_t firstLine, uint32_t endLine, uint64_t bufferEnd) {
+    uint32_t count = endLine - firstLine;
+    while (count > 0) {
+        uint32_t half = count / 2;
+        if (buschlaLineOffset(file, firstLine + half + 1) <= bufferEnd) {
+            firstLine += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return firstLine;
+}
+
+// Compressed text is searched one block at a time, chunked text one loaded run of chunks at a time.
+static uint32_t findLinesInRange(BuschlaFile* file, StrView needle, uint32_t firstLine, uint32_t endLine, Uint32s* linesOut) {
+    uint32_t found = 0;
+    while (firstLine < endLine) {
+        uint32_t blockEndLine = endLine;
+        if (file->chunkOffsets != NULL) {
+            uint64_t bufferOffset, bufferSize;
+            blockEndLine = firstLine + 1;
+            if (lineBuffer(file, firstLine, &bufferOffset, &bufferSize) != NULL) {
+                uint32_t bufferEndLine = linesBefore(file, firstLine, endLine, bufferOffset + bufferSize);
+                blockEndLine = bufferEndLine > blockEndLine ? bufferEndLine : blockEndLine;
+            }
+        }
+        else if (file->textBlocks != NULL) {
+            uint32_t block = findTextBlock(file, firstLine);
+            uint32_t blockFirstLine, nextBlockLine;
+            if (!textBlockLines(file, block, &blockFirstLine, &nextBlockLine) || nextBlockLine <= firstLine) {
+                // The block index is damaged, buschlaLine returns these lines empty anyway.
+                nextBlockLine = firstLine + 1;
+            }
+            if (nextBlockLine < blockEndLine) {
+                blockEndLine = nextBlockLine;
+            }
+        }
+        found += findLinesInText(file, needle, firstLine, blockEndLine, linesOut);
+        firstLine = blockEndLine;
+    }
+    return found;
+}
+
+uint32_t buschlaFindLines(BuschlaFile* file, StrView needle, Uint32s* linesOut) {
+    uint32_t logLineCount = buschlaLineCount(file);
+    if (needle.len < 3 || file->trigrams == NULL) {
+        return findLinesInRange(file, needle, 0, logLineCount, linesOut);
+    }
+
+    // Every trigram of the needle has to be in a block for the block to contain the needle.
+    uint32_t needleTrigramCount = needle.len - 2;
+    const BuschlaTrigram** needleTrigrams = (const BuschlaTrigram**)malloc(needleTrigramCount * sizeof(BuschlaTrigram*));
+    assert(needleTrigrams != NULL);
+
+    const BuschlaTrigram* rarest = NULL;
+    for (uint32_t i = 0; i < needleTrigramCount; ++i) {
+        needleTrigrams[i] = findTrigram(file, BUSCHLA_TRIGRAM(needle.txt[i], needle.txt[i + 1], needle.txt[i + 2]));
+        if (needleTrigrams[i] == NULL) {
+            free(needleTrigrams);
+            return 0;
+        }
+        // Postings that are not stored make the index useless, scan everything instead.
+        BuschlaRange blocks = needleTrigrams[i]->blocks;
+        if ((uint64_t)blocks.first + blocks.count > file->header->sections[SECTION_TRIGRAM_BLOCKS].count) {
+            free(needleTrigrams);
+            return findLinesInRange(file, needle, 0, logLineCount, linesOut);
+        }
+        if (rarest == NULL || needleTrigrams[i]->blocks.count < rarest->blocks.count) {
+            rarest = needleTrigrams[i];
+        }
+    }
+
+    // Start with the blocks of the rarest trigram and intersect with all others.
+    uint32_t candidateCount = rarest->blocks.count;
+    uint32_t* candidates = (uint32_t*)malloc(candidateCount * sizeof(uint32_t) + 1);
+    assert(candidates != NULL);
+    memcpy(candidates, file->trigramBlocks + rarest->blocks.first, candidateCount * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < needleTrigramCount && candidateCount > 0; ++i) {
+        if (needleTrigrams[i] == rarest) {
+            continue;
+        }
+
+        const uint32_t* blocks = file->trigramBlocks + needleTrigrams[i]->blocks.first;
+        uint32_t blockCount = needleTrigrams[i]->blocks.count;
+        uint32_t blockIndex = 0;
+        uint32_t kept = 0;
+        for (uint32_t c = 0; c < candidateCount; ++c) {
+            while (blockIndex < blockCount && blocks[blockIndex] < candidates[c]) {
+                ++blockIndex;
+            }
+            if (blockIndex == blockCount) {
+                break;
+            }
+            if (blocks[blockIndex] == candidates[c]) {
+                candidates[kept++] = candidates[c];
+            }
+        }
+        candidateCount = kept;
+    }
+
+    uint32_t found = 0;
+    for (uint32_t c = 0; c < candidateCount; ++c) {
+        uint32_t firstLine = candidates[c] * BUSCHLA_TRIGRAM_BLOCK_LINES;
+        uint32_t endLine = firstLine + BUSCHLA_TRIGRAM_BLOCK_LINES;
+        if (endLine > logLineCount) {
+            endLine = logLineCount;
+        }
+        found += findLinesInRange(file, needle, firstLine, endLine, linesOut);
+    }
+
+    free(candidates);
+    free(needleTrigrams);
+    return found;
+}
+
+// Finds the chunk store and the full offset of every chunk, the chunks themselves are read when their lines are used.
+static bool loadChunkOffsets(BuschlaFile* file) {
+    const BuschlaFileSection* storeSection = file->header->sections + SECTION_CHUNK_STORE;
+    const char* store = getenv("BUSCHLA_CHUNK_STORE");
+    if (store == NULL) {
+        if (file->chunkStore == NULL || file->chunkStore[storeSection->count - 1] != '\0') {
+            fprintf(stderr, "chunked file without a chunk store path, set BUSCHLA_CHUNK_STORE\n");
+            return false;
+        }
+        store = file->chunkStore;
+    }
+    file->chunkStorePath = strdup(store);
+    assert(file->chunkStorePath != NULL && "Buy more RAM lel");
+
+    uint64_t textSize = file->header->sections[SECTION_TEXT_BUFFER].count;
+    uint32_t chunkCount = (uint32_t)file->header->sections[SECTION_TEXT_CHUNKS].count;
+    file->chunkOffsets = (uint64_t*)malloc(((size_t)chunkCount + 1) * sizeof(uint64_t));
+    assert(file->chunkOffsets != NULL && "Buy more RAM lel");
+    uint64_t nextOffset = 0;
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        const BuschlaChunk* chunk = file->textChunks + i;
+        if (chunk->offset != (uint32_t)nextOffset || chunk->size == 0 || chunk->size > textSize - nextOffset) {
+            fprintf(stderr, "chunk %u does not continue the text section\n", i);
+            return false;
+        }
+        file->chunkOffsets[i] = nextOffset;
+        nextOffset += chunk->size;
+    }
+    file->chunkOffsets[chunkCount] = nextOffset;
+
+    if (nextOffset != textSize) {
+        fprintf(stderr, "chunks cover %llu of %llu text bytes\n", (unsigned long long)nextOffset, (unsigned long long)textSize);
+        return false;
+    }
+    return true;
+}
+
+// Checks the section count and size of a header, fileSectionCount sections take headerSize bytes.
+static bool checkHeaderSize(const char* fileName, uint32_t fileSectionCount, uint32_t headerSize, uint32_t expectedSize, size_t size) {
+    if (fileSectionCount > SECTION_COUNT) {
+        fprintf(stderr, "%s has %u sections, this version of the viewer knows %u (written by a newer parser?)\n",
+                fileName, fileSectionCount, (uint32_t)SECTION_COUNT);
+        return false;
+    }
+    if (headerSize != expectedSize || size < headerSize) {
+        fprintf(stderr, "%s has a header of %u bytes, expected %u for %u sections\n", fileName, headerSize, expectedSize, fileSectionCount);
+        return false;
+    }
+    return true;
+}
+
+// Copies the header at the start of the file to headerOut, version 2 headers are converted to version 3.
+// Sections that are not in the file (it was written before they were added) are left empty.
+static bool readFileHeader(const char* fileName, const void* memory, size_t size, BuschlaFileHeader* headerOut) {
+    if (size < offsetof(BuschlaFileHeader, sections) || memcmp(memory, "BUSCHLA", 7) != 0) {
+        fprintf(stderr, "%s is not a .buschla file\n", fileName);
+        return false;
+    }
+
+    uint8_t version = ((const uint8_t*)memory)[7];
+    if (version == BUSCHLA_FILE_VERSION_2) {
+        BuschlaFileHeaderV2 header;
+        memcpy(&header, memory, offsetof(BuschlaFileHeaderV2, sections));
+        if (!checkHeaderSize(fileName, header.sectionCount, header.headerSize, BUSCHLA_HEADER_SIZE(BuschlaFileHeaderV2, header.sectionCount), size)) {
+            return false;
+        }
+        memcpy(header.sections, (const char*)memory + offsetof(BuschlaFileHeaderV2, sections), header.sectionCount * sizeof(BuschlaFileSectionV2));
+
+        memset(headerOut, 0, sizeof(BuschlaFileHeader));
+        memcpy(headerOut->magic, header.magic, sizeof(header.magic));
+        headerOut->version = header.version;
+        headerOut->headerSize = header.headerSize;
+        headerOut->sectionCount = header.sectionCount;
+        headerOut->totalSize = header.totalSize;
+        for (uint32_t i = 0; i < header.sectionCount; ++i) {
+            headerOut->sections[i].offset = header.sections[i].offset;
+            headerOut->sections[i].count = header.sections[i].count;
+            headerOut->sections[i].stride = header.sections[i].stride;
+        }
+        return true;
+    }
+
+    if (version == BUSCHLA_FILE_VERSION_3) {
+        memset(headerOut, 0, sizeof(BuschlaFileHeader));
+        memcpy(headerOut, memory, offsetof(BuschlaFileHeader, sections));
+        if (!checkHeaderSize(fileName, headerOut->sectionCount, headerOut->headerSize, BUSCHLA_HEADER_SIZE(BuschlaFileHeader, headerOut->sectionCount), size)) {
+            return false;
+        }
+        memcpy(headerOut->sections, (const char*)memory + offsetof(BuschlaFileHeader, sections), headerOut->sectionCount * sizeof(BuschlaFileSection));
+        return true;
+    }
+
+    fprintf(stderr, "%s has unsupported version %u\n", fileName, version);
+    return false;
+}
+
+// Converts a version 1 file (a table of log lines and their text) to the sections of the current format.
+// The text stays in the mapping, the line offsets, line numbers and levels (all LOG_LEVEL_NONE, which is not indexed
+// in levelLines) are built in convertedSections.
+static BuschlaFile* loadFileV1(const char* fileName, const void* mapping, size_t mappingSize) {
+    BuschlaFileHeaderV1 header;
+    if (mappingSize < sizeof(BuschlaFileHeaderV1)) {
+        fprintf(stderr, "%s is not a .buschla file\n", fileName);
+        return NULL;
+    }
+    memcpy(&header, mapping, sizeof(BuschlaFileHeaderV1));
+    if (header.headerSize != sizeof(BuschlaFileHeaderV1) || header.logLineStride != sizeof(BuschlaLogLineV1) ||
+        header.logLineCount == UINT32_MAX ||
+        (uint64_t)header.logLinesOffset + (uint64_t)header.logLineCount * header.logLineStride > mappingSize ||
+        (uint64_t)header.textBufferOffset + header.textBufferSize > mappingSize) {
+        fprintf(stderr, "%s has a damaged version 1 header\n", fileName);
+        return NULL;
+    }
+
+    uint32_t lineCount = header.logLineCount;
+    size_t lineNumbersSize = (size_t)lineCount * sizeof(BuschlaLineNumber);
+    size_t lineOffsetsSize = ((size_t)lineCount + 1) * sizeof(uint32_t);
+    size_t levelRangesSize = LOG_LEVEL_COUNT * sizeof(BuschlaRange);
+    char* converted = (char*)malloc(lineNumbersSize + lineOffsetsSize + levelRangesSize + lineCount);
+    assert(converted != NULL && "Buy more RAM lel");
+    BuschlaLineNumber* lineNumbers = (BuschlaLineNumber*)converted;
+    uint32_t* lineOffsets = (uint32_t*)(converted + lineNumbersSize);
+    BuschlaRange* levelRanges = (BuschlaRange*)(converted + lineNumbersSize + lineOffsetsSize);
+    uint8_t* levels = (uint8_t*)levelRanges + levelRangesSize;
+
+    // The parser wrote the text of the lines one after another, in the order of the table.
+    const char* memory = (const char*)mapping;
+    uint64_t textEnd = (uint64_t)header.textBufferOffset + header.textBufferSize;
+    uint64_t textOffset = header.textBufferOffset;
+    uint32_t lineNumberCount = 0;
+    uint32_t nextLineNum = 1;
+    for (uint32_t i = 0; i < lineCount; ++i) {
+        BuschlaLogLineV1 logLine;
+        memcpy(&logLine, memory + header.logLinesOffset + (uint64_t)i * sizeof(BuschlaLogLineV1), sizeof(BuschlaLogLineV1));
+        if (logLine.txt != textOffset || logLine.len >= textEnd - textOffset || memory[textOffset + logLine.len] != '\0') {
+            fprintf(stderr, "%s: the text of line %u is not where the version 1 line table puts it\n", fileName, i);
+            free(converted);
+            return NULL;
+        }
+
+        lineOffsets[i] = (uint32_t)(textOffset - header.textBufferOffset);
+        textOffset += logLine.len + 1;
+        if (logLine.lineNum != nextLineNum) {
+            lineNumbers[lineNumberCount].line = i;
+            lineNumbers[lineNumberCount].lineNum = logLine.lineNum;
+            ++lineNumberCount;
+        }
+        nextLineNum = logLine.lineNum + 1;
+
+        levels[i] = LOG_LEVEL_NONE;
+    }
+    lineOffsets[lineCount] = (uint32_t)(textOffset - header.textBufferOffset);
+    memset(levelRanges, 0, levelRangesSize);
+
+    BuschlaFile* buschlaFile = (BuschlaFile*)calloc(1, sizeof(BuschlaFile));
+    assert(buschlaFile != NULL);
+    buschlaFile->mapping = mapping;
+    buschlaFile->mappingSize = mappingSize;
+    buschlaFile->convertedSections = converted;
+    for (uint32_t i = 0; i < BUSCHLA_TEXT_CACHE_BLOCKS; ++i) {
+        buschlaFile->textCache[i].block = BUSCHLA_TEXT_BLOCK_NONE;
+    }
+
+    BuschlaFileHeader* headerOut = &buschlaFile->headerData;
+    memcpy(headerOut->magic, header.magic, sizeof(header.magic));
+    headerOut->version = header.version;
+    headerOut->headerSize = header.headerSize;
+    headerOut->totalSize = header.totalSize;
+#define X(id, name, type) headerOut->sections[id].stride = (uint32_t)sizeof(type);
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
+    headerOut->sections[SECTION_LINE_OFFSETS].count = (uint64_t)lineCount + 1;
+    headerOut->sections[SECTION_LINE_NUMBERS].count = lineNumberCount;
+    headerOut->sections[SECTION_TEXT_BUFFER].count = header.textBufferSize;
+    headerOut->sections[SECTION_LEVELS].count = lineCount;
+    headerOut->sections[SECTION_LEVEL_RANGES].count = LOG_LEVEL_COUNT;
+    buschlaFile->header = headerOut;
+
+    buschlaFile->lineOffsets = lineOffsets;
+    buschlaFile->lineNumbers = lineNumberCount > 0 ? lineNumbers : NULL;
+    buschlaFile->textBuffer = header.textBufferSize > 0 ? (char*)memory + header.textBufferOffset : NULL;
+    buschlaFile->levels = lineCount > 0 ? levels : NULL;
+    buschlaFile->levelRanges = levelRanges;
+    return buschlaFile;
+}
+
 BuschlaFile* tryLoadBuschlaFile(const char* fileName) {
 #define ERROR(fmt, ...) fprintf(stderr, "%s:%s:%d " fmt, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
-#define SEEK(pos) { \
-    int ret = fseek(file, (pos), SEEK_SET); \
-    if (ret != 0) { \
-        ERROR("fseek to %d failed. returned %d: %s\n", (pos), ret, strerror(ret)); \
+
+    // The parser replaces output files by renaming, a mapped file is never changed underneath.
+    size_t mappingSize = 0;
+    const void* mapping = mapFile(fileName, &mappingSize);
+    if (mapping == NULL) {
+        return NULL;
+    }
+
+#define ON_ERROR { unmapFile(mapping, mappingSize); return NULL; }
+
+    if (mappingSize > 8 && memcmp(mapping, "BUSCHLA", 7) == 0 && ((const uint8_t*)mapping)[7] == BUSCHLA_FILE_VERSION_1) {
+        BuschlaFile* buschlaFile = loadFileV1(fileName, mapping, mappingSize);
+        if (buschlaFile == NULL) {
+            ON_ERROR
+        }
+        return buschlaFile;
+    }
+
+    BuschlaFileHeader header;
+    if (!readFileHeader(fileName, mapping, mappingSize, &header)) {
+        ON_ERROR
+    }
+
+    // Validate section layout before touching any memory.
+    // Only the layout is checked here, opening takes the same time for any file size: the accessors check (or clamp)
+    // the entries they use, a damaged file shows wrong or empty lines instead of crashing.
+    // Counts larger than 32 bits are only valid for the (compressed) text, everything else is indexed with uint32_t.
+#define X(id, name, type) { \
+    BuschlaFileSection* section = header.sections + (id); \
+    if (section->count > 0 && section->stride != sizeof(type)) { \
+        ERROR("section %s has stride %u, expected %u\n", buschlaSectionStrs[id], section->stride, (uint32_t)sizeof(type)); \
         ON_ERROR \
     } \
-}
-#define READ(ptr, size) { \
-    size_t read = fread((ptr), 1, (size), file); \
-    if (read != (size)) { \
-        ERROR("fread of %ld bytes failed. returned %ld\n", (size_t)(size), read); \
+    if (section->count > 0 && section->offset % BUSCHLA_SECTION_ALIGNMENT != 0) { \
+        ERROR("section %s at offset %llu is not aligned\n", buschlaSectionStrs[id], (unsigned long long)section->offset); \
+        ON_ERROR \
+    } \
+    if ((id) != SECTION_TEXT_BUFFER && (id) != SECTION_TEXT_BLOCK_DATA && section->count > UINT32_MAX) { \
+        ERROR("section %s has %llu entries, at most %u are supported\n", buschlaSectionStrs[id], (unsigned long long)section->count, UINT32_MAX); \
+        ON_ERROR \
+    } \
+    if (section->offset > header.totalSize || section->count * section->stride > header.totalSize - section->offset) { \
+        ERROR("section %s exceeds total size %llu\n", buschlaSectionStrs[id], (unsigned long long)header.totalSize); \
         ON_ERROR \
     } \
 }
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
 
-#define ON_ERROR { return NULL; }
+    // Every log line has an offset and a level, there is one more offset for the end of the last line.
+    uint32_t logLineCount = (uint32_t)header.sections[SECTION_LEVELS].count;
+    if (header.sections[SECTION_LINE_OFFSETS].count != (uint64_t)logLineCount + 1) {
+        ERROR("section %s has %llu entries, expected %u\n", buschlaSectionStrs[SECTION_LINE_OFFSETS], (unsigned long long)header.sections[SECTION_LINE_OFFSETS].count, logLineCount + 1);
+        ON_ERROR
+    }
 
-    FILE* file = fopen(fileName, "r");
-    if (file == NULL) {
-        ERROR("fopen(%s): %s\n", fileName, strerror(errno));
+    // There is at most one wrap per 4GB of text.
+    uint32_t lineOffsetWrapCount = (uint32_t)header.sections[SECTION_LINE_OFFSET_WRAPS].count;
+    if (lineOffsetWrapCount > (header.sections[SECTION_TEXT_BUFFER].count >> 32)) {
+        ERROR("section %s has %u entries for %llu text bytes\n", buschlaSectionStrs[SECTION_LINE_OFFSET_WRAPS], lineOffsetWrapCount, (unsigned long long)header.sections[SECTION_TEXT_BUFFER].count);
         ON_ERROR
     }
 
-    BuschlaFileHeader header;
-    READ(&header, sizeof(BuschlaFileHeader));
+    uint32_t lineTokenCount = (uint32_t)header.sections[SECTION_LINE_TOKENS].count;
+    if (lineTokenCount > 0 && lineTokenCount != (uint64_t)logLineCount + 1) {
+        ERROR("section %s has %u entries, expected %u\n", buschlaSectionStrs[SECTION_LINE_TOKENS], lineTokenCount, logLineCount + 1);
+        ON_ERROR
+    }
 
-    // TODO: These assertions should be handled more gracefully!
-    assert(header.headerSize == sizeof(BuschlaFileHeader));
-    assert(header.logLineStride == sizeof(LogLine));
-    assert(strncmp(header.magic, "BUSCHLA", 7) == 0);
+    if (header.sections[SECTION_TEXT_BUFFER + 1].offset < header.sections[SECTION_TEXT_BUFFER].offset + header.sections[SECTION_TEXT_BUFFER].count) {
+        ERROR("section %s overlaps the next section\n", buschlaSectionStrs[SECTION_TEXT_BUFFER]);
+        ON_ERROR
+    }
 
-    assert(header.totalSize == header.headerSize + header.logLineCount * header.logLineStride + header.textBufferSize);
-    // NOTE: This assumes the text buffer is at the end (which it probably always will be)
-    assert(header.totalSize == header.textBufferOffset + header.textBufferSize);
+    uint32_t lineSourceCount = (uint32_t)header.sections[SECTION_LINE_SOURCES].count;
+    if (lineSourceCount > 0 && lineSourceCount != logLineCount) {
+        ERROR("section %s has %u entries, expected %u\n", buschlaSectionStrs[SECTION_LINE_SOURCES], lineSourceCount, logLineCount);
+        ON_ERROR
+    }
 
-    void* memory = malloc(header.totalSize);
-    assert(memory != NULL);
+    uint32_t keyCount = (uint32_t)header.sections[SECTION_KEYS].count;
+    uint32_t keyStatCount = (uint32_t)header.sections[SECTION_KEY_STATS].count;
+    if (keyStatCount > 0 && keyStatCount != keyCount) {
+        ERROR("section %s has %u entries, expected %u\n", buschlaSectionStrs[SECTION_KEY_STATS], keyStatCount, keyCount);
+        ON_ERROR
+    }
 
-#undef ON_ERROR
-#define ON_ERROR { free(memory); return NULL; }
+    // At most one checkpoint per sample, the entries themselves are checked when they are used.
+    uint64_t valueCheckpointCount = header.sections[SECTION_VALUE_CHECKPOINTS].count;
+    if (valueCheckpointCount > header.sections[SECTION_VALUES].count) {
+        ERROR("section %s has %llu entries, more than the %llu samples\n", buschlaSectionStrs[SECTION_VALUE_CHECKPOINTS],
+              (unsigned long long)valueCheckpointCount, (unsigned long long)header.sections[SECTION_VALUES].count);
+        ON_ERROR
+    }
 
-    SEEK(0);
-    READ(memory, header.totalSize);
+    bool chunked = header.sections[SECTION_TEXT_CHUNKS].count > 0;
+    bool compressed = header.sections[SECTION_TEXT_BLOCKS].count > 0;
+    if (chunked && compressed) {
+        ERROR("%s has both %s and %s\n", fileName, buschlaSectionStrs[SECTION_TEXT_CHUNKS], buschlaSectionStrs[SECTION_TEXT_BLOCKS]);
+        ON_ERROR
+    }
+    if (!compressed && header.sections[SECTION_TEXT_BLOCK_DATA].count > 0) {
+        ERROR("%s has compressed text without %s\n", fileName, buschlaSectionStrs[SECTION_TEXT_BLOCKS]);
+        ON_ERROR
+    }
 
-    int closeRet = fclose(file);
-    if (closeRet != 0) {
-        ERROR("fclose: %s\n", strerror(errno));
+    // Chunked and compressed text is not stored in the file, the sections after it follow right away.
+    uint64_t textOffset = header.sections[SECTION_TEXT_BUFFER].offset;
+    uint64_t textFileShift = chunked || compressed ? header.sections[SECTION_TEXT_BUFFER + 1].offset - textOffset : 0;
+    if (textFileShift > header.totalSize || textFileShift % BUSCHLA_SECTION_ALIGNMENT != 0) {
+        ERROR("section %s at offset %llu is not aligned\n", buschlaSectionStrs[SECTION_TEXT_BUFFER + 1], (unsigned long long)header.sections[SECTION_TEXT_BUFFER + 1].offset);
         ON_ERROR
     }
+    if (mappingSize < header.totalSize - textFileShift) {
+        ERROR("%s has %zu bytes, expected %llu\n", fileName, mappingSize, (unsigned long long)(header.totalSize - textFileShift));
+        ON_ERROR
+    }
+
+    // Where each section really is in the file, the ones after left out text are textFileShift bytes before their offset.
+#define X(id, name, type) { \
+    const BuschlaFileSection* section = header.sections + (id); \
+    uint64_t shift = (id) > SECTION_TEXT_BUFFER ? textFileShift : 0; \
+    bool stored = section->count > 0 && ((id) != SECTION_TEXT_BUFFER || !(chunked || compressed)); \
+    if (stored && (section->offset < shift || section->offset - shift > mappingSize || \
+                   section->count * section->stride > mappingSize - (section->offset - shift))) { \
+        ERROR("section %s at offset %llu lies outside of %s\n", buschlaSectionStrs[id], (unsigned long long)section->offset, fileName); \
+        ON_ERROR \
+    } \
+}
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
 
-    BuschlaFile* buschlaFile = (BuschlaFile*)malloc(sizeof(BuschlaFile));
+    BuschlaFile* buschlaFile = (BuschlaFile*)calloc(1, sizeof(BuschlaFile));
     assert(buschlaFile != NULL);
+    buschlaFile->mapping = mapping;
+    buschlaFile->mappingSize = mappingSize;
+    for (uint32_t i = 0; i < BUSCHLA_TEXT_CACHE_BLOCKS; ++i) {
+        buschlaFile->textCache[i].block = BUSCHLA_TEXT_BLOCK_NONE;
+    }
+
+#undef ON_ERROR
+#define ON_ERROR { freeBuschlaFile(buschlaFile); return NULL; }
+
+    const char* memory = (const char*)mapping;
+    buschlaFile->headerData = header;
+    buschlaFile->header = &buschlaFile->headerData;
+#define X(id, name, type) buschlaFile->name = header.sections[id].count == 0 ? NULL : \
+    (type*)(memory + header.sections[id].offset - ((id) > SECTION_TEXT_BUFFER ? textFileShift : 0));
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
 
-    // NOTE: file->header is the owning pointer.
-    buschlaFile->header = (BuschlaFileHeader*)memory;
-    buschlaFile->logLines = (LogLine*)((char*)memory + header.logLinesOffset);
+    if (compressed || chunked) {
+        buschlaFile->textBuffer = NULL;
+    }
+    if (chunked && !loadChunkOffsets(buschlaFile)) {
+        ON_ERROR
+    }
+
+    for (uint32_t i = 0; i < lineOffsetWrapCount; ++i) {
+        if (buschlaFile->lineOffsetWraps[i] > logLineCount || (i > 0 && buschlaFile->lineOffsetWraps[i] <= buschlaFile->lineOffsetWraps[i - 1])) {
+            ERROR("section %s is not sorted by line\n", buschlaSectionStrs[SECTION_LINE_OFFSET_WRAPS]);
+            ON_ERROR
+        }
+    }
+
+    // findTextBlock relies on a block for line 0, the other blocks are checked when they are used.
+    if (compressed && logLineCount > 0 && buschlaFile->textBlocks[0].firstLine != 0) {
+        ERROR("section %s does not start at line 0\n", buschlaSectionStrs[SECTION_TEXT_BLOCKS]);
+        ON_ERROR
+    }
+
+    // Fields and keys are dictionaries, their number does not grow with the number of lines.
+    uint32_t fieldCount = header.sections[SECTION_FIELDS].count;
+    for (uint32_t i = 0; i < fieldCount; ++i) {
+        const BuschlaField* field = buschlaFile->fields + i;
+        bool valid = (uint64_t)field->values.first + field->values.count <= header.sections[SECTION_FIELD_VALUES].count &&
+            (uint64_t)field->samples.first + field->samples.count <= header.sections[SECTION_FIELD_LINES].count &&
+            (field->codeSize == 1 || field->codeSize == 2 || field->codeSize == 4) && field->codeOffset % field->codeSize == 0 &&
+            (uint64_t)field->codeOffset + (uint64_t)field->samples.count * field->codeSize <= header.sections[SECTION_FIELD_CODES].count;
+        if (!valid) {
+            ERROR("section %s: field %u references data that is not stored\n", buschlaSectionStrs[SECTION_FIELDS], i);
+            ON_ERROR
+        }
+    }
 
-    // Resolve relative string addresses //
-    for (uint32_t i = 0; i < header.logLineCount; ++i) {
-        LogLine* logLine = buschlaFile->logLines + i;
-        const char* txt = ((char*)memory + (uint64_t)logLine->str.txt);
-        logLine->str.txt = txt;
+    uint32_t valueCount = header.sections[SECTION_VALUES].count;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        BuschlaRange samples = buschlaFile->keys[i].samples;
+        if ((uint64_t)samples.first + samples.count > valueCount || header.sections[SECTION_VALUE_LINES].count != valueCount) {
+            ERROR("section %s references more samples than stored\n", buschlaSectionStrs[SECTION_KEYS]);
+            ON_ERROR
+        }
+    }
+
+    uint32_t keyBucketCount = header.sections[SECTION_KEY_BUCKETS].count;
+    for (uint32_t i = 0; i < keyStatCount; ++i) {
+        BuschlaRange buckets = buschlaFile->keyStats[i].buckets;
+        if ((uint64_t)buckets.first + buckets.count > keyBucketCount) {
+            ERROR("section %s references more buckets than stored\n", buschlaSectionStrs[SECTION_KEY_STATS]);
+            ON_ERROR
+        }
+
+        BuschlaRange aggregates = buschlaFile->keyStats[i].aggregates;
+        uint32_t blockCount = (buschlaFile->keys[i].samples.count + BUSCHLA_AGGREGATE_BLOCK_SAMPLES - 1) / BUSCHLA_AGGREGATE_BLOCK_SAMPLES;
+        if ((uint64_t)aggregates.first + aggregates.count > header.sections[SECTION_KEY_AGGREGATES].count ||
+            (aggregates.count != 0 && aggregates.count != blockCount * 2)) {
+            ERROR("section %s references invalid aggregates\n", buschlaSectionStrs[SECTION_KEY_STATS]);
+            ON_ERROR
+        }
     }
 
     return buschlaFile;
 
 #undef ON_ERROR
-#undef SEEK
-#undef READ
 #undef ERROR
 }
 
 void freeBuschlaFile(BuschlaFile* file) {
     assert(file != NULL);
-    assert(file->header != NULL);
+    assert(file->mapping != NULL);
 
-    // NOTE: file->header is the owning pointer.
-    free(file->header);
+    unmapFile(file->mapping, file->mappingSize);
+    free(file->chunkStorePath);
+    free(file->chunkOffsets);
+    free(file->convertedSections);
+    for (uint32_t i = 0; i < BUSCHLA_TEXT_CACHE_BLOCKS; ++i) {
+        free(file->textCache[i].text);
+    }
     free(file);
 }
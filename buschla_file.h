@@ -1,48 +1,603 @@
 #pragma once
 
+#include <stddef.h>
+#include <string.h>
+
 #include "dynamic_array.h"
+#include "lexer.h"
 #include "util.h"
 
+// Log line while parsing, files store the lines as columns (see lineOffsets and lineNumbers).
 typedef struct {
     StrView str;
 
-    // TODO: Is this really needed?
+    // Line number in the input, 1-based.
     uint32_t lineNum;
 
 } LogLine;
 
 DEFINE_DYNAMIC_ARRAY(LogLines, LogLine)
 
+#define LOG_LEVELS(X) \
+    X(LOG_LEVEL_NONE) \
+    X(LOG_LEVEL_TRACE) \
+    X(LOG_LEVEL_DEBUG) \
+    X(LOG_LEVEL_INFO) \
+    X(LOG_LEVEL_WARNING) \
+    X(LOG_LEVEL_ERROR) \
+    X(LOG_LEVEL_FATAL)
+
+typedef enum {
+#define X(x) x,
+    LOG_LEVELS(X)
+#undef X
+    LOG_LEVEL_COUNT
+} LogLevel;
+
+extern const char* logLevelStrs[];
+
+// Starts a run of log lines whose line numbers count up from lineNum.
+// Files only store a run where the line numbers jump (skipped input lines, a switch between merged inputs),
+// lines before the first run are numbered from 1.
+typedef struct {
+    uint32_t line;
+    uint32_t lineNum;
+} BuschlaLineNumber;
+
+// Describes a contiguous run of items in another section.
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+} BuschlaRange;
+
+// Null-terminated string in the strings section.
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+} BuschlaString;
+
+// Subsystem tag at the start of a line, e.g. [Render]
+typedef struct {
+    BuschlaString name;
+    uint32_t lineCount;
+} BuschlaChannel;
+
+// Input file of a merged log (parser with several inputs).
+typedef struct {
+    BuschlaString name;
+    uint32_t lineCount;
+} BuschlaSource;
+
+// Stored in lineChannels for lines without a channel tag.
+#define BUSCHLA_CHANNEL_NONE 0xFFFF
+
+// Name of a numeric value, e.g. 'fps' in "fps: 60" or {"fps": 60}
+typedef struct {
+    BuschlaString name;
+    // Range of this key's samples in valueLines/values, sorted by line.
+    BuschlaRange samples;
+} BuschlaKey;
+
+typedef struct {
+    BuschlaString name;
+    // Range in keywordLines, sorted.
+    BuschlaRange lines;
+} BuschlaKeyword;
+
+// Identifier of something that shows up in many lines: a hex value like 0x7f3a10 (lower case), or
+// "<key>=<value>" for keys given to the parser with --entity-key (e.g. "player=42").
+typedef struct {
+    BuschlaString name;
+    // Range in entityLines, sorted.
+    BuschlaRange lines;
+} BuschlaEntity;
+
+// Key with string values, e.g. 'state' in "state: Loading" or {"state": "Loading"}
+// The values are dictionary encoded: every distinct value gets a code, the samples only store codes.
+typedef struct {
+    BuschlaString name;
+    // Range in fieldValues, indexed by code.
+    BuschlaRange values;
+    // Range of this field's samples in fieldLines, sorted by line.
+    BuschlaRange samples;
+    // Byte offset of the codes of the samples in fieldCodes, a multiple of codeSize.
+    uint32_t codeOffset;
+    // Size of a code in bytes, the smallest of 1, 2 or 4 that fits all codes.
+    uint32_t codeSize;
+} BuschlaField;
+
+// Entry of a field's dictionary.
+typedef struct {
+    BuschlaString str;
+    // Number of samples with this value.
+    uint32_t count;
+} BuschlaFieldValue;
+
+// Frame that took much longer than the frames around it.
+typedef struct {
+    // Value of the frame key on the frame time line, or the index of the frame if there is none.
+    uint32_t frame;
+    // Frame time (in the unit of the frame time key).
+    float duration;
+    // Median frame time of the frames before.
+    float median;
+    // Distance from the median in robust standard deviations (1.4826 * MAD).
+    float severity;
+    // Lines logged during this frame, the last one holds the frame time.
+    BuschlaRange lines;
+} BuschlaHitch;
+
+// Summary of all samples of a key, one per entry in keys.
+// The statistics and buckets can be merged, see value_sketch.h.
+typedef struct {
+    double min;
+    double max;
+    double mean;
+    // Sum of squared differences from the mean, the variance is m2 / count.
+    double m2;
+    // Samples that went into the sketch (NaNs are skipped).
+    uint32_t count;
+    // Range in keyBuckets, sorted by bucket (and so by value).
+    BuschlaRange buckets;
+    // Range in keyAggregates, the segment tree over the key's samples.
+    BuschlaRange aggregates;
+} BuschlaKeyStats;
+
+// A key's samples are grouped into blocks of this many for its segment tree.
+#define BUSCHLA_AGGREGATE_BLOCK_SAMPLES 64
+
+// Node of a segment tree over the sample blocks of a key, see buschlaKeyRangeStats.
+// For a key with n blocks the tree has 2 * n nodes: node 1 is the root, the children of node i are 2 * i and
+// 2 * i + 1, and block j is node n + j. Node 0 is unused.
+typedef struct {
+    double min;
+    double max;
+    double sum;
+} BuschlaAggregate;
+
+// Number of samples of a key that fell into a histogram bucket.
+typedef struct {
+    uint32_t bucket;
+    uint32_t count;
+} BuschlaBucket;
+
+// Values are bucketed by their sign, exponent and the top mantissa bits (like an HDR histogram),
+// so every bucket is at most 2^-BUSCHLA_BUCKET_MANTISSA_BITS of its value wide, at any magnitude.
+#define BUSCHLA_BUCKET_MANTISSA_BITS 6
+#define BUSCHLA_BUCKET_SHIFT (52 - BUSCHLA_BUCKET_MANTISSA_BITS)
+
+static inline uint32_t buschlaBucketOf(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    // Flip the bits so their unsigned order matches the order of the values.
+    bits = (bits >> 63) ? ~bits : bits | (1ull << 63);
+    return (uint32_t)(bits >> BUSCHLA_BUCKET_SHIFT);
+}
+
+// Returns the value in the middle of a bucket.
+static inline double buschlaBucketValue(uint32_t bucket)
+{
+    uint64_t bits = ((uint64_t)bucket << BUSCHLA_BUCKET_SHIFT) | (1ull << (BUSCHLA_BUCKET_SHIFT - 1));
+    bits = (bits >> 63) ? bits & ~(1ull << 63) : ~bits;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Lines that only differ in their numbers, e.g. "spawned entity # at #, #"
+typedef struct {
+    // Text of the first counted line, with every number replaced by '#'.
+    BuschlaString text;
+    // Number of lines, overestimated by at most error (see top_k.h).
+    uint32_t count;
+    uint32_t error;
+    // Log line indices of the first and last counted line.
+    uint32_t firstLine;
+    uint32_t lastLine;
+} BuschlaTemplate;
+
+// Pair of a "BEGIN <name>" and an "END <name>" line.
+// Scopes nest: a scope that begins inside another one ends inside it as well.
+typedef struct {
+    BuschlaString name;
+    // Log line indices of the BEGIN and END line (the last line for scopes that never end).
+    uint32_t firstLine;
+    uint32_t lastLine;
+    // 0 for scopes outside of any other scope.
+    uint32_t depth;
+    // Index of the enclosing scope, BUSCHLA_SCOPE_NONE at depth 0.
+    uint32_t parent;
+    // Milliseconds between the timestamps of both lines, or the last value on the END line if they have none.
+    // NAN if neither is known or the scope never ends.
+    float duration;
+} BuschlaScope;
+
+#define BUSCHLA_SCOPE_NONE 0xFFFFFFFF
+
+// An alert rule (parser --alert) went above its threshold.
+typedef struct {
+    // The rule as given to the parser, e.g. "OutOfMemory > 50 in 1000 frames".
+    BuschlaString rule;
+    // Log line index of the match that crossed the threshold.
+    uint32_t line;
+    // Matches in the rule's window at that line.
+    uint32_t count;
+} BuschlaAlert;
+
+// Piece of the text section kept in a chunk store (parser --chunk-store), see chunk_store.h.
+typedef struct {
+    // 128-bit hash of the content, names the chunk file.
+    uint64_t hash[2];
+    // Byte range in the text section, offset is stored modulo 2^32 (the chunks follow each other without gaps).
+    uint32_t offset;
+    uint32_t size;
+} BuschlaChunk;
+
+// Log lines in the text section are compressed in blocks of about this many bytes.
+// A block holds whole lines, longer lines get a block of their own.
+#define BUSCHLA_TEXT_BLOCK_SIZE (64u << 10)
+
+// Block of the compressed text (see lz_block.h), it decompresses to the text of lines firstLine up to the
+// firstLine of the next block (the last block goes to the last line).
+typedef struct {
+    // Byte range in textBlockData.
+    uint64_t offset;
+    uint32_t size;
+    uint32_t firstLine;
+} BuschlaTextBlock;
+
+// hash[i] is hashBytes(chunk, size, BUSCHLA_CHUNK_HASH_SEED_i).
+#define BUSCHLA_CHUNK_HASH_SEED_0 0
+#define BUSCHLA_CHUNK_HASH_SEED_1 0x2545F4914F6CDD1DULL
+
+// Chunks are stored as <store>/<first byte of the hash in hex>/<hash in hex>.
+static inline void buschlaChunkPath(const char* store, const BuschlaChunk* chunk, char* pathOut, size_t size)
+{
+    snprintf(pathOut, size, "%s/%02x/%016llx%016llx", store, (unsigned)(chunk->hash[0] >> 56),
+             (unsigned long long)chunk->hash[0], (unsigned long long)chunk->hash[1]);
+}
+
+// Returns the code of a field's sample (0 <= sampleIndex < field->samples.count), an index into its values.
+// Codes are not checked when the file is opened, compare them with field->values.count before indexing.
+static inline uint32_t buschlaFieldCode(const uint8_t* fieldCodes, const BuschlaField* field, uint32_t sampleIndex)
+{
+    const uint8_t* codes = fieldCodes + field->codeOffset;
+    switch (field->codeSize) {
+    case 1: return codes[sampleIndex];
+    case 2: return ((const uint16_t*)codes)[sampleIndex];
+    default: return ((const uint32_t*)codes)[sampleIndex];
+    }
+}
+
+// The parser stores the state of the keys every this many lines, see valueCheckpoints.
+#define BUSCHLA_CHECKPOINT_LINES 4096
+
+// Key has `before` samples on the lines before checkpoint (line checkpoint * BUSCHLA_CHECKPOINT_LINES).
+typedef struct {
+    uint32_t key;
+    uint32_t checkpoint;
+    uint32_t before;
+} BuschlaValueCheckpoint;
+
+// Returned by buschlaValuesAt for keys without a sample up to the line.
+#define BUSCHLA_SAMPLE_NONE 0xFFFFFFFF
+
+// Log lines are grouped into blocks of this many lines for the trigram index.
+#define BUSCHLA_TRIGRAM_BLOCK_LINES 256
+
+// Three consecutive bytes of a log line (byte 0 in bits 16..23, byte 2 in bits 0..7).
+#define BUSCHLA_TRIGRAM(a, b, c) (((uint32_t)(uint8_t)(a) << 16) | ((uint32_t)(uint8_t)(b) << 8) | (uint32_t)(uint8_t)(c))
+
+typedef struct {
+    uint32_t trigram;
+    // Range in trigramBlocks, sorted.
+    BuschlaRange blocks;
+} BuschlaTrigram;
+
+// Token of a log line packed into 32 bits, see BUSCHLA_TOKEN_*
+// - bits  0..3:  TokenKind
+// - bits  4..15: length in bytes
+// - bits 16..31: offset from the start of the line
+// Tokens that do not fit (very long lines or tokens) are not stored.
+typedef uint32_t BuschlaToken;
+
+#define BUSCHLA_TOKEN_MAX_LEN 0xFFF
+#define BUSCHLA_TOKEN_MAX_OFFSET 0xFFFF
+#define BUSCHLA_TOKEN(kind, offset, len) ((BuschlaToken)(kind) | ((BuschlaToken)(len) << 4) | ((BuschlaToken)(offset) << 16))
+#define BUSCHLA_TOKEN_KIND(token) ((TokenKind)((token) & 0xF))
+#define BUSCHLA_TOKEN_LEN(token) (((token) >> 4) & BUSCHLA_TOKEN_MAX_LEN)
+#define BUSCHLA_TOKEN_OFFSET(token) ((token) >> 16)
+
+// All sections of a .buschla file, in the order they are written.
+// X(id, name, item type)
+// - lineOffsets: log lines + 1 entries, the text of line i is [lineOffsets[i], lineOffsets[i + 1] - 1) in textBuffer
+//                (followed by its null terminator). The offsets are stored modulo 2^32.
+// - lineOffsetWraps: optional (text over 4GB), sorted indices of the entries in lineOffsets at which the offsets
+//                pass the next multiple of 2^32
+// - lineNumbers: runs of line numbers, sorted by line (see BuschlaLineNumber)
+// - textBuffer:  null-terminated text of all log lines
+// - levels:      LogLevel of each log line (1 byte per line)
+// - levelRanges: for each LogLevel, the range of its entries in levelLines
+// - levelLines:  indices of log lines, grouped by level and sorted within each level
+// - strings:     null-terminated strings referenced by BuschlaString
+// - channels:    channel dictionary, indexed by channel id
+// - lineChannels: channel id of each log line (BUSCHLA_CHANNEL_NONE if it has none)
+// - keys:        value keys, each references a column of samples in valueLines/values
+// - valueLines:  log line index of each sample
+// - values:      value of each sample
+// - fields:      string fields, each references its dictionary in fieldValues and its samples in fieldLines/fieldCodes
+// - fieldValues: dictionaries of all fields
+// - fieldLines:  log line index of each string sample
+// - fieldCodes:  code of each string sample, 1, 2 or 4 bytes depending on the field (see BuschlaField)
+// - keywords:    keyword dictionary, each references its postings in keywordLines
+// - keywordLines: indices of log lines containing a keyword
+// - entities:    entity dictionary, sorted by name, each references its postings in entityLines
+// - entityLines: indices of log lines mentioning an entity
+// - trigrams:    every trigram found in the text, sorted by trigram, each references its postings in trigramBlocks
+// - trigramBlocks: indices of line blocks (see BUSCHLA_TRIGRAM_BLOCK_LINES) containing a trigram
+// - hitches:     frame hitches, sorted by severity (worst first)
+// - tokens:      optional (parser --tokens), lexer tokens of all log lines
+// - lineTokens:  optional, log lines + 1 entries, the tokens of line i are [lineTokens[i], lineTokens[i + 1])
+// - valueCheckpoints: sorted by key and checkpoint, only the checkpoints that a key has new samples before
+//                (so at most one entry per sample), a key keeps its count of the previous entry until then
+// - keyStats:    statistics and histogram of each key's samples, indexed like keys
+// - keyBuckets:  non-empty histogram buckets of all keys
+// - keyAggregates: segment trees over the samples of all keys
+// - templates:   most frequent line templates, sorted by count (most first)
+// - sources:     optional (several inputs), input files of a merged log, indexed by source id
+// - lineSources: optional, source id of each log line, line numbers count the lines of that source
+// - scopes:      BEGIN/END scopes, sorted by first line (parents come before their children)
+// - alerts:      optional (parser --alert), every time an alert rule started firing, sorted by line
+// - textChunks:  optional, the text section split into chunks, sorted by offset
+// - chunkStore:  optional, null-terminated path of the chunk store holding textChunks
+// - textBlocks:  optional (not with --raw-text or textChunks), the text section compressed in blocks, sorted by firstLine
+// - textBlockData: optional, compressed data of all textBlocks
+//
+// If there are textChunks or textBlocks, the bytes of the text section are left out of the file:
+// every section after it is stored (offset of levels - offset of textBuffer) bytes before its offset.
+// The offsets and totalSize in the header always describe the file with the text in place.
+#define BUSCHLA_FILE_SECTIONS(X) \
+    X(SECTION_LINE_OFFSETS, lineOffsets, uint32_t) \
+    X(SECTION_LINE_OFFSET_WRAPS, lineOffsetWraps, uint32_t) \
+    X(SECTION_LINE_NUMBERS, lineNumbers, BuschlaLineNumber) \
+    X(SECTION_TEXT_BUFFER, textBuffer, char) \
+    X(SECTION_LEVELS, levels, uint8_t) \
+    X(SECTION_LEVEL_RANGES, levelRanges, BuschlaRange) \
+    X(SECTION_LEVEL_LINES, levelLines, uint32_t) \
+    X(SECTION_STRINGS, strings, char) \
+    X(SECTION_CHANNELS, channels, BuschlaChannel) \
+    X(SECTION_LINE_CHANNELS, lineChannels, uint16_t) \
+    X(SECTION_KEYS, keys, BuschlaKey) \
+    X(SECTION_VALUE_LINES, valueLines, uint32_t) \
+    X(SECTION_VALUES, values, double) \
+    X(SECTION_FIELDS, fields, BuschlaField) \
+    X(SECTION_FIELD_VALUES, fieldValues, BuschlaFieldValue) \
+    X(SECTION_FIELD_LINES, fieldLines, uint32_t) \
+    X(SECTION_FIELD_CODES, fieldCodes, uint8_t) \
+    X(SECTION_KEYWORDS, keywords, BuschlaKeyword) \
+    X(SECTION_KEYWORD_LINES, keywordLines, uint32_t) \
+    X(SECTION_ENTITIES, entities, BuschlaEntity) \
+    X(SECTION_ENTITY_LINES, entityLines, uint32_t) \
+    X(SECTION_TRIGRAMS, trigrams, BuschlaTrigram) \
+    X(SECTION_TRIGRAM_BLOCKS, trigramBlocks, uint32_t) \
+    X(SECTION_HITCHES, hitches, BuschlaHitch) \
+    X(SECTION_TOKENS, tokens, BuschlaToken) \
+    X(SECTION_LINE_TOKENS, lineTokens, uint32_t) \
+    X(SECTION_VALUE_CHECKPOINTS, valueCheckpoints, BuschlaValueCheckpoint) \
+    X(SECTION_KEY_STATS, keyStats, BuschlaKeyStats) \
+    X(SECTION_KEY_BUCKETS, keyBuckets, BuschlaBucket) \
+    X(SECTION_KEY_AGGREGATES, keyAggregates, BuschlaAggregate) \
+    X(SECTION_TEMPLATES, templates, BuschlaTemplate) \
+    X(SECTION_SOURCES, sources, BuschlaSource) \
+    X(SECTION_LINE_SOURCES, lineSources, uint16_t) \
+    X(SECTION_SCOPES, scopes, BuschlaScope) \
+    X(SECTION_ALERTS, alerts, BuschlaAlert) \
+    X(SECTION_TEXT_CHUNKS, textChunks, BuschlaChunk) \
+    X(SECTION_CHUNK_STORE, chunkStore, char) \
+    X(SECTION_TEXT_BLOCKS, textBlocks, BuschlaTextBlock) \
+    X(SECTION_TEXT_BLOCK_DATA, textBlockData, uint8_t)
+
+typedef enum {
+#define X(id, name, type) id,
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
+    SECTION_COUNT
+} BuschlaSectionId;
+
+extern const char* buschlaSectionStrs[];
+
+// Every section starts at an offset that is a multiple of this.
+#define BUSCHLA_SECTION_ALIGNMENT 8
+
+// Version 1 is the original format: a table of log lines followed by their text, it has no sections.
+// The loader converts it to sections when it is opened, which takes time proportional to the number of lines.
+// Version 2 stores sizes and offsets in 32 bits, which limits files to 4GB.
+// Version 3 stores them in 64 bits, the parser only writes it for files that need it.
+// Everything after the header is the same in both versions.
+// Both headers record how many sections they describe: sections are only ever appended to BUSCHLA_FILE_SECTIONS,
+// files with fewer sections load with the missing ones empty. Changing or removing a section needs a new version.
+#define BUSCHLA_FILE_VERSION_1 1
+#define BUSCHLA_FILE_VERSION_2 2
+#define BUSCHLA_FILE_VERSION_3 3
+
+typedef struct {
+    // Start of Section (offset in bytes)
+    uint64_t offset;
+    // Number of items in Section
+    // Only the text and textBlockData may have more than 2^32 - 1 items, everything else is indexed by uint32_t.
+    uint64_t count;
+    // Size of a single item (bytes)
+    uint32_t stride;
+    uint32_t reserved;
+} BuschlaFileSection;
+
 // NOTE: Any char* is relatively addressed (describes byte offset to string start from start of file)
+// This is the version 3 header, the loader converts version 2 headers to it.
 typedef struct {
     // B U S C H L A
     char magic[7];
 
     uint8_t version;
 
-    // Size of Header (bytes)
+    // Size of Header (bytes), only the first sectionCount entries of sections are stored.
     uint32_t headerSize;
+    // Number of sections in the file
+    uint32_t sectionCount;
 
     // Total Blob Size (bytes)
+    uint64_t totalSize;
+
+    BuschlaFileSection sections[SECTION_COUNT];
+} BuschlaFileHeader;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t count;
+    uint32_t stride;
+} BuschlaFileSectionV2;
+
+typedef struct {
+    char magic[7];
+    uint8_t version;
+    uint32_t headerSize;
+    uint32_t sectionCount;
     uint32_t totalSize;
+    BuschlaFileSectionV2 sections[SECTION_COUNT];
+} BuschlaFileHeaderV2;
 
-    // Number of Log Lines
+typedef struct {
+    char magic[7];
+    uint8_t version;
+    uint32_t headerSize;
+    uint32_t totalSize;
     uint32_t logLineCount;
-    // Size of a single Log Lines Array entry (bytes)
     uint32_t logLineStride;
-    // Start of Log Lines Array (offset in bytes)
     uint32_t logLinesOffset;
-
-    // Size of Text Buffer (bytes)
     uint32_t textBufferSize;
-    // Start of Text Buffer (offset in bytes)
     uint32_t textBufferOffset;
-} BuschlaFileHeader;
+} BuschlaFileHeaderV1;
+
+// Entry of the version 1 line table, txt is the offset of the text from the start of the file.
+typedef struct {
+    uint64_t txt;
+    uint32_t len;
+    uint32_t reserved;
+    uint32_t lineNum;
+    uint32_t reserved2;
+} BuschlaLogLineV1;
+
+// Size of a header that describes sectionCount sections.
+#define BUSCHLA_HEADER_SIZE(type, sectionCount) ((uint32_t)(offsetof(type, sections) + (sectionCount) * sizeof(((type*)0)->sections[0])))
 
+// Number of decompressed text blocks (or loaded runs of text chunks) kept by a BuschlaFile.
+#define BUSCHLA_TEXT_CACHE_BLOCKS 32
+
+typedef struct {
+    // Index in textBlocks (or the first of chunkCount textChunks), BUSCHLA_TEXT_BLOCK_NONE if the entry is unused.
+    uint32_t block;
+    uint32_t chunkCount;
+    uint32_t capacity;
+    // Value of textCacheClock when the block was last used.
+    uint64_t lastUse;
+    char* text;
+    // The block could not be decompressed, it is remembered so the error is only reported once.
+    bool damaged;
+} BuschlaTextCacheEntry;
+
+#define BUSCHLA_TEXT_BLOCK_NONE 0xFFFFFFFF
+
+// The file is mapped read-only, the sections point into the mapping and must not be written.
 typedef struct {
+    // Points to headerData, sections point into the mapping.
     BuschlaFileHeader* header;
-    LogLine* logLines;
+    BuschlaFileHeader headerData;
+
+    // Pointers to the start of each section, NULL if the section is empty.
+#define X(id, name, type) type* name;
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
+
+    const void* mapping;
+    size_t mappingSize;
+    // Chunked files only: the chunk store the text is read from, and the offset of every chunk in the text section
+    // (textChunks stores them modulo 2^32), followed by the size of the text section.
+    char* chunkStorePath;
+    uint64_t* chunkOffsets;
+    // Version 1 files only: the sections converted from the line table.
+    void* convertedSections;
+
+    // Compressed and chunked files only: the most recently used textBlocks or runs of textChunks (textBuffer is NULL).
+    BuschlaTextCacheEntry textCache[BUSCHLA_TEXT_CACHE_BLOCKS];
+    uint64_t textCacheClock;
 } BuschlaFile;
 
+static inline uint32_t buschlaLineCount(const BuschlaFile* file) {
+    uint64_t offsetCount = file->header->sections[SECTION_LINE_OFFSETS].count;
+    return offsetCount > 0 ? (uint32_t)(offsetCount - 1) : 0;
+}
+
+// Returns entry i of lineOffsets (0 <= i <= line count) as a full 64-bit offset into the text section.
+static inline uint64_t buschlaLineOffset(const BuschlaFile* file, uint32_t i) {
+    uint64_t high = 0;
+    uint32_t wrapCount = (uint32_t)file->header->sections[SECTION_LINE_OFFSET_WRAPS].count;
+    while (high < wrapCount && file->lineOffsetWraps[high] <= i) {
+        ++high;
+    }
+    return (high << 32) | file->lineOffsets[i];
+}
+
+// Returns the text of a log line (null-terminated), pointing into the text section.
+// In compressed and chunked files it points into the decompressed block (or the chunks read from the store),
+// which stays valid until BUSCHLA_TEXT_CACHE_BLOCKS other blocks have been used.
+// Lines that don't exist or whose text lies outside the text section (or in a damaged block) are returned empty.
+StrView buschlaLine(BuschlaFile* file, uint32_t lineIndex);
+
+// Returns the line number of a log line in its input, see BuschlaLineNumber.
+uint32_t buschlaLineNumber(BuschlaFile* file, uint32_t lineIndex);
+
+// Returns pointer into the strings section, "" if str lies outside of it.
+const char* buschlaString(BuschlaFile* file, BuschlaString str);
+
+// Returns the input file of a log line in a merged log, NULL if the file is not merged.
+const BuschlaSource* buschlaLineSource(BuschlaFile* file, uint32_t lineIndex);
+
+// Returns the number of stored tokens of a log line, tokensOut points into the tokens section.
+// Returns 0 if the file has no tokens.
+uint32_t buschlaLineTokens(BuschlaFile* file, uint32_t lineIndex, const BuschlaToken** tokensOut);
+
+// Appends the indices of all log lines containing needle (case sensitive) to linesOut, in order.
+// Only blocks that contain every trigram of the needle are scanned.
+// Needles shorter than 3 bytes (or files without trigrams) scan all lines.
+// Returns the number of lines found.
+uint32_t buschlaFindLines(BuschlaFile* file, StrView needle, Uint32s* linesOut);
+
+// Returns the entity with the given name (hex values in lower case), NULL if there is none.
+// Its lines are entityLines[lines.first .. lines.first + lines.count).
+const BuschlaEntity* buschlaFindEntity(BuschlaFile* file, StrView name);
+
+// Returns the value below which a fraction p (0..1) of the key's samples lie,
+// within the bucket precision and clamped to the key's min and max.
+// Returns NAN if the key has no samples.
+double buschlaKeyPercentile(BuschlaFile* file, uint32_t keyIndex, double p);
+
+// Computes min, max and sum of a key's samples on lines firstLine to lastLine (inclusive) into statsOut.
+// Whole sample blocks are taken from the key's segment tree, only the partial blocks at both ends are scanned.
+// Returns the number of samples, statsOut is left untouched if it is 0.
+uint32_t buschlaKeyRangeStats(BuschlaFile* file, uint32_t keyIndex, uint32_t firstLine, uint32_t lastLine, BuschlaAggregate* statsOut);
+
+// Writes the index (in valueLines/values) of each key's latest sample on or before the given line to samplesOut,
+// BUSCHLA_SAMPLE_NONE for keys without one. samplesOut has room for one entry per key.
+// Starts from the checkpoint before the line and only replays the samples since then.
+// Returns the number of keys that have a sample.
+uint32_t buschlaValuesAt(BuschlaFile* file, uint32_t lineIndex, uint32_t* samplesOut);
+
+// Appends the indices of all scopes that contain the given line to scopesOut, innermost first.
+// Returns the number of scopes found.
+uint32_t buschlaScopesAt(BuschlaFile* file, uint32_t lineIndex, Uint32s* scopesOut);
+
+// Maps the file, opening it does not depend on the number of lines (only the section layout is checked).
+// Chunked text is read from the chunk store recorded in the file, or from $BUSCHLA_CHUNK_STORE if that is set,
+// when the lines are used.
 BuschlaFile* tryLoadBuschlaFile(const char* fileName);
 void freeBuschlaFile(BuschlaFile* file);
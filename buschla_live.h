@@ -0,0 +1,364 @@
+#ifndef BUSCHLA_LIVE_H
+#define BUSCHLA_LIVE_H
+
+// Live ingest channel: a running game writes log lines into a shared-memory ring buffer,
+// buschla-parser --live <name> reads them and writes segmented .buschla files.
+//
+// Single header, plain C99 (also compiles as C++), drop it into the game source tree.
+// One producer (the game) and one consumer (buschla-parser) per channel.
+//
+// The producer never blocks: if the consumer falls behind and the ring is full,
+// the record is dropped and counted in droppedRecords.
+//
+// Game side:
+//     BuschlaLive live;
+//     buschla_live_create(&live, "mygame", 1 << 22);
+//     buschla_live_write(&live, "Frame: 12 time: 16.6", 20);
+//     buschla_live_printf(&live, "[Render] WARN slow frame %d", frame);
+//     buschla_live_close(&live);
+//
+// Consumer side:
+//     buschla_live_attach(&live, "mygame");
+//     while ((text = buschla_live_read(&live, &len)) != NULL) { ... }
+//     buschla_live_release(&live);
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define BUSCHLA_LIVE_VERSION 1
+#define BUSCHLA_LIVE_MAX_NAME 64
+// printf records are formatted on the stack, longer lines are truncated.
+#define BUSCHLA_LIVE_MAX_PRINTF 1024
+
+#define BUSCHLA_LIVE_RECORD_TEXT 1
+// Marks the unused end of the ring, the next record starts at offset 0.
+#define BUSCHLA_LIVE_RECORD_WRAP 2
+
+#define BUSCHLA_LIVE_STATE_RUNNING 1
+#define BUSCHLA_LIVE_STATE_CLOSED 2
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+// x86/x64 only: plain loads/stores are acquire/release, just keep the compiler from reordering.
+static inline uint64_t buschla_live_load_acquire(const uint64_t* p) { uint64_t v = *(volatile const uint64_t*)p; _ReadWriteBarrier(); return v; }
+static inline void buschla_live_store_release(uint64_t* p, uint64_t v) { _ReadWriteBarrier(); *(volatile uint64_t*)p = v; }
+#else
+static inline uint64_t buschla_live_load_acquire(const uint64_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void buschla_live_store_release(uint64_t* p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#endif
+
+// Lives at the start of the shared memory, followed by capacity bytes of ring data.
+// Positions only ever grow, the offset in the ring is (position & (capacity - 1)).
+// writePos and readPos are on their own cache lines, each is only written by one side.
+typedef struct {
+    // B U S C H L V, written last by the producer.
+    char magic[8];
+    uint32_t version;
+    // Size of the ring data (bytes), power of 2.
+    uint32_t capacity;
+    // BUSCHLA_LIVE_STATE_*
+    uint64_t state;
+    // Records the producer had to drop because the ring was full.
+    uint64_t droppedRecords;
+    uint8_t _pad0[32];
+
+    uint64_t writePos;
+    uint8_t _pad1[56];
+
+    uint64_t readPos;
+    uint8_t _pad2[56];
+} BuschlaLiveHeader;
+
+// Every record starts 8-byte aligned in the ring.
+typedef struct {
+    // Payload size (bytes), the record occupies BUSCHLA_LIVE_RECORD_SIZE(size) bytes.
+    uint32_t size;
+    // BUSCHLA_LIVE_RECORD_*
+    uint32_t kind;
+} BuschlaLiveRecord;
+
+#define BUSCHLA_LIVE_RECORD_SIZE(payloadSize) ((sizeof(BuschlaLiveRecord) + (payloadSize) + 7) & ~(uint64_t)7)
+
+typedef struct {
+    BuschlaLiveHeader* header;
+    uint8_t* data;
+    uint64_t mappedSize;
+    // Consumer only: position of the next record, published to readPos by buschla_live_release.
+    uint64_t cursor;
+    char shmName[BUSCHLA_LIVE_MAX_NAME + 16];
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+} BuschlaLive;
+
+static inline void _buschla_live_shm_name(BuschlaLive* live, const char* name)
+{
+#ifdef _WIN32
+    snprintf(live->shmName, sizeof(live->shmName), "Local\\buschla_%.*s", BUSCHLA_LIVE_MAX_NAME, name);
+#else
+    snprintf(live->shmName, sizeof(live->shmName), "/buschla_%.*s", BUSCHLA_LIVE_MAX_NAME, name);
+#endif
+}
+
+// Maps size bytes of the named shared memory, creates it if create is set.
+// size 0 maps the existing memory with its current size.
+static inline int _buschla_live_map(BuschlaLive* live, uint64_t size, int create)
+{
+#ifdef _WIN32
+    if (create) {
+        live->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, live->shmName);
+    }
+    else {
+        live->mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, live->shmName);
+    }
+    if (live->mapping == NULL) {
+        return 0;
+    }
+
+    void* memory = MapViewOfFile(live->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+    if (memory == NULL) {
+        CloseHandle(live->mapping);
+        return 0;
+    }
+
+    if (size == 0) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(memory, &info, sizeof(info));
+        size = info.RegionSize;
+    }
+#else
+    int fd;
+    if (create) {
+        // A crashed producer may have left an old ring behind.
+        shm_unlink(live->shmName);
+        fd = shm_open(live->shmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0 && ftruncate(fd, (off_t)size) != 0) {
+            close(fd);
+            shm_unlink(live->shmName);
+            return 0;
+        }
+    }
+    else {
+        fd = shm_open(live->shmName, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (size == 0) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(BuschlaLiveHeader)) {
+            close(fd);
+            return 0;
+        }
+        size = (uint64_t)st.st_size;
+    }
+
+    void* memory = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return 0;
+    }
+#endif
+
+    live->header = (BuschlaLiveHeader*)memory;
+    live->data = (uint8_t*)memory + sizeof(BuschlaLiveHeader);
+    live->mappedSize = size;
+    return 1;
+}
+
+static inline void _buschla_live_unmap(BuschlaLive* live)
+{
+    if (live->header == NULL) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(live->header);
+    CloseHandle(live->mapping);
+#else
+    munmap(live->header, (size_t)live->mappedSize);
+#endif
+    live->header = NULL;
+    live->data = NULL;
+}
+
+// Producer: creates the channel, capacity is rounded up to a power of 2.
+// Returns 0 on error.
+static inline int buschla_live_create(BuschlaLive* live, const char* name, uint32_t capacity)
+{
+    memset(live, 0, sizeof(BuschlaLive));
+    _buschla_live_shm_name(live, name);
+
+    uint32_t ringSize = 4096;
+    while (ringSize < capacity && ringSize < 0x80000000u) {
+        ringSize <<= 1;
+    }
+
+    if (!_buschla_live_map(live, sizeof(BuschlaLiveHeader) + (uint64_t)ringSize, 1)) {
+        return 0;
+    }
+
+    BuschlaLiveHeader* header = live->header;
+    memset(header, 0, sizeof(BuschlaLiveHeader));
+    header->version = BUSCHLA_LIVE_VERSION;
+    header->capacity = ringSize;
+    header->state = BUSCHLA_LIVE_STATE_RUNNING;
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+    memcpy(header->magic, "BUSCHLV", 8);
+    return 1;
+}
+
+// Consumer: attaches to a channel created by the producer.
+// Returns 0 if there is no (fully initialized) channel with this name yet.
+static inline int buschla_live_attach(BuschlaLive* live, const char* name)
+{
+    memset(live, 0, sizeof(BuschlaLive));
+    _buschla_live_shm_name(live, name);
+
+    if (!_buschla_live_map(live, 0, 0)) {
+        return 0;
+    }
+
+    BuschlaLiveHeader* header = live->header;
+    if (memcmp(header->magic, "BUSCHLV", 8) != 0 ||
+            header->version != BUSCHLA_LIVE_VERSION ||
+            sizeof(BuschlaLiveHeader) + (uint64_t)header->capacity > live->mappedSize) {
+        _buschla_live_unmap(live);
+        return 0;
+    }
+
+    live->cursor = buschla_live_load_acquire(&header->readPos);
+    return 1;
+}
+
+// Producer: copies one log line into the ring (without trailing newline).
+// Returns 0 if the line was dropped because the ring is full.
+static inline int buschla_live_write(BuschlaLive* live, const char* text, uint32_t size)
+{
+    BuschlaLiveHeader* header = live->header;
+    uint32_t capacity = header->capacity;
+    uint64_t recordSize = BUSCHLA_LIVE_RECORD_SIZE(size);
+    if (recordSize > capacity / 2) {
+        ++header->droppedRecords;
+        return 0;
+    }
+
+    // writePos is only written by us, no need to synchronize.
+    uint64_t writePos = header->writePos;
+    uint64_t readPos = buschla_live_load_acquire(&header->readPos);
+
+    uint32_t offset = (uint32_t)(writePos & (capacity - 1));
+    uint32_t tail = capacity - offset;
+    uint64_t required = recordSize + (tail < recordSize ? tail : 0);
+    if (writePos + required - readPos > capacity) {
+        ++header->droppedRecords;
+        return 0;
+    }
+
+    // Records never wrap around, skip the end of the ring instead.
+    if (tail < recordSize) {
+        BuschlaLiveRecord* wrap = (BuschlaLiveRecord*)(live->data + offset);
+        wrap->size = tail - (uint32_t)sizeof(BuschlaLiveRecord);
+        wrap->kind = BUSCHLA_LIVE_RECORD_WRAP;
+        writePos += tail;
+        offset = 0;
+    }
+
+    BuschlaLiveRecord* record = (BuschlaLiveRecord*)(live->data + offset);
+    record->size = size;
+    record->kind = BUSCHLA_LIVE_RECORD_TEXT;
+    memcpy(record + 1, text, size);
+
+    buschla_live_store_release(&header->writePos, writePos + recordSize);
+    return 1;
+}
+
+static inline int buschla_live_printf(BuschlaLive* live, const char* fmt, ...)
+{
+    char buffer[BUSCHLA_LIVE_MAX_PRINTF];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return 0;
+    }
+    if (len >= (int)sizeof(buffer)) {
+        len = (int)sizeof(buffer) - 1;
+    }
+    return buschla_live_write(live, buffer, (uint32_t)len);
+}
+
+// Consumer: returns the next line (not null-terminated) or NULL if the ring is empty.
+// The returned memory stays valid until buschla_live_release.
+static inline const char* buschla_live_read(BuschlaLive* live, uint32_t* sizeOut)
+{
+    BuschlaLiveHeader* header = live->header;
+    uint32_t capacity = header->capacity;
+    uint64_t writePos = buschla_live_load_acquire(&header->writePos);
+
+    while (live->cursor < writePos) {
+        uint32_t offset = (uint32_t)(live->cursor & (capacity - 1));
+        BuschlaLiveRecord* record = (BuschlaLiveRecord*)(live->data + offset);
+        if (record->kind == BUSCHLA_LIVE_RECORD_WRAP) {
+            live->cursor += capacity - offset;
+            continue;
+        }
+
+        live->cursor += BUSCHLA_LIVE_RECORD_SIZE(record->size);
+        *sizeOut = record->size;
+        return (const char*)(record + 1);
+    }
+
+    return NULL;
+}
+
+// Consumer: hands all lines returned by buschla_live_read back to the producer.
+static inline void buschla_live_release(BuschlaLive* live)
+{
+    buschla_live_store_release(&live->header->readPos, live->cursor);
+}
+
+// Consumer: true once the producer closed the channel, read the remaining lines before detaching.
+static inline int buschla_live_closed(BuschlaLive* live)
+{
+    return buschla_live_load_acquire(&live->header->state) == BUSCHLA_LIVE_STATE_CLOSED;
+}
+
+// Producer: marks the channel as closed and unmaps it.
+static inline void buschla_live_close(BuschlaLive* live)
+{
+    if (live->header != NULL) {
+        buschla_live_store_release(&live->header->state, BUSCHLA_LIVE_STATE_CLOSED);
+    }
+    _buschla_live_unmap(live);
+}
+
+// Consumer: unmaps the channel, removes it if the producer is done with it.
+static inline void buschla_live_detach(BuschlaLive* live)
+{
+    if (live->header != NULL && buschla_live_closed(live)) {
+#ifndef _WIN32
+        shm_unlink(live->shmName);
+#endif
+    }
+    _buschla_live_unmap(live);
+}
+
+#endif // BUSCHLA_LIVE_H
@@ -0,0 +1,289 @@
+#ifndef BUSCHLA_LOG_H
+#define BUSCHLA_LOG_H
+
+// Binary structured logging: instead of formatting log lines to text, the game writes
+// the format string once and then only its id, frame, timestamp and the raw arguments.
+// buschla-parser --dialect binary <file> turns these records into a .buschla file without lexing.
+//
+// Single header, plain C99 (also compiles as C++), drop it into the game source tree.
+//
+//     BuschlaLogger logger;
+//     buschla_log_open(&logger, "game.bblog");
+//     buschla_log_set_frame(&logger, frame);
+//     BUSCHLA_LOG(&logger, "[Render] INFO fps: %f draw calls: %u", fps, drawCalls);
+//     buschla_log_close(&logger);
+//
+// Format strings use printf conversions (%d %i %u %x %X %o %c %f %e %g %s, with flags, width,
+// precision and length modifiers). %n and '*' width/precision are not supported.
+// Format ids are cached at the call site, use a single logger per process.
+// Not thread safe.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define BUSCHLA_LOG_VERSION 1
+#define BUSCHLA_LOG_MAX_ARGS 16
+#define BUSCHLA_LOG_BUFFER_SIZE (64 * 1024)
+
+// Stream layout: "BUSCHLB" + version byte, followed by records.
+// Each record starts with a kind byte, all integers are little endian.
+// - FORMAT: u32 id, u8 argCount, u8 argTypes[argCount], u32 length, char text[length]
+//   Written once per format string, before its first event.
+// - EVENT:  u32 formatId, u64 frame, u64 timestampNs, arguments in format order:
+//   I64/U64/F64 as 8 bytes, STR as u32 length + bytes (not null-terminated)
+#define BUSCHLA_LOG_RECORD_FORMAT 1
+#define BUSCHLA_LOG_RECORD_EVENT 2
+
+#define BUSCHLA_LOG_ARG_I64 1
+#define BUSCHLA_LOG_ARG_U64 2
+#define BUSCHLA_LOG_ARG_F64 3
+#define BUSCHLA_LOG_ARG_STR 4
+
+// Per call site, filled on first use.
+typedef struct {
+    // 0 until registered.
+    uint32_t id;
+    uint8_t argCount;
+    uint8_t argTypes[BUSCHLA_LOG_MAX_ARGS];
+    // How each argument is passed through varargs (BUSCHLA_LOG_VA_*).
+    uint8_t argPassing[BUSCHLA_LOG_MAX_ARGS];
+} BuschlaLogFormat;
+
+#define BUSCHLA_LOG_VA_INT 1
+#define BUSCHLA_LOG_VA_LONG 2
+#define BUSCHLA_LOG_VA_LONG_LONG 3
+#define BUSCHLA_LOG_VA_SIZE 4
+#define BUSCHLA_LOG_VA_DOUBLE 5
+#define BUSCHLA_LOG_VA_STRING 6
+
+typedef struct {
+    FILE* file;
+    uint64_t frame;
+    uint32_t formatCount;
+    uint32_t bufferCount;
+    uint8_t buffer[BUSCHLA_LOG_BUFFER_SIZE];
+} BuschlaLogger;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BUSCHLA_LOG_PRINTF_CHECK(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+#define BUSCHLA_LOG_PRINTF_CHECK(fmtIndex, argIndex)
+#endif
+
+static inline uint64_t buschla_log_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline void buschla_log_flush(BuschlaLogger* logger)
+{
+    if (logger->bufferCount > 0) {
+        fwrite(logger->buffer, 1, logger->bufferCount, logger->file);
+        logger->bufferCount = 0;
+    }
+}
+
+static inline void _buschla_log_bytes(BuschlaLogger* logger, const void* data, uint32_t size)
+{
+    if (logger->bufferCount + size > BUSCHLA_LOG_BUFFER_SIZE) {
+        buschla_log_flush(logger);
+        if (size > BUSCHLA_LOG_BUFFER_SIZE) {
+            fwrite(data, 1, size, logger->file);
+            return;
+        }
+    }
+    memcpy(logger->buffer + logger->bufferCount, data, size);
+    logger->bufferCount += size;
+}
+
+static inline void _buschla_log_u8(BuschlaLogger* logger, uint8_t value) { _buschla_log_bytes(logger, &value, 1); }
+static inline void _buschla_log_u32(BuschlaLogger* logger, uint32_t value) { _buschla_log_bytes(logger, &value, 4); }
+static inline void _buschla_log_u64(BuschlaLogger* logger, uint64_t value) { _buschla_log_bytes(logger, &value, 8); }
+
+// Returns 0 if the file could not be opened.
+static inline int buschla_log_open(BuschlaLogger* logger, const char* path)
+{
+    memset(logger, 0, sizeof(BuschlaLogger));
+    logger->file = fopen(path, "wb");
+    if (logger->file == NULL) {
+        return 0;
+    }
+
+    _buschla_log_bytes(logger, "BUSCHLB", 7);
+    _buschla_log_u8(logger, BUSCHLA_LOG_VERSION);
+    return 1;
+}
+
+static inline void buschla_log_close(BuschlaLogger* logger)
+{
+    if (logger->file != NULL) {
+        buschla_log_flush(logger);
+        fclose(logger->file);
+        logger->file = NULL;
+    }
+}
+
+static inline void buschla_log_set_frame(BuschlaLogger* logger, uint64_t frame)
+{
+    logger->frame = frame;
+}
+
+// Derives the argument types from the printf conversions and writes the FORMAT record.
+static inline void _buschla_log_register(BuschlaLogger* logger, BuschlaLogFormat* format, const char* fmt)
+{
+    format->argCount = 0;
+    for (const char* p = fmt; *p != '\0'; ++p) {
+        if (*p != '%') {
+            continue;
+        }
+        ++p;
+        if (*p == '%') {
+            continue;
+        }
+
+        while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL) {
+            ++p;
+        }
+
+        int longs = 0;
+        int size = 0;
+        int longDouble = 0;
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) {
+            longs += (*p == 'l' || *p == 'q') ? 1 : 0;
+            size |= (*p == 'z' || *p == 't' || *p == 'j');
+            longDouble |= (*p == 'L');
+            longs += (*p == 'q' || *p == 'j') ? 1 : 0;
+            ++p;
+        }
+
+        uint8_t type = 0;
+        uint8_t passing = 0;
+        switch (*p) {
+        case 'd':
+        case 'i':
+            type = BUSCHLA_LOG_ARG_I64;
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            type = BUSCHLA_LOG_ARG_U64;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            type = BUSCHLA_LOG_ARG_F64;
+            passing = BUSCHLA_LOG_VA_DOUBLE;
+            break;
+        case 's':
+            type = BUSCHLA_LOG_ARG_STR;
+            passing = BUSCHLA_LOG_VA_STRING;
+            break;
+        }
+
+        if (type == 0 || longDouble || format->argCount == BUSCHLA_LOG_MAX_ARGS) {
+            // Unsupported conversion (long double isn't captured either), stop here. The remaining arguments are not logged.
+            break;
+        }
+        if (passing == 0) {
+            passing = size ? BUSCHLA_LOG_VA_SIZE : longs >= 2 ? BUSCHLA_LOG_VA_LONG_LONG : longs == 1 ? BUSCHLA_LOG_VA_LONG : BUSCHLA_LOG_VA_INT;
+        }
+
+        format->argTypes[format->argCount] = type;
+        format->argPassing[format->argCount] = passing;
+        ++format->argCount;
+        if (*p == '\0') {
+            break;
+        }
+    }
+
+    format->id = ++logger->formatCount;
+
+    uint32_t length = (uint32_t)strlen(fmt);
+    _buschla_log_u8(logger, BUSCHLA_LOG_RECORD_FORMAT);
+    _buschla_log_u32(logger, format->id);
+    _buschla_log_u8(logger, format->argCount);
+    _buschla_log_bytes(logger, format->argTypes, format->argCount);
+    _buschla_log_u32(logger, length);
+    _buschla_log_bytes(logger, fmt, length);
+}
+
+static inline void buschla_log_write(BuschlaLogger* logger, BuschlaLogFormat* format, const char* fmt, ...) BUSCHLA_LOG_PRINTF_CHECK(3, 4);
+
+static inline void buschla_log_write(BuschlaLogger* logger, BuschlaLogFormat* format, const char* fmt, ...)
+{
+    if (format->id == 0) {
+        _buschla_log_register(logger, format, fmt);
+    }
+
+    _buschla_log_u8(logger, BUSCHLA_LOG_RECORD_EVENT);
+    _buschla_log_u32(logger, format->id);
+    _buschla_log_u64(logger, logger->frame);
+    _buschla_log_u64(logger, buschla_log_now());
+
+    va_list args;
+    va_start(args, fmt);
+    for (uint8_t i = 0; i < format->argCount; ++i) {
+        int isSigned = format->argTypes[i] == BUSCHLA_LOG_ARG_I64;
+        uint64_t bits = 0;
+        switch (format->argPassing[i]) {
+        case BUSCHLA_LOG_VA_INT:
+            bits = isSigned ? (uint64_t)(int64_t)va_arg(args, int) : (uint64_t)va_arg(args, unsigned int);
+            break;
+        case BUSCHLA_LOG_VA_LONG:
+            bits = isSigned ? (uint64_t)(int64_t)va_arg(args, long) : (uint64_t)va_arg(args, unsigned long);
+            break;
+        case BUSCHLA_LOG_VA_LONG_LONG:
+            bits = isSigned ? (uint64_t)va_arg(args, long long) : (uint64_t)va_arg(args, unsigned long long);
+            break;
+        case BUSCHLA_LOG_VA_SIZE:
+            bits = (uint64_t)va_arg(args, size_t);
+            break;
+        case BUSCHLA_LOG_VA_DOUBLE: {
+            double value = va_arg(args, double);
+            memcpy(&bits, &value, 8);
+        } break;
+        case BUSCHLA_LOG_VA_STRING: {
+            const char* str = va_arg(args, const char*);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            uint32_t length = (uint32_t)strlen(str);
+            _buschla_log_u32(logger, length);
+            _buschla_log_bytes(logger, str, length);
+        } continue;
+        }
+        _buschla_log_u64(logger, bits);
+    }
+    va_end(args);
+}
+
+// BUSCHLA_LOG(logger, format, args...)
+#define BUSCHLA_LOG(logger, ...) do { \
+    static BuschlaLogFormat _buschlaLogFormat; \
+    buschla_log_write((logger), &_buschlaLogFormat, __VA_ARGS__); \
+} while (0)
+
+#endif // BUSCHLA_LOG_H
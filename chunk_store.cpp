@@ -0,0 +1,122 @@
+#include "chunk_store.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Random value per byte, generated with splitmix64 from a fixed seed.
+// Changing it moves all chunk boundaries, existing stores would no longer be shared with new files.
+static uint64_t _cw_gear[256];
+
+static bool _cw_init_gear(void) {
+    uint64_t state = 0x6275736368ULL;
+    for (int i = 0; i < 256; ++i) {
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        _cw_gear[i] = z ^ (z >> 31);
+    }
+    return true;
+}
+
+// Filled before main, so writers on several threads never race for it.
+static const bool _cw_gear_initialized = _cw_init_gear();
+
+static bool _cw_make_directory(const char* path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "mkdir(%s): %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool cw_init(ChunkWriter* writer, const char* store) {
+    assert(_cw_gear_initialized);
+    memset(writer, 0, sizeof(ChunkWriter));
+    writer->store = store;
+    return _cw_make_directory(store);
+}
+
+static void _cw_store_chunk(ChunkWriter* writer) {
+    if (writer->bufferCount == 0) {
+        return;
+    }
+
+    BuschlaChunk* chunk = da_append_get(&writer->chunks);
+    chunk->hash[0] = hashBytes(writer->buffer, writer->bufferCount, BUSCHLA_CHUNK_HASH_SEED_0);
+    chunk->hash[1] = hashBytes(writer->buffer, writer->bufferCount, BUSCHLA_CHUNK_HASH_SEED_1);
+    chunk->offset = writer->offset;
+    chunk->size = writer->bufferCount;
+
+    writer->offset += writer->bufferCount;
+    writer->rollingHash = 0;
+
+    char path[PATH_MAX + 64];
+    buschlaChunkPath(writer->store, chunk, path, sizeof(path));
+    struct stat existing;
+    if (stat(path, &existing) == 0 && (uint64_t)existing.st_size == chunk->size) {
+        writer->bufferCount = 0;
+        return;
+    }
+
+    // Create the fan-out directory (path up to the last '/').
+    char directory[PATH_MAX + 64];
+    snprintf(directory, sizeof(directory), "%s", path);
+    *strrchr(directory, '/') = '\0';
+    char tmpPath[PATH_MAX + 80];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", path);
+
+    int fd = -1;
+    if (_cw_make_directory(directory)) {
+        fd = mkstemp(tmpPath);
+    }
+    bool ok = fd != -1 && write(fd, writer->buffer, writer->bufferCount) == (ssize_t)writer->bufferCount;
+    if (fd != -1) {
+        ok = close(fd) == 0 && ok;
+        // mkstemp creates the file readable only by us, chunks are shared with everyone who opens the files.
+        ok = ok && chmod(tmpPath, 0644) == 0;
+        ok = ok && rename(tmpPath, path) == 0;
+        if (!ok) {
+            unlink(tmpPath);
+        }
+    }
+
+    if (ok) {
+        ++writer->newChunkCount;
+        writer->newChunkBytes += writer->bufferCount;
+    }
+    else {
+        fprintf(stderr, "cannot store chunk '%s': %s\n", path, strerror(errno));
+        writer->failed = true;
+    }
+    writer->bufferCount = 0;
+}
+
+void cw_write(ChunkWriter* writer, const void* data, uint32_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (uint32_t i = 0; i < size; ++i) {
+        writer->buffer[writer->bufferCount++] = (char)bytes[i];
+        writer->rollingHash = (writer->rollingHash << 1) + _cw_gear[bytes[i]];
+
+        // The high bits of the gear hash depend on the last 64 bytes, the low bits on fewer.
+        bool boundary = writer->bufferCount >= CHUNK_MIN_SIZE && ((writer->rollingHash >> 32) & CHUNK_BOUNDARY_MASK) == 0;
+        if (boundary || writer->bufferCount == CHUNK_MAX_SIZE) {
+            _cw_store_chunk(writer);
+        }
+    }
+}
+
+bool cw_finish(ChunkWriter* writer) {
+    _cw_store_chunk(writer);
+    return !writer->failed;
+}
+
+void cw_free(ChunkWriter* writer) {
+    da_free(&writer->chunks);
+    memset(writer, 0, sizeof(ChunkWriter));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "buschla_file.h"
+#include "dynamic_array.h"
+
+// Splits a byte stream into content-defined chunks and stores every distinct chunk once in a directory
+// that is shared by many .buschla files (see BuschlaChunk).
+// Boundaries are found with a gear rolling hash (like FastCDC), so they only depend on the bytes right
+// before them: text inserted or changed in one place only changes the chunks around it, and the logs of
+// similar runs end up referencing mostly the same chunks.
+// Chunk files are written to a temporary file and renamed, several writers can share a store.
+
+#define CHUNK_MIN_SIZE (1u << 10)
+#define CHUNK_MAX_SIZE (16u << 10)
+// A boundary is placed where the low bits of the rolling hash are zero, about every 4KB after CHUNK_MIN_SIZE.
+#define CHUNK_BOUNDARY_MASK ((1ull << 12) - 1)
+
+DEFINE_DYNAMIC_ARRAY(BuschlaChunks, BuschlaChunk)
+
+typedef struct {
+    const char* store;
+
+    // Bytes of the current chunk.
+    char buffer[CHUNK_MAX_SIZE];
+    uint32_t bufferCount;
+    uint64_t rollingHash;
+    // Offset of the current chunk in the stream, wraps around after 4GB like BuschlaChunk::offset.
+    uint32_t offset;
+
+    BuschlaChunks chunks;
+    // Chunks that were not in the store yet.
+    uint32_t newChunkCount;
+    uint64_t newChunkBytes;
+    bool failed;
+} ChunkWriter;
+
+// Creates the store directory if needed, returns false if it cannot be created.
+bool cw_init(ChunkWriter* writer, const char* store);
+
+void cw_write(ChunkWriter* writer, const void* data, uint32_t size);
+
+// Stores the last chunk. Returns false if any chunk could not be stored.
+bool cw_finish(ChunkWriter* writer);
+
+void cw_free(ChunkWriter* writer);
@@ -41,7 +41,8 @@ static int _DirWatcher_ChildProc(void* arg) {
     // This ensures the child proc is also terminated if the parent crashes or exits.
     prctl(PR_SET_PDEATHSIG, SIGTERM);
 
-    int notifyFd = inotify_init1(IN_NONBLOCK);
+    // Blocking, the child has nothing else to do while waiting.
+    int notifyFd = inotify_init1(0);
     if (notifyFd == -1) {
         perror("_DirWatcher_ChildProc  inotify_init1");
         return 1;
@@ -54,7 +55,8 @@ static int _DirWatcher_ChildProc(void* arg) {
     int wds[DIRWATCHER_MAX_DIRECTORIES];
     for (int i = 0; i < state->config.directoryCount; ++i) {
         const char* path = state->config.directories[i];
-        wds[i] = inotify_add_watch(notifyFd, path, IN_CLOSE_WRITE);
+        // Files renamed into the directory are finished as well (editors and copy tools write a temporary file first).
+        wds[i] = inotify_add_watch(notifyFd, path, IN_CLOSE_WRITE | IN_MOVED_TO);
         if (wds[i] == -1) {
             fprintf(stderr, "[DirWatcher] Cannot watch '%s': %s\n", path, strerror(errno));
         }
@@ -68,7 +70,7 @@ static int _DirWatcher_ChildProc(void* arg) {
         //usleep(1000);
         //printf("child reading notify\n");
         ssize_t size = read(notifyFd, eventBuffer, sizeof(eventBuffer));
-        if (size == -1 && errno != EAGAIN) {
+        if (size == -1 && errno != EINTR) {
             perror("_DirWatcher_ChildProc  read notifyFd");
             return 1;
         }
@@ -95,7 +97,7 @@ static int _DirWatcher_ChildProc(void* arg) {
         char path[PATH_MAX];
         for (ssize_t i = 0; i < size; i += sizeof(struct inotify_event)) {
             struct inotify_event* notifyEvent = (struct inotify_event*)(eventBuffer + i);
-            if (notifyEvent->mask & IN_CLOSE_WRITE) {
+            if (notifyEvent->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
                 int directoryIndex = -1;
                 for (int j = 0; j < state->config.directoryCount; ++j) {
                     if (wds[j] == notifyEvent->wd) {
@@ -124,7 +126,7 @@ static int _DirWatcher_ChildProc(void* arg) {
 
                     char* fileName = splitAtLastOccurence(pathPtr, '/');
                     const char* extension = splitAtLastOccurence(fileName, '.');
-                    if (_shouldTriggerBuild(fileName, extension)) {
+                    if (state->config.reactionCommand != NULL && _shouldTriggerBuild(fileName, extension)) {
                         triggerBuild = true;
                     }
                 }
@@ -171,7 +173,7 @@ static int _DirWatcher_ChildProc(void* arg) {
             dup2(p.writeFd, STDOUT_FILENO);
             dup2(p.writeFd, STDERR_FILENO);
             // now we should be able to read from the pipe and get both stdout and stderr
-            watcherEvent->reactionReport.exitStatus = system("make app");
+            watcherEvent->reactionReport.exitStatus = system(state->config.reactionCommand);
 
             ssize_t size = read(p.readFd, stringBuffer, BUFFER_STRING_AREA_SIZE);
             if (size == -1) {
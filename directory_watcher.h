@@ -18,6 +18,10 @@ typedef enum DirWatcherEventType {
 typedef struct {
     const char* directories[DIRWATCHER_MAX_DIRECTORIES];
     int directoryCount;
+
+    // Run when a source file changes, its output is sent as DIRWATCHER_EVENT_REACTION_REPORT.
+    // NULL to only report changed files.
+    const char* reactionCommand;
 } DirWatcherConfig;
 
 typedef struct {
@@ -92,21 +92,27 @@ char* ca_commit(Chars* chars, const char* str) {
 static CharsChunk* _ca_get_chunk(Chars* chars, uint32_t requiredSpace) {
     _printf("%s: search for chunk with atleast %u free space\n", __FUNCTION__, requiredSpace);
 
-    for (uint32_t i = 0; i < chars->count; ++i) {
-        uint32_t chunkCount = chars->items[i].count;
-        uint32_t freeSpace = CHARS_CHUNK_SIZE - chunkCount;
+    // NOTE: Only the last chunk is considered, searching all chunks made committing
+    // O(number of chunks), which is way too slow when storing the text of millions of log lines.
+    if (chars->count > 0) {
+        CharsChunk* last = chars->items + (chars->count - 1);
+        uint32_t freeSpace = last->capacity - last->count;
         if (freeSpace >= requiredSpace) {
-            _printf("%s: found enough space in chunk with index %u\n", __FUNCTION__, i);
-            return chars->items + i;
+            _printf("%s: found enough space in chunk with index %u\n", __FUNCTION__, chars->count - 1);
+            return last;
         }
     }
 
     _printf("%s: allocating new chunk\n", __FUNCTION__);
 
+    uint32_t capacity = requiredSpace > CHARS_CHUNK_SIZE ? requiredSpace : CHARS_CHUNK_SIZE;
+
     CharsChunk* chunk = da_append_get(chars);
-    chunk->content = (char*)malloc(CHARS_CHUNK_SIZE);
+    chunk->content = (char*)malloc(capacity);
+    assert(chunk->content != NULL && "Buy more RAM lel");
     chunk->count = 0;
     chunk->strCount = 0;
+    chunk->capacity = capacity;
 
     return chunk;
 }
@@ -118,8 +124,8 @@ char* ca_commit_view(Chars* chars, StrView view) {
     }
 
     // MEH! We kinda have to include a null terminator, so std lib functions work with this nicely...
+    // Strings longer than CHARS_CHUNK_SIZE get a chunk of their own.
     uint32_t requiredSpace = view.len + 1;
-    assert(requiredSpace <= CHARS_CHUNK_SIZE);
 
     _printf("%s: trying to commit str with len %u\n", __FUNCTION__, view.len);
 
@@ -150,7 +156,6 @@ char* ca_commitf(Chars* chars, const char* fmt, ...) {
     assert(requiredSize >= 0 && "ca_commitf: first call to vsnprintf returned a negative value");
 
     uint32_t requiredSpace = (uint32_t)requiredSize + 1;
-    assert(requiredSpace <= CHARS_CHUNK_SIZE);
 
     _printf("%s: trying to commit formatted str with fmt '%s' required space: %u.\n", __FUNCTION__, fmt, requiredSpace);
 
@@ -181,6 +186,13 @@ void ca_reset(Chars* chars) {
     }
 }
 
+void ca_free(Chars* chars) {
+    for (uint32_t i = 0; i < chars->count; ++i) {
+        free(chars->items[i].content);
+    }
+    da_free(chars);
+}
+
 void ca_dump(FILE* stream, Chars* chars) {
     fprintf(stream, "dumping Chars at %p (chunks: %d)\n", chars, chars->count);
     for (uint32_t i = 0; i < chars->count; ++i) {
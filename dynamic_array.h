@@ -31,6 +31,11 @@
 
 DEFINE_DYNAMIC_ARRAY(_DummyDynamicArray, void)
 
+DEFINE_DYNAMIC_ARRAY(Uint8s, uint8_t)
+DEFINE_DYNAMIC_ARRAY(Uint16s, uint16_t)
+DEFINE_DYNAMIC_ARRAY(Uint32s, uint32_t)
+DEFINE_DYNAMIC_ARRAY(Doubles, double)
+
 void _da_reserve(_DummyDynamicArray* array, uint32_t itemSize, uint32_t requestedSize);
 void _da_reset(_DummyDynamicArray* array, uint32_t itemSize);
 void _da_free(_DummyDynamicArray* array, uint32_t itemSize);
@@ -60,6 +65,8 @@ typedef struct {
     // "Points" to next free byte (i.e. stores how much space is occupied)
     uint32_t count;
     uint32_t strCount;
+    // CHARS_CHUNK_SIZE, except for chunks holding a single string that is too long for a normal chunk.
+    uint32_t capacity;
 } CharsChunk;
 
 DEFINE_DYNAMIC_ARRAY(Chars, CharsChunk)
@@ -82,4 +89,7 @@ char* ca_commitf(Chars* chars, const char* fmt, ...);
 // Resets the count of each chunk, does not de-allocate.
 void ca_reset(Chars* chars);
 
+// Frees all chunks, every pointer returned by the commit functions becomes invalid.
+void ca_free(Chars* chars);
+
 void ca_dump(FILE* stream, Chars* chars);
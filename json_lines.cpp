@@ -0,0 +1,324 @@
+#include "json_lines.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define JSON_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline int _json_ctz(uint64_t x) {
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+}
+#define _json_popcount(x) __popcnt64(x)
+#else
+#define _json_ctz(x) __builtin_ctzll(x)
+#define _json_popcount(x) __builtin_popcountll(x)
+#endif
+
+#define JSON_BLOCK_SIZE 64
+
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    // { } [ ] : ,
+    uint64_t structural;
+} JsonBlockMasks;
+
+static void _json_classifyBlock(const char* block, JsonBlockMasks* masks) {
+#ifdef JSON_USE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    // '[' | 0x20 == '{' and ']' | 0x20 == '}', so two compares cover all four brackets.
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+
+    masks->quote = 0;
+    masks->backslash = 0;
+    masks->structural = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE / 16; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        __m128i lowered = _mm_or_si128(v, lowerBit);
+        __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)),
+            _mm_or_si128(_mm_cmpeq_epi8(lowered, openBrace), _mm_cmpeq_epi8(lowered, closeBrace)));
+
+        int shift = 16 * i;
+        masks->quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        masks->backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << shift;
+        masks->structural |= (uint64_t)(uint32_t)_mm_movemask_epi8(structural) << shift;
+    }
+#else
+    masks->quote = 0;
+    masks->backslash = 0;
+    masks->structural = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; ++i) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (block[i]) {
+        case '"': masks->quote |= bit; break;
+        case '\\': masks->backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',': masks->structural |= bit; break;
+        }
+    }
+#endif
+}
+
+// Returns a mask of all characters that are escaped by an odd-length run of backslashes.
+// Same approach as simdjson, carries are propagated with plain integer additions.
+static uint64_t _json_findEscaped(uint64_t backslash, uint64_t* prevEndsOddBackslash) {
+    const uint64_t evenBits = 0x5555555555555555ULL;
+    const uint64_t oddBits = ~evenBits;
+
+    uint64_t startEdges = backslash & ~(backslash << 1);
+    uint64_t evenStartMask = evenBits ^ *prevEndsOddBackslash;
+    uint64_t evenStarts = startEdges & evenStartMask;
+    uint64_t oddStarts = startEdges & ~evenStartMask;
+    uint64_t evenCarries = backslash + evenStarts;
+
+    uint64_t oddCarries = backslash + oddStarts;
+    bool endsOddBackslash = oddCarries < backslash;
+    oddCarries |= *prevEndsOddBackslash;
+    *prevEndsOddBackslash = endsOddBackslash ? 1 : 0;
+
+    uint64_t evenCarryEnds = evenCarries & ~backslash;
+    uint64_t oddCarryEnds = oddCarries & ~backslash;
+    uint64_t evenStartOddEnd = evenCarryEnds & oddBits;
+    uint64_t oddStartEvenEnd = oddCarryEnds & evenBits;
+    return evenStartOddEnd | oddStartEvenEnd;
+}
+
+// Bit i of the result is the xor of bits 0..i of x.
+static inline uint64_t _json_prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Collects the positions of all quotes and all structural characters outside of strings.
+static void _json_indexStructurals(JsonLineParser* parser, StrView line) {
+    da_reset(&parser->structurals);
+
+    uint64_t prevEndsOddBackslash = 0;
+    uint64_t prevInString = 0;
+
+    char tail[JSON_BLOCK_SIZE];
+    for (uint32_t base = 0; base < line.len; base += JSON_BLOCK_SIZE) {
+        const char* block = line.txt + base;
+        // NOTE: Never read past the end of the line, the last block is padded with zeros.
+        if (line.len - base < JSON_BLOCK_SIZE) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, block, line.len - base);
+            block = tail;
+        }
+
+        JsonBlockMasks masks;
+        _json_classifyBlock(block, &masks);
+
+        uint64_t escaped = 0;
+        if (masks.backslash != 0 || prevEndsOddBackslash != 0) {
+            escaped = _json_findEscaped(masks.backslash, &prevEndsOddBackslash);
+        }
+
+        uint64_t quotes = masks.quote & ~escaped;
+        uint64_t inString = _json_prefixXor(quotes) ^ prevInString;
+        prevInString = (uint64_t)((int64_t)inString >> 63);
+
+        uint64_t bits = (masks.structural & ~inString) | quotes;
+        if (bits == 0) {
+            continue;
+        }
+
+        // Make sure there is room for every bit (+3 for the unrolled loop below), so we can append without checks.
+        uint32_t required = parser->structurals.count + JSON_BLOCK_SIZE + 3;
+        if (required > parser->structurals.capacity) {
+            da_reserve(&parser->structurals, required * 2);
+        }
+
+        // Unrolled by 4, writing a few garbage entries past the end is fine, they are overwritten
+        // by the next block or ignored because of the count.
+        uint32_t* out = parser->structurals.items + parser->structurals.count;
+        uint32_t bitCount = (uint32_t)_json_popcount(bits);
+        uint32_t* end = out + bitCount;
+        while (out < end) {
+            out[0] = base + _json_ctz(bits);
+            bits &= bits - 1;
+            out[1] = base + _json_ctz(bits | ((uint64_t)1 << 63));
+            bits &= bits - 1;
+            out[2] = base + _json_ctz(bits | ((uint64_t)1 << 63));
+            bits &= bits - 1;
+            out[3] = base + _json_ctz(bits | ((uint64_t)1 << 63));
+            bits &= bits - 1;
+            out += 4;
+        }
+        parser->structurals.count += bitCount;
+    }
+}
+
+static bool _json_isWhiteSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static StrView _json_view(StrView line, uint32_t start, uint32_t end) {
+    StrView view;
+    view.txt = line.txt + start;
+    view.len = end - start;
+    return view;
+}
+
+// Classifies the scalar (number, true, false, null) between start and end.
+static bool _json_parseScalar(StrView line, uint32_t start, uint32_t end, JsonField* field) {
+    while (start < end && _json_isWhiteSpace(line.txt[start])) {
+        ++start;
+    }
+    while (end > start && _json_isWhiteSpace(line.txt[end - 1])) {
+        --end;
+    }
+    if (start == end) {
+        return false;
+    }
+
+    field->value = _json_view(line, start, end);
+    switch (line.txt[start]) {
+    case 't': field->kind = JSON_VALUE_TRUE; return field->value.len == 4 && memcmp(field->value.txt, "true", 4) == 0;
+    case 'f': field->kind = JSON_VALUE_FALSE; return field->value.len == 5 && memcmp(field->value.txt, "false", 5) == 0;
+    case 'n': field->kind = JSON_VALUE_NULL; return field->value.len == 4 && memcmp(field->value.txt, "null", 4) == 0;
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        field->kind = JSON_VALUE_NUMBER;
+        return true;
+    }
+
+    return false;
+}
+
+bool json_parseLine(JsonLineParser* parser, StrView line) {
+    da_reset(&parser->fields);
+    _json_indexStructurals(parser, line);
+
+    typedef enum {
+        EXPECT_OBJECT,
+        EXPECT_KEY,
+        IN_KEY,
+        EXPECT_COLON,
+        EXPECT_VALUE,
+        IN_STRING_VALUE,
+        AFTER_VALUE,
+    } JsonState;
+
+    JsonState state = EXPECT_OBJECT;
+    uint32_t depth = 0;
+    uint32_t start = 0;
+    JsonField field;
+    memset(&field, 0, sizeof(JsonField));
+
+    for (uint32_t i = 0; i < parser->structurals.count; ++i) {
+        uint32_t pos = parser->structurals.items[i];
+        char c = line.txt[pos];
+
+        // Nested objects and arrays are skipped, we only track the depth to find their end.
+        if (depth > 1) {
+            if (c == '{' || c == '[') {
+                ++depth;
+            }
+            else if (c == '}' || c == ']') {
+                --depth;
+                if (depth == 1) {
+                    field.value = _json_view(line, start, pos + 1);
+                    state = AFTER_VALUE;
+                }
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"': {
+            if (state == EXPECT_KEY) {
+                start = pos + 1;
+                state = IN_KEY;
+            }
+            else if (state == IN_KEY) {
+                field.key = _json_view(line, start, pos);
+                state = EXPECT_COLON;
+            }
+            else if (state == EXPECT_VALUE) {
+                start = pos + 1;
+                state = IN_STRING_VALUE;
+            }
+            else if (state == IN_STRING_VALUE) {
+                field.value = _json_view(line, start, pos);
+                field.kind = JSON_VALUE_STRING;
+                state = AFTER_VALUE;
+            }
+            else {
+                return false;
+            }
+        } break;
+        case ':': {
+            if (state != EXPECT_COLON) {
+                return false;
+            }
+            start = pos + 1;
+            state = EXPECT_VALUE;
+        } break;
+        case '{':
+        case '[': {
+            if (state == EXPECT_OBJECT && c == '{') {
+                depth = 1;
+                state = EXPECT_KEY;
+                break;
+            }
+            if (state != EXPECT_VALUE) {
+                return false;
+            }
+            field.kind = (c == '{') ? JSON_VALUE_OBJECT : JSON_VALUE_ARRAY;
+            start = pos;
+            depth = 2;
+        } break;
+        case ',':
+        case '}': {
+            if (state == EXPECT_VALUE) {
+                if (!_json_parseScalar(line, start, pos, &field)) {
+                    return false;
+                }
+                state = AFTER_VALUE;
+            }
+
+            if (state == AFTER_VALUE) {
+                da_append(&parser->fields, field);
+            }
+            else if (!(c == '}' && state == EXPECT_KEY && parser->fields.count == 0)) {
+                // Only the empty object {} may close without a value.
+                return false;
+            }
+
+            if (c == '}') {
+                return true;
+            }
+            state = EXPECT_KEY;
+        } break;
+        default:
+            return false;
+        }
+    }
+
+    // Line ended before the object was closed.
+    return false;
+}
+
+void json_free(JsonLineParser* parser) {
+    da_free(&parser->structurals);
+    da_free(&parser->fields);
+}
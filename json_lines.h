@@ -0,0 +1,46 @@
+#pragma once
+
+#include "dynamic_array.h"
+
+// Splits JSON-lines records (one JSON object per line) into their top-level fields.
+//
+// Works like the first stage of simdjson: each 64-byte block of a line is turned into bitmaps
+// (quotes, backslashes, structural characters) with SIMD compares, the bitmaps are used to find
+// the strings of the line, and only the structural characters outside of strings are visited.
+// Nested objects and arrays are skipped as a whole, string escapes are not decoded.
+
+#define JSON_VALUE_KINDS(X) \
+    X(JSON_VALUE_STRING) \
+    X(JSON_VALUE_NUMBER) \
+    X(JSON_VALUE_TRUE) \
+    X(JSON_VALUE_FALSE) \
+    X(JSON_VALUE_NULL) \
+    X(JSON_VALUE_OBJECT) \
+    X(JSON_VALUE_ARRAY)
+
+typedef enum {
+#define X(x) x,
+    JSON_VALUE_KINDS(X)
+#undef X
+} JsonValueKind;
+
+typedef struct {
+    // Without quotes.
+    StrView key;
+    // Strings without quotes, objects/arrays including their brackets.
+    StrView value;
+    JsonValueKind kind;
+} JsonField;
+
+DEFINE_DYNAMIC_ARRAY(JsonFields, JsonField)
+
+typedef struct {
+    // Scratch space for the positions of structural characters.
+    Uint32s structurals;
+    JsonFields fields;
+} JsonLineParser;
+
+// Returns false if the line is not a JSON object, parser->fields then contains the fields found so far.
+bool json_parseLine(JsonLineParser* parser, StrView line);
+
+void json_free(JsonLineParser* parser);
@@ -0,0 +1,13 @@
+#include "lexer.h"
+
+const char* tokenKindStrs[] = {
+ #define X(x) #x,
+    TOKEN_KINDS(X)
+#undef X
+};
+
+bool nextToken(Lexer* lex, const LexerDialect* dialect)
+{
+    LexerRuntimeConfig config = { dialect };
+    return lexNextToken(lex, config);
+}
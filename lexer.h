@@ -0,0 +1,266 @@
+#pragma once
+
+#include "dynamic_array.h"
+
+#define TOKEN_KINDS(X) \
+    X(TOK_EOF) \
+    X(TOK_SINGLE_SPECIAL) \
+    X(TOK_INTEGER) \
+    X(TOK_HEX) \
+    X(TOK_BINARY) \
+    X(TOK_FLOAT) \
+    X(TOK_WORD) \
+    X(TOK_PATH)
+// TODO: DateTime
+
+typedef enum {
+ #define X(x) x,
+    TOKEN_KINDS(X)
+#undef X
+} TokenKind;
+
+extern const char* tokenKindStrs[];
+
+typedef struct {
+    TokenKind kind;
+    StrView str;
+} LexerToken;
+
+typedef struct {
+    StrView str;
+    const char* pos;
+
+    LexerToken token;
+} Lexer;
+
+#define TOKEN_BIT(kind) (1u << (kind))
+
+// Describes the layout of a log dialect.
+// TOK_SINGLE_SPECIAL, TOK_INTEGER and TOK_WORD are always enabled.
+typedef struct {
+    const char* name;
+    // Optional token kinds that are enabled (TOKEN_BIT(TOK_HEX) | ...)
+    // Disabled numbers are lexed as integers followed by specials, disabled paths as specials and words.
+    uint32_t tokens;
+    // Characters that separate tokens and are skipped.
+    const char* separators;
+} LexerDialect;
+
+// X(name, dialect name, tokens, separators)
+#define LEXER_DIALECTS(X) \
+    X(lexerDialectText, "text", TOKEN_BIT(TOK_HEX) | TOKEN_BIT(TOK_BINARY) | TOKEN_BIT(TOK_FLOAT) | TOKEN_BIT(TOK_PATH), " \t") \
+    X(lexerDialectColumns, "columns", TOKEN_BIT(TOK_HEX) | TOKEN_BIT(TOK_FLOAT) | TOKEN_BIT(TOK_PATH), " \t|") \
+    X(lexerDialectStats, "stats", TOKEN_BIT(TOK_FLOAT), " \t,;")
+
+#define X(name, dialectName, tokens, separators) constexpr LexerDialect name = { dialectName, tokens, separators };
+LEXER_DIALECTS(X)
+#undef X
+
+// Lexes the next token of lex->str into lex->token, returns false at the end of the string.
+// The string has to be null-terminated.
+// Checks the dialect at runtime, see nextTokenSpecialized for the compile time variant.
+bool nextToken(Lexer* lex, const LexerDialect* dialect);
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') ||
+           (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+static inline bool isLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
+}
+
+static inline bool isPath(char c)
+{
+    return (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') ||
+           c == ':' || c == '.' || c == '/' || c == '\\';
+}
+
+constexpr bool lexerContains(const char* set, char c)
+{
+    return *set != '\0' && (*set == c || lexerContains(set + 1, c));
+}
+
+// The lexer itself is written once, against a Config that answers which token kinds are enabled
+// and which characters are separators.
+// - LexerRuntimeConfig reads the dialect at runtime (one generic lexer for all dialects)
+// - LexerStaticConfig<Dialect> reads a constexpr dialect, the compiler folds all checks away
+//   and every dialect gets its own branch-reduced lexer.
+struct LexerRuntimeConfig {
+    const LexerDialect* dialect;
+
+    bool has(TokenKind kind) const { return (dialect->tokens & TOKEN_BIT(kind)) != 0; }
+    bool isSeparator(char c) const { return lexerContains(dialect->separators, c); }
+};
+
+template <const LexerDialect& Dialect>
+struct LexerStaticConfig {
+    constexpr bool has(TokenKind kind) const { return (Dialect.tokens & TOKEN_BIT(kind)) != 0; }
+    constexpr bool isSeparator(char c) const { return lexerContains(Dialect.separators, c); }
+};
+
+template <typename Config>
+static inline bool lexNextToken(Lexer* lex, const Config& config)
+{
+#define RETURN_TOKEN(_kind) { \
+    lex->pos = p; \
+    lex->token.kind = (_kind); \
+    lex->token.str.txt = tokenStart; \
+    lex->token.str.len = p - tokenStart; \
+    return true; \
+}
+
+    const char* p = lex->pos;
+    while (config.isSeparator(*p)) {
+        ++p;
+    }
+
+    const char* tokenStart = p;
+    switch (*p) {
+    case '\0':
+        return false;
+    case '0': {
+        if (config.has(TOK_HEX) && p[1] == 'x' && isHexDigit(p[2])) {
+            p += 2;
+            while (isHexDigit(*p)) {
+                ++p;
+            }
+
+            RETURN_TOKEN(TOK_HEX)
+        }
+
+        if (config.has(TOK_BINARY) && p[1] == 'b') {
+            p += 2;
+            while (*p == '0' || *p == '1') {
+                ++p;
+            }
+            RETURN_TOKEN(TOK_BINARY)
+        }
+    } // Fall through on purpose!
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+lex_integer:
+        while (isDigit(*p)) {
+            ++p;
+        }
+
+        if (!config.has(TOK_FLOAT)) {
+            RETURN_TOKEN(TOK_INTEGER)
+        }
+
+        if (*p == 'e' || *p == 'E') {
+            goto lex_float_exponent;
+        }
+
+        if (*p == '.') {
+            ++p;
+            while (isDigit(*p)) {
+                ++p;
+            }
+
+            if (*p == 'e' || *p == 'E') {
+lex_float_exponent:
+                ++p;
+                if (*p == '+' || *p == '-') {
+                    ++p;
+                }
+                while (isDigit(*p)) {
+                    ++p;
+                }
+            }
+
+            RETURN_TOKEN(TOK_FLOAT)
+        }
+
+        RETURN_TOKEN(TOK_INTEGER)
+    }
+    break;
+    case '-':
+        if (config.has(TOK_FLOAT) && p[1] == '.' && isDigit(p[2])) {
+            ++p;
+            goto lex_integer;
+        }
+    case '.':
+    case '+': {
+        if (isDigit(p[1]) && (*p != '.' || config.has(TOK_FLOAT))) {
+            ++p;
+            goto lex_integer;
+        }
+    } // Fall through on purpose!
+    case ':':
+    case '=':
+    case '|':
+    case '(':
+    case ')':
+    case '[':
+    case ']':
+    case '<':
+    case '>': {
+lex_single_special:
+        ++p;
+        RETURN_TOKEN(TOK_SINGLE_SPECIAL)
+    }
+    break;
+    case '~': {
+        if (p[1] != '/') {
+            goto lex_single_special;
+        }
+    } // Fall through on purpose!
+    case '/': {
+        if (!config.has(TOK_PATH)) {
+            goto lex_single_special;
+        }
+lex_path:
+        while (isPath(*p)) {
+            ++p;
+        }
+        RETURN_TOKEN(TOK_PATH)
+    }
+    break;
+    default: {
+        // Windows absolute paths start with 'A:/' or 'A:\'
+        if (config.has(TOK_PATH) && isLetter(*p) && p[1] == ':' && (p[2] == '/' || p[2] == '\\')) {
+            goto lex_path;
+        }
+
+        while (isLetter(*p) || *p == '_') {
+            ++p;
+        }
+
+        // Any other character (',', '"', '!', ...) is a token of its own.
+        if (p == tokenStart) {
+            goto lex_single_special;
+        }
+        RETURN_TOKEN(TOK_WORD)
+    }
+    break;
+    }
+
+    return false;
+
+#undef RETURN_TOKEN
+}
+
+// Same as nextToken, but specialized at compile time for the given dialect.
+template <const LexerDialect& Dialect>
+static inline bool nextTokenSpecialized(Lexer* lex)
+{
+    return lexNextToken(lex, LexerStaticConfig<Dialect>());
+}
@@ -0,0 +1,65 @@
+// Test producer for the live ingest channel, pretends to be a running game.
+// Usage: buschla-live-producer <channel name> [line count] [lines per second]
+// Run 'buschla-parser --live <channel name>' next to it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "buschla_live.h"
+
+static void sleepMs(int ms)
+{
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s <channel name> [line count] [lines per second (0 = unthrottled)]\n", argv[0]);
+        return 1;
+    }
+
+    const char* name = argv[1];
+    long lineCount = argc > 2 ? atol(argv[2]) : 100000;
+    long linesPerSecond = argc > 3 ? atol(argv[3]) : 10000;
+
+    BuschlaLive live;
+    if (!buschla_live_create(&live, name, 1 << 22)) {
+        perror("buschla_live_create");
+        return 1;
+    }
+    printf("created live channel '%s', writing %ld lines\n", name, lineCount);
+
+    static const char* channels[] = { "Render", "Physics", "Audio", "Net" };
+    long written = 0;
+    long frame = 0;
+    for (long i = 0; i < lineCount; ++i) {
+        const char* channel = channels[i % 4];
+        int ok;
+        if (i % 4 == 0) {
+            ++frame;
+            ok = buschla_live_printf(&live, "[%s] INFO Frame: %ld time: %.3f", channel, frame, 16.6 + (double)(rand() % 1000) / 100.0);
+        }
+        else if (i % 97 == 0) {
+            ok = buschla_live_printf(&live, "[%s] ERROR failed to load /game/assets/mesh_%ld.pak", channel, i % 5000);
+        }
+        else {
+            ok = buschla_live_printf(&live, "[%s] DEBUG update entity 0x%lx queue: %d", channel, (unsigned long)i * 2654435761ul, rand() % 64);
+        }
+        written += ok;
+
+        if (linesPerSecond > 0 && (i + 1) % (linesPerSecond / 100 + 1) == 0) {
+            sleepMs(10);
+        }
+    }
+
+    // Give the consumer a moment to drain before the channel goes away.
+    sleepMs(100);
+    printf("wrote %ld lines, dropped %ld\n", written, lineCount - written);
+    buschla_live_close(&live);
+    return 0;
+}
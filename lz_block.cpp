@@ -0,0 +1,156 @@
+#include "lz_block.h"
+
+#include <string.h>
+
+#define LZ_HASH_BITS 14
+
+static uint32_t _lz_read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t _lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* _lz_write_length(uint8_t* op, uint32_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t* _lz_write_sequence(uint8_t* op, const uint8_t* literals, uint32_t literalCount, uint32_t offset, uint32_t matchLength) {
+    uint8_t* token = op++;
+    *token = (uint8_t)((literalCount >= 15 ? 15 : literalCount) << 4);
+    if (literalCount >= 15) {
+        op = _lz_write_length(op, literalCount - 15);
+    }
+    memcpy(op, literals, literalCount);
+    op += literalCount;
+
+    // The last sequence has no match.
+    if (matchLength == 0) {
+        return op;
+    }
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    uint32_t length = matchLength - LZ_MIN_MATCH;
+    *token |= (uint8_t)(length >= 15 ? 15 : length);
+    if (length >= 15) {
+        op = _lz_write_length(op, length - 15);
+    }
+    return op;
+}
+
+uint32_t lz_compress(const void* src, uint32_t size, uint8_t* dst) {
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* op = dst;
+
+    // Position + 1 of the last occurence of each hash, 0 if there is none.
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint32_t anchor = 0;
+    uint32_t ip = 0;
+    while (size >= LZ_MIN_MATCH && ip <= size - LZ_MIN_MATCH) {
+        uint32_t sequence = _lz_read32(in + ip);
+        uint32_t hash = _lz_hash(sequence);
+        uint32_t candidate = table[hash];
+        table[hash] = ip + 1;
+
+        if (candidate == 0 || ip - (candidate - 1) > LZ_MAX_OFFSET || _lz_read32(in + candidate - 1) != sequence) {
+            // Skip ahead faster through text that does not compress.
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        uint32_t match = candidate - 1;
+        uint32_t length = LZ_MIN_MATCH;
+        while (ip + length < size && in[match + length] == in[ip + length]) {
+            ++length;
+        }
+
+        op = _lz_write_sequence(op, in + anchor, ip - anchor, ip - match, length);
+        ip += length;
+        anchor = ip;
+
+        // Remember a position inside the match, so the next repetition is found right away.
+        if (ip >= 2 && ip - 2 <= size - LZ_MIN_MATCH) {
+            table[_lz_hash(_lz_read32(in + ip - 2))] = ip - 2 + 1;
+        }
+    }
+
+    op = _lz_write_sequence(op, in + anchor, size - anchor, 0, 0);
+    return (uint32_t)(op - dst);
+}
+
+// Reads the rest of a length that starts with 15 in the token, fails if it gets larger than limit.
+static bool _lz_read_length(const uint8_t* src, uint32_t srcSize, uint32_t* ip, uint32_t* length, uint32_t limit) {
+    uint8_t byte;
+    do {
+        if (*ip >= srcSize) {
+            return false;
+        }
+        byte = src[(*ip)++];
+        *length += byte;
+        if (*length > limit) {
+            return false;
+        }
+    } while (byte == 255);
+    return true;
+}
+
+bool lz_decompress(const uint8_t* src, uint32_t srcSize, void* dst, uint32_t dstSize) {
+    uint8_t* out = (uint8_t*)dst;
+    uint32_t ip = 0;
+    uint32_t op = 0;
+    while (ip < srcSize) {
+        uint8_t token = src[ip++];
+
+        uint32_t literalCount = token >> 4;
+        if (literalCount == 15 && !_lz_read_length(src, srcSize, &ip, &literalCount, dstSize)) {
+            return false;
+        }
+        if (literalCount > srcSize - ip || literalCount > dstSize - op) {
+            return false;
+        }
+        memcpy(out + op, src + ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        if (ip == srcSize) {
+            return op == dstSize;
+        }
+
+        if (srcSize - ip < 2) {
+            return false;
+        }
+        uint32_t offset = src[ip] | ((uint32_t)src[ip + 1] << 8);
+        ip += 2;
+        uint32_t length = token & 15;
+        if (length == 15 && !_lz_read_length(src, srcSize, &ip, &length, dstSize)) {
+            return false;
+        }
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || length > dstSize - op) {
+            return false;
+        }
+
+        // Matches may overlap the bytes they produce (runs), those are copied byte by byte.
+        if (offset >= length) {
+            memcpy(out + op, out + op - offset, length);
+            op += length;
+        }
+        else {
+            for (uint32_t i = 0; i < length; ++i, ++op) {
+                out[op] = out[op - offset];
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// Byte-oriented LZ77 compression of independent blocks (the format is close to LZ4 blocks).
+// A block is a list of sequences:
+// - token:    literal count in the high 4 bits, match length - LZ_MIN_MATCH in the low 4 bits
+// - optional: if a count in the token is 15, the rest follows as bytes of 255 ended by a byte < 255
+//             (literal count right after the token, match length after the offset)
+// - literals
+// - offset:   2 bytes little endian, distance back to the start of the match (1..65535)
+// The last sequence has only literals, the block ends after them.
+// Compression is greedy with a single candidate per hash, fast enough to keep up with the parser;
+// decompression only copies bytes and checks every length against both buffers.
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+
+// Upper bound of the compressed size of size bytes.
+#define LZ_BOUND(size) ((size) + (size) / 255 + 16)
+
+// Compresses size bytes from src into dst, which has room for LZ_BOUND(size) bytes.
+// Returns the compressed size.
+uint32_t lz_compress(const void* src, uint32_t size, uint8_t* dst);
+
+// Decompresses a block into dst, which has to end up with exactly dstSize bytes.
+// Returns false if the block is damaged.
+bool lz_decompress(const uint8_t* src, uint32_t srcSize, void* dst, uint32_t dstSize);
@@ -340,7 +340,7 @@ int main(int argc, char** argv) {
         DirWatcherConfig_AppendDirectory(&watcherState.config, tmp);
     }
 
-    // TODO: configure reaction
+    watcherState.config.reactionCommand = "make app";
 
     DirWatcher_Init(&watcherState);
 #endif
@@ -0,0 +1,234 @@
+#include "parse_cache.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dynamic_array.h"
+#include "util.h"
+
+#define PARSE_CACHE_READ_SIZE (1u << 20)
+#define PARSE_CACHE_SEED_0 0x70617273ULL
+#define PARSE_CACHE_SEED_1 0x9E3779B97F4A7C15ULL
+
+typedef struct {
+    char name[64];
+    uint64_t size;
+    struct timespec used;
+} _PcEntry;
+
+DEFINE_DYNAMIC_ARRAY(_PcEntries, _PcEntry)
+
+bool pc_init(ParseCache* cache, const char* directory, uint64_t budgetBytes, const char** inputs, uint32_t inputCount, const char* options) {
+    memset(cache, 0, sizeof(ParseCache));
+    cache->directory = directory;
+    cache->budgetBytes = budgetBytes;
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "mkdir(%s): %s\n", directory, strerror(errno));
+        return false;
+    }
+
+    char* buffer = (char*)malloc(PARSE_CACHE_READ_SIZE);
+    assert(buffer != NULL && "Buy more RAM lel");
+
+    // Chained through the seed, every block continues the hash of the bytes before it.
+    uint64_t hash0 = hashBytes(options, strlen(options), PARSE_CACHE_SEED_0);
+    uint64_t hash1 = hashBytes(options, strlen(options), PARSE_CACHE_SEED_1);
+    bool ok = true;
+    for (uint32_t i = 0; i < inputCount && ok; ++i) {
+        FILE* file = fopen(inputs[i], "rb");
+        if (file == NULL) {
+            fprintf(stderr, "fopen(%s): %s\n", inputs[i], strerror(errno));
+            ok = false;
+            break;
+        }
+
+        uint64_t size = 0;
+        size_t readSize;
+        while ((readSize = fread(buffer, 1, PARSE_CACHE_READ_SIZE, file)) > 0) {
+            hash0 = hashBytes(buffer, readSize, hash0);
+            hash1 = hashBytes(buffer, readSize, hash1);
+            size += readSize;
+        }
+        ok = !ferror(file);
+        fclose(file);
+
+        // Inputs "ab" + "c" are not the same as "a" + "bc".
+        hash0 = hashBytes(&size, sizeof(size), hash0);
+        hash1 = hashBytes(&size, sizeof(size), hash1);
+
+        // Merged logs store the input names (as given) in their sources section.
+        if (inputCount > 1) {
+            uint64_t nameLength = strlen(inputs[i]);
+            hash0 = hashBytes(inputs[i], nameLength, hash0);
+            hash1 = hashBytes(inputs[i], nameLength, hash1);
+            hash0 = hashBytes(&nameLength, sizeof(nameLength), hash0);
+            hash1 = hashBytes(&nameLength, sizeof(nameLength), hash1);
+        }
+    }
+    free(buffer);
+
+    cache->hash[0] = hash0;
+    cache->hash[1] = hash1;
+    snprintf(cache->path, sizeof(cache->path), "%s/%016llx%016llx.buschla", directory,
+             (unsigned long long)hash0, (unsigned long long)hash1);
+    snprintf(cache->usedPath, sizeof(cache->usedPath), "%s/%016llx%016llx.used", directory,
+             (unsigned long long)hash0, (unsigned long long)hash1);
+    return ok;
+}
+
+// Marks the cached file as used now.
+static void _pc_touch(ParseCache* cache) {
+    int fd = open(cache->usedPath, O_WRONLY | O_CREAT, 0644);
+    if (fd != -1) {
+        close(fd);
+    }
+    utimensat(AT_FDCWD, cache->usedPath, NULL, 0);
+}
+
+// Copies src to a temporary file next to dst and renames it to dst.
+static bool _pc_copy(const char* src, const char* dst) {
+    char tmpPath[4096 + 16];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", dst);
+    int out = mkstemp(tmpPath);
+    if (out == -1) {
+        return false;
+    }
+    int in = open(src, O_RDONLY);
+
+    bool ok = in != -1;
+    char buffer[1 << 16];
+    while (ok) {
+        ssize_t readSize = read(in, buffer, sizeof(buffer));
+        if (readSize <= 0) {
+            ok = readSize == 0;
+            break;
+        }
+        ok = write(out, buffer, readSize) == readSize;
+    }
+
+    if (in != -1) {
+        close(in);
+    }
+    ok = close(out) == 0 && ok;
+    // mkstemp creates the file with 0600.
+    ok = ok && chmod(tmpPath, 0644) == 0;
+    ok = ok && rename(tmpPath, dst) == 0;
+    if (!ok) {
+        unlink(tmpPath);
+    }
+    return ok;
+}
+
+bool pc_fetch(ParseCache* cache, const char* outputPath) {
+    struct stat cached;
+    if (stat(cache->path, &cached) != 0) {
+        return false;
+    }
+
+    // Linked to a temporary name first, so an existing output is replaced in one step.
+    char tmpPath[4096 + 16];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", outputPath);
+    unlink(tmpPath);
+    bool ok = link(cache->path, tmpPath) == 0 && rename(tmpPath, outputPath) == 0;
+    // rename does nothing if the output already is a link to the cached file.
+    unlink(tmpPath);
+    if (!ok) {
+        ok = _pc_copy(cache->path, outputPath);
+    }
+    if (!ok) {
+        fprintf(stderr, "cannot get '%s' from the parse cache: %s\n", cache->path, strerror(errno));
+        return false;
+    }
+
+    _pc_touch(cache);
+    return true;
+}
+
+static int _pc_compare_used(const void* a, const void* b) {
+    const struct timespec* usedA = &((const _PcEntry*)a)->used;
+    const struct timespec* usedB = &((const _PcEntry*)b)->used;
+    if (usedA->tv_sec != usedB->tv_sec) {
+        return usedA->tv_sec < usedB->tv_sec ? -1 : 1;
+    }
+    return usedA->tv_nsec < usedB->tv_nsec ? -1 : usedA->tv_nsec > usedB->tv_nsec ? 1 : 0;
+}
+
+static void _pc_evict(ParseCache* cache) {
+    DIR* dir = opendir(cache->directory);
+    if (dir == NULL) {
+        return;
+    }
+
+    _PcEntries entries;
+    memset(&entries, 0, sizeof(_PcEntries));
+    uint64_t totalSize = 0;
+    const char* keep = strrchr(cache->path, '/') + 1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        // Temporary files of other parsers are not finished yet.
+        if (length < 8 || length >= sizeof(((_PcEntry*)0)->name) || strcmp(entry->d_name + length - 8, ".buschla") != 0) {
+            continue;
+        }
+
+        char path[4096 + 80];
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0) {
+            continue;
+        }
+
+        totalSize += (uint64_t)info.st_size;
+        if (strcmp(entry->d_name, keep) == 0) {
+            continue;
+        }
+        _PcEntry* cached = da_append_get(&entries);
+        memcpy(cached->name, entry->d_name, length + 1);
+        cached->size = (uint64_t)info.st_size;
+        cached->used = info.st_mtim;
+
+        // Files cached before there were .used files count as used when they were written.
+        struct stat used;
+        memcpy(path + strlen(path) - 8, ".used", 6);
+        if (stat(path, &used) == 0) {
+            cached->used = used.st_mtim;
+        }
+    }
+    closedir(dir);
+
+    qsort(entries.items, entries.count, sizeof(_PcEntry), _pc_compare_used);
+    for (uint32_t i = 0; i < entries.count && totalSize > cache->budgetBytes; ++i) {
+        char path[4096 + 80];
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entries.items[i].name);
+        if (unlink(path) == 0) {
+            totalSize -= entries.items[i].size;
+        }
+        memcpy(path + strlen(path) - 8, ".used", 6);
+        unlink(path);
+    }
+    da_free(&entries);
+}
+
+bool pc_store(ParseCache* cache, const char* outputPath) {
+    // The output is complete, so it can be linked under its final name right away.
+    bool ok = link(outputPath, cache->path) == 0 || errno == EEXIST;
+    if (!ok) {
+        ok = _pc_copy(outputPath, cache->path);
+    }
+    if (!ok) {
+        fprintf(stderr, "cannot add '%s' to the parse cache: %s\n", cache->path, strerror(errno));
+        return false;
+    }
+
+    _pc_touch(cache);
+    _pc_evict(cache);
+    return true;
+}
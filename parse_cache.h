@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Directory of .buschla files named after a hash of everything that went into them: the bytes of the inputs,
+// the parser build and the options. Parsing the same inputs again with the same parser gets the cached file
+// (hard linked, or copied across file systems) instead of parsing.
+// The cache is kept below a size budget by deleting the least recently used files, a hit counts as a use.
+// The last use is the modification time of a .used file next to each cached file: the cached file itself is
+// hard linked to outputs, touching it would change their modification time too.
+// Files are written to a temporary file and renamed, several parsers can share a cache.
+
+typedef struct {
+    const char* directory;
+    uint64_t budgetBytes;
+
+    uint64_t hash[2];
+    // <directory>/<hash in hex>.buschla
+    char path[4096];
+    // <directory>/<hash in hex>.used
+    char usedPath[4096];
+} ParseCache;
+
+// Hashes the inputs (in order, with their names if there are several) and the options, which have to describe everything else that changes the output.
+// Creates the cache directory if needed, returns false if an input cannot be read or the directory cannot be created.
+bool pc_init(ParseCache* cache, const char* directory, uint64_t budgetBytes, const char** inputs, uint32_t inputCount, const char* options);
+
+// Puts the cached file at outputPath if there is one, returns false on a miss.
+bool pc_fetch(ParseCache* cache, const char* outputPath);
+
+// Adds the file at outputPath to the cache and evicts the least recently used files above the budget.
+// Returns false if it could not be added, the output is left alone either way.
+bool pc_store(ParseCache* cache, const char* outputPath);
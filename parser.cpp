@@ -1,9 +1,30 @@
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "alert_rule.h"
 #include "buschla_file.h"
+#include "buschla_live.h"
+#include "buschla_log.h"
+#include "chunk_store.h"
+#include "directory_watcher.h"
+#include "json_lines.h"
+#include "lexer.h"
+#include "lz_block.h"
+#include "parse_cache.h"
+#include "string_table.h"
+#include "top_k.h"
+#include "value_sketch.h"
 
 // We want to store:
 // - All of the text of the log lines
@@ -25,377 +46,3239 @@
 // Maybe its better to store a list of indices ?
 // OR we could only store sections of the bitfield?
 
-// Returns pointer to statically allocated buffer.
+// Uncomment to print every token and value found while parsing.
+//#define PARSER_DEBUG_PRINTING
+
+#ifdef PARSER_DEBUG_PRINTING
+#define debugPrintf(...) printf(__VA_ARGS__)
+#else
+#define debugPrintf(...)
+#endif
+
+#define LINE_READER_BUFFER_SIZE (1 << 20)
+
+// Reads lines from a stream in big blocks, instead of calling fread for every character.
+typedef struct {
+    FILE* stream;
+
+    // Raw bytes read from the stream.
+    char* buffer;
+    uint32_t bufferPos;
+    uint32_t bufferEnd;
+    bool eof;
+
+    // Filtered content of the current line.
+    char* line;
+    uint32_t lineCapacity;
+} LineReader;
+
+static void lineReaderInit(LineReader* reader, FILE* stream)
+{
+    memset(reader, 0, sizeof(LineReader));
+    reader->stream = stream;
+    reader->buffer = (char*)malloc(LINE_READER_BUFFER_SIZE);
+    reader->lineCapacity = 4096;
+    reader->line = (char*)malloc(reader->lineCapacity);
+    assert(reader->buffer != NULL && reader->line != NULL);
+}
+
+static void lineReaderFree(LineReader* reader)
+{
+    free(reader->buffer);
+    free(reader->line);
+    memset(reader, 0, sizeof(LineReader));
+}
+
+// Returns pointer to a buffer owned by the LineReader.
 // DO NOT store this pointer!
 // DO NOT free this pointer!
-// The contents will be modified the next time fetchLine is called.
-// If an error occured while reading, NULL is returned instead.
-static char* fetchLine(FILE* stream, uint32_t* lengthOut)
+// The contents will be modified the next time readLine is called.
+// If the end of the stream is reached (or an error occured while reading), NULL is returned instead.
+static char* readLine(LineReader* reader, uint32_t* lengthOut)
+{
+    uint32_t length = 0;
+    bool readAnything = false;
+    while (true) {
+        if (reader->bufferPos == reader->bufferEnd) {
+            if (reader->eof) {
+                break;
+            }
+
+            size_t count = fread(reader->buffer, 1, LINE_READER_BUFFER_SIZE, reader->stream);
+            reader->bufferPos = 0;
+            reader->bufferEnd = (uint32_t)count;
+            if (count < LINE_READER_BUFFER_SIZE) {
+                reader->eof = true;
+            }
+            if (count == 0) {
+                break;
+            }
+        }
+
+        readAnything = true;
+
+        const char* start = reader->buffer + reader->bufferPos;
+        const char* end = reader->buffer + reader->bufferEnd;
+        const char* newline = (const char*)memchr(start, '\n', end - start);
+        const char* stop = (newline != NULL) ? newline : end;
+
+        uint32_t required = length + (uint32_t)(stop - start);
+        if (required > reader->lineCapacity) {
+            while (reader->lineCapacity < required) {
+                reader->lineCapacity += reader->lineCapacity / 2;
+            }
+            reader->line = (char*)realloc(reader->line, reader->lineCapacity);
+            assert(reader->line != NULL);
+        }
+
+        for (const char* p = start; p < stop; ++p) {
+            char c = *p;
+
+            // Ignore other non-printable characters
+            // 0x7F is DEL
+            if (ASCII_IS_CONTROL(c) || UTF8_IS_CONTINUATION(c)) {
+                continue;
+            }
+
+            // Non-ASCII code points are replaced by a single '?'
+            if (UTF8_IS_START(c)) {
+                c = '?';
+            }
+
+            reader->line[length] = c;
+            ++length;
+        }
+
+        reader->bufferPos = (uint32_t)(stop - reader->buffer);
+        if (newline != NULL) {
+            // Skip the newline.
+            ++reader->bufferPos;
+            break;
+        }
+    }
+
+    *lengthOut = length;
+    return readAnything ? reader->line : NULL;
+}
+
+// The text dialects share one lexer description each (see LEXER_DIALECTS),
+// their line parser is instantiated per dialect.
+// binary reads the records written by buschla_log.h instead of lines.
+#define PARSER_DIALECTS(X) \
+    X(DIALECT_TEXT, "text") \
+    X(DIALECT_COLUMNS, "columns") \
+    X(DIALECT_STATS, "stats") \
+    X(DIALECT_JSON, "json") \
+    X(DIALECT_BINARY, "binary")
+
+typedef enum {
+#define X(id, name) id,
+    PARSER_DIALECTS(X)
+#undef X
+    DIALECT_COUNT
+} ParserDialect;
+
+const char* parserDialectNames[] = {
+#define X(id, name) name,
+    PARSER_DIALECTS(X)
+#undef X
+};
+
+// Number of possible trigrams (3 bytes).
+#define PARSER_TRIGRAM_COUNT (1u << 24)
+
+// Shorter words are not worth indexing ("a", "to", "of", ...).
+#define PARSER_KEYWORD_MIN_LENGTH 3
+
+#define PARSER_NO_KEY 0xFFFFFFFF
+
+// Frame hitches are detected against the median/MAD of the last PARSER_HITCH_WINDOW frame times.
+#define PARSER_HITCH_WINDOW 64
+// No hitches are reported until the window has seen this many frames.
+#define PARSER_HITCH_MIN_FRAMES 16
+// Robust z-score ((duration - median) / (1.4826 * MAD)) a frame needs to be a hitch.
+#define PARSER_HITCH_MIN_SEVERITY 5.0
+// Frames also need to take this much longer than the median, very stable frame times have a tiny MAD.
+#define PARSER_HITCH_MIN_RATIO 1.5
+
+// Number of line templates tracked for the heavy hitters, all of them are written.
+#define PARSER_TEMPLATE_COUNT 256
+
+#define PARSER_MAX_ENTITY_KEYS 16
+// Longer entity names are cut off.
+#define PARSER_MAX_ENTITY_LENGTH 128
+
+DEFINE_DYNAMIC_ARRAY(Hitches, BuschlaHitch)
+DEFINE_DYNAMIC_ARRAY(Scopes, BuschlaScope)
+DEFINE_DYNAMIC_ARRAY(StringTables, StringTable)
+DEFINE_DYNAMIC_ARRAY(Alerts, BuschlaAlert)
+DEFINE_DYNAMIC_ARRAY(BuschlaTextBlocks, BuschlaTextBlock)
+
+typedef struct {
+    // Frame times of the last PARSER_HITCH_WINDOW frames, in order of arrival (ring) and sorted.
+    double window[PARSER_HITCH_WINDOW];
+    double sorted[PARSER_HITCH_WINDOW];
+    uint32_t windowCount;
+    uint32_t windowHead;
+
+    uint32_t frameCount;
+    // First line of the current frame.
+    uint32_t frameFirstLine;
+
+    // Values seen on the current line, evaluated in finishLine.
+    bool lineHasFrameTime;
+    bool lineHasFrameNumber;
+    double lineFrameTime;
+    double lineFrameNumber;
+} HitchDetector;
+
+// Everything about a binary format string that does not change between its events.
+typedef struct {
+    bool valid;
+    // The text does not match the argument types, the events of this format are read but not added.
+    bool rejected;
+    uint8_t argCount;
+    uint8_t argTypes[BUSCHLA_LOG_MAX_ARGS];
+    // Literal text before each argument, pieces[argCount] follows the last argument.
+    StrView pieces[BUSCHLA_LOG_MAX_ARGS + 1];
+    // printf conversion of each argument, with the length modifier replaced to match argTypes.
+    char conversions[BUSCHLA_LOG_MAX_ARGS][16];
+    // Value key of each argument written as "key: %d" or "key=%d", PARSER_NO_KEY otherwise.
+    uint32_t keyIds[BUSCHLA_LOG_MAX_ARGS];
+    // Range in binaryKeywordIds.
+    BuschlaRange keywords;
+    LogLevel level;
+    uint16_t channel;
+} BinaryFormat;
+
+DEFINE_DYNAMIC_ARRAY(BinaryFormats, BinaryFormat)
+
+typedef struct {
+    ParserDialect dialect;
+
+    Chars textBuffer;
+    LogLines logLines;
+
+    // One LogLevel per entry in logLines.
+    Uint8s levels;
+
+    // Channel ids are assigned in the order the channels are first seen.
+    StringTable channelNames;
+    // Indexed by channel id.
+    Uint32s channelLineCounts;
+    // One channel id per entry in logLines.
+    Uint16s lineChannels;
+
+    // Only filled when several inputs are merged, see parseMerged.
+    StringTable sourceNames;
+    // One source id per entry in logLines.
+    Uint16s lineSources;
+
+    // Numeric values, stored in the order they are found (i.e. sorted by line).
+    StringTable keyNames;
+    Uint32s valueKeys;
+    Uint32s valueLines;
+    Doubles values;
+    // Indexed by key id, the values of a line are added in finishLine (the first sketchedValueCount are in).
+    ValueSketches keySketches;
+    uint32_t sketchedValueCount;
+
+    // String values, stored in the order they are found.
+    // Indexed by field id, the dictionary of each field: fieldCodes are ids in the field's table.
+    StringTable fieldNames;
+    StringTables fieldDictionaries;
+    Uint32s fieldIds;
+    Uint32s fieldLines;
+    Uint32s fieldCodes;
+
+    // Keyword postings, stored in the order they are found.
+    // A keyword is only added once per line.
+    StringTable keywordNames;
+    Uint32s keywordIds;
+    Uint32s keywordLines;
+    // Indexed by keyword id, last line the keyword was added for.
+    Uint32s keywordLastLines;
+
+    // Entity postings, stored in the order they are found.
+    // An entity is only added once per line.
+    StringTable entityNames;
+    Uint32s entityIds;
+    Uint32s entityLines;
+    // Indexed by entity id, last line the entity was added for.
+    Uint32s entityLastLines;
+    // Keys whose values are entities (--entity-key).
+    const char* entityKeys[PARSER_MAX_ENTITY_KEYS];
+    uint32_t entityKeyCount;
+    // Scratch buffer for the name of an entity.
+    char entityName[PARSER_MAX_ENTITY_LENGTH];
+
+    // Trigram postings, stored in the order they are found.
+    // A trigram is only added once per block of BUSCHLA_TRIGRAM_BLOCK_LINES lines.
+    bool skipTrigrams;
+    // Indexed by trigram (PARSER_TRIGRAM_COUNT entries), stores trigram id + 1 (0 if not seen yet).
+    uint32_t* trigramIds;
+    // Indexed by trigram id.
+    Uint32s trigramKeys;
+    // Indexed by trigram id, last block the trigram was added for.
+    Uint32s trigramLastBlocks;
+    Uint32s trigramPostingIds;
+    Uint32s trigramPostingBlocks;
+
+    // Directory shared by many files, the text is stored there in chunks (--chunk-store).
+    const char* chunkStore;
+    // Store the text uncompressed (--raw-text).
+    bool rawText;
+
+    // Only filled with --tokens.
+    // lineTokens starts with 0 and gets the end of each line's tokens appended.
+    bool storeTokens;
+    Uint32s tokens;
+    Uint32s lineTokens;
+
+    JsonLineParser json;
+
+    // Values of these keys drive the hitch detection (matched case-insensitively).
+    const char* frameKey;
+    const char* frameTimeKey;
+    uint32_t frameKeyId;
+    uint32_t frameTimeKeyId;
+    HitchDetector hitchDetector;
+    Hitches hitches;
+
+    // Scopes in the order they begin, name.offset holds the id in scopeNames until they are written.
+    // lastLine is BUSCHLA_SCOPE_NONE while a scope is open.
+    StringTable scopeNames;
+    Scopes scopes;
+    // Timestamp of each scope's BEGIN line, NAN if it has none.
+    Doubles scopeBeginTimes;
+    // Indices in scopes of the open scopes, innermost last.
+    Uint32s openScopes;
+
+    // Rules given with --alert, their windows carry over into the next segment like the hitch window.
+    AlertRules alertRules;
+    // Lines parsed since the start, the step of line based rules.
+    uint64_t alertLineStep;
+    // Print alerts to stdout as they fire (--live).
+    bool printAlerts;
+    // rule.offset holds the index in alertRules until they are written.
+    Alerts alerts;
+
+    // Most frequent line templates, allocated with the first line.
+    TopK templates;
+    // Scratch buffer for the template of the current line.
+    char* templateText;
+    uint32_t templateTextCapacity;
+
+    // Indexed by format id - 1.
+    BinaryFormats binaryFormats;
+    // Keywords of the literal text of all binary formats, see BinaryFormat::keywords.
+    Uint32s binaryKeywordIds;
+    Chars binaryFormatText;
+} Parser;
+
+typedef struct {
+    const char* name;
+    LogLevel level;
+} LogLevelName;
+
+// Matched case-insensitively against whole words.
+static const LogLevelName logLevelNames[] = {
+    { "TRACE", LOG_LEVEL_TRACE },
+    { "VERBOSE", LOG_LEVEL_TRACE },
+    { "DEBUG", LOG_LEVEL_DEBUG },
+    { "INFO", LOG_LEVEL_INFO },
+    { "WARN", LOG_LEVEL_WARNING },
+    { "WARNING", LOG_LEVEL_WARNING },
+    { "ERR", LOG_LEVEL_ERROR },
+    { "ERROR", LOG_LEVEL_ERROR },
+    { "FATAL", LOG_LEVEL_FATAL },
+    { "CRITICAL", LOG_LEVEL_FATAL },
+};
+
+// The severity is part of the line prefix, so we only look at the first few words.
+// This keeps messages like "... no error occured" from being classified as errors.
+// Words are counted instead of tokens, because timestamps in the prefix consist of many tokens.
+#define PARSER_LEVEL_WORD_LIMIT 4
+// Same for the channel tag.
+#define PARSER_CHANNEL_WORD_LIMIT 4
+
+static LogLevel detectLogLevel(StrView word)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(logLevelNames); ++i) {
+        const char* name = logLevelNames[i].name;
+        if (strlen(name) == word.len && strncasecmp(name, word.txt, word.len) == 0) {
+            return logLevelNames[i].level;
+        }
+    }
+
+    return LOG_LEVEL_NONE;
+}
+
+static bool isSpecialToken(LexerToken token, char c)
+{
+    return token.kind == TOK_SINGLE_SPECIAL && *token.str.txt == c;
+}
+
+static uint16_t internChannel(Parser* parser, StrView name)
+{
+    uint32_t id = st_intern(&parser->channelNames, name);
+    if (id >= BUSCHLA_CHANNEL_NONE) {
+        // NOTE: Channel ids are stored as 16-bit, lines of any further channels are treated as untagged.
+        return BUSCHLA_CHANNEL_NONE;
+    }
+
+    if (id == parser->channelLineCounts.count) {
+        uint32_t zero = 0;
+        da_append(&parser->channelLineCounts, zero);
+    }
+
+    return (uint16_t)id;
+}
+
+static bool strViewEqualsIgnoreCase(StrView str, const char* name)
+{
+    return name != NULL && strlen(name) == str.len && strncasecmp(name, str.txt, str.len) == 0;
+}
+
+static uint32_t internKey(Parser* parser, StrView key)
+{
+    uint32_t keyCount = parser->keyNames.strings.count;
+    uint32_t keyId = st_intern(&parser->keyNames, key);
+    if (keyId == keyCount) {
+        ValueSketch* sketch = da_append_get(&parser->keySketches);
+        memset(sketch, 0, sizeof(ValueSketch));
+
+        if (parser->frameKeyId == PARSER_NO_KEY && strViewEqualsIgnoreCase(key, parser->frameKey)) {
+            parser->frameKeyId = keyId;
+        }
+        if (parser->frameTimeKeyId == PARSER_NO_KEY && strViewEqualsIgnoreCase(key, parser->frameTimeKey)) {
+            parser->frameTimeKeyId = keyId;
+        }
+    }
+    return keyId;
+}
+
+static void addValueForKey(Parser* parser, uint32_t lineIndex, uint32_t keyId, double value)
+{
+    da_append(&parser->valueKeys, keyId);
+    da_append(&parser->valueLines, lineIndex);
+    da_append(&parser->values, value);
+
+    HitchDetector* detector = &parser->hitchDetector;
+    if (keyId == parser->frameTimeKeyId) {
+        detector->lineHasFrameTime = true;
+        detector->lineFrameTime = value;
+    }
+    else if (keyId == parser->frameKeyId) {
+        detector->lineHasFrameNumber = true;
+        detector->lineFrameNumber = value;
+    }
+}
+
+static void addValue(Parser* parser, uint32_t lineIndex, StrView key, double value)
+{
+    addValueForKey(parser, lineIndex, internKey(parser, key), value);
+
+    debugPrintf("found value!\n'%.*s' = %f\n", key.len, key.txt, value);
+}
+
+static void addField(Parser* parser, uint32_t lineIndex, StrView key, StrView value)
+{
+    uint32_t fieldCount = parser->fieldNames.strings.count;
+    uint32_t fieldId = st_intern(&parser->fieldNames, key);
+    if (fieldId == fieldCount) {
+        StringTable* dictionary = da_append_get(&parser->fieldDictionaries);
+        memset(dictionary, 0, sizeof(StringTable));
+    }
+
+    uint32_t code = st_intern(parser->fieldDictionaries.items + fieldId, value);
+    da_append(&parser->fieldIds, fieldId);
+    da_append(&parser->fieldLines, lineIndex);
+    da_append(&parser->fieldCodes, code);
+}
+
+static uint32_t internKeyword(Parser* parser, StrView word)
+{
+    uint32_t keywordId = st_intern(&parser->keywordNames, word);
+    if (keywordId == parser->keywordLastLines.count) {
+        uint32_t none = 0xFFFFFFFF;
+        da_append(&parser->keywordLastLines, none);
+    }
+    return keywordId;
+}
+
+static void addKeywordId(Parser* parser, uint32_t lineIndex, uint32_t keywordId)
+{
+    if (parser->keywordLastLines.items[keywordId] == lineIndex) {
+        return;
+    }
+    parser->keywordLastLines.items[keywordId] = lineIndex;
+
+    da_append(&parser->keywordIds, keywordId);
+    da_append(&parser->keywordLines, lineIndex);
+}
+
+static void addEntity(Parser* parser, uint32_t lineIndex, StrView name)
+{
+    uint32_t entityId = st_intern(&parser->entityNames, name);
+    if (entityId == parser->entityLastLines.count) {
+        uint32_t none = 0xFFFFFFFF;
+        da_append(&parser->entityLastLines, none);
+    }
+    if (parser->entityLastLines.items[entityId] == lineIndex) {
+        return;
+    }
+    parser->entityLastLines.items[entityId] = lineIndex;
+
+    da_append(&parser->entityIds, entityId);
+    da_append(&parser->entityLines, lineIndex);
+}
+
+// 0x7F3A and 0x7f3a are the same entity.
+static void addHexEntity(Parser* parser, uint32_t lineIndex, StrView hex)
+{
+    uint32_t length = hex.len < PARSER_MAX_ENTITY_LENGTH ? hex.len : PARSER_MAX_ENTITY_LENGTH;
+    for (uint32_t i = 0; i < length; ++i) {
+        char c = hex.txt[i];
+        parser->entityName[i] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+    StrView name = { parser->entityName, length };
+    addEntity(parser, lineIndex, name);
+}
+
+// Values of --entity-key keys, named "<key>=<value>".
+static void addKeyEntity(Parser* parser, uint32_t lineIndex, StrView key, StrView value)
+{
+    bool isEntityKey = false;
+    for (uint32_t i = 0; i < parser->entityKeyCount && !isEntityKey; ++i) {
+        isEntityKey = strViewEqualsIgnoreCase(key, parser->entityKeys[i]);
+    }
+    if (!isEntityKey || value.len == 0) {
+        return;
+    }
+
+    int length = snprintf(parser->entityName, PARSER_MAX_ENTITY_LENGTH, "%.*s=%.*s", (int)key.len, key.txt, (int)value.len, value.txt);
+    StrView name = { parser->entityName, length < PARSER_MAX_ENTITY_LENGTH ? (uint32_t)length : PARSER_MAX_ENTITY_LENGTH - 1 };
+    addEntity(parser, lineIndex, name);
+}
+
+static void addKeyword(Parser* parser, uint32_t lineIndex, StrView word)
+{
+    if (word.len < PARSER_KEYWORD_MIN_LENGTH) {
+        return;
+    }
+
+    addKeywordId(parser, lineIndex, internKeyword(parser, word));
+}
+
+// Finds the next word (same definition as TOK_WORD) in [*p, end), returns false if there is none.
+static bool nextWord(const char** p, const char* end, StrView* wordOut)
+{
+    const char* c = *p;
+    while (c < end && !(isLetter(*c) || *c == '_')) {
+        ++c;
+    }
+
+    wordOut->txt = c;
+    while (c < end && (isLetter(*c) || *c == '_')) {
+        ++c;
+    }
+    wordOut->len = (uint32_t)(c - wordOut->txt);
+
+    *p = c;
+    return wordOut->len > 0;
+}
+
+// Adds every word in str as a keyword.
+static void addKeywordsFromText(Parser* parser, uint32_t lineIndex, StrView str)
+{
+    const char* p = str.txt;
+    StrView word;
+    while (nextWord(&p, str.txt + str.len, &word)) {
+        addKeyword(parser, lineIndex, word);
+    }
+}
+
+// Runs for every byte of the log: one table lookup per trigram, a posting only for its first occurrence in a block.
+static void addTrigrams(Parser* parser, uint32_t lineIndex, StrView str)
+{
+    if (str.len < 3) {
+        return;
+    }
+
+    if (parser->trigramIds == NULL) {
+        // Large, but only the pages of trigrams that actually occur are ever touched.
+        parser->trigramIds = (uint32_t*)calloc(PARSER_TRIGRAM_COUNT, sizeof(uint32_t));
+        assert(parser->trigramIds != NULL);
+    }
+
+    uint32_t block = lineIndex / BUSCHLA_TRIGRAM_BLOCK_LINES;
+    uint32_t trigram = BUSCHLA_TRIGRAM(0, str.txt[0], str.txt[1]);
+    for (uint32_t i = 2; i < str.len; ++i) {
+        trigram = ((trigram << 8) | (uint8_t)str.txt[i]) & (PARSER_TRIGRAM_COUNT - 1);
+
+        uint32_t id = parser->trigramIds[trigram];
+        if (id == 0) {
+            da_append(&parser->trigramKeys, trigram);
+            uint32_t noBlock = 0xFFFFFFFF;
+            da_append(&parser->trigramLastBlocks, noBlock);
+            id = parser->trigramKeys.count;
+            parser->trigramIds[trigram] = id;
+        }
+        --id;
+
+        if (parser->trigramLastBlocks.items[id] == block) {
+            continue;
+        }
+        parser->trigramLastBlocks.items[id] = block;
+        da_append(&parser->trigramPostingIds, id);
+        da_append(&parser->trigramPostingBlocks, block);
+    }
+}
+
+// Numbers are parsed from the token text, which is followed by a non-digit or the terminating null.
+static double parseNumber(StrView str)
+{
+    return strtod(str.txt, NULL);
+}
+
+// Keeps window sorted while replacing oldValue (if removeOld) by newValue.
+static void updateSortedWindow(double* sorted, uint32_t count, bool removeOld, double oldValue, double newValue)
+{
+    if (removeOld) {
+        uint32_t i = 0;
+        while (i + 1 < count && sorted[i] != oldValue) {
+            ++i;
+        }
+        memmove(sorted + i, sorted + i + 1, (count - i - 1) * sizeof(double));
+        --count;
+    }
+
+    uint32_t i = count;
+    while (i > 0 && sorted[i - 1] > newValue) {
+        sorted[i] = sorted[i - 1];
+        --i;
+    }
+    sorted[i] = newValue;
+}
+
+// Median absolute deviation of a sorted array: walks outwards from the median,
+// the deviations on both sides are already sorted.
+static double sortedMad(const double* sorted, uint32_t count, double median)
+{
+    uint32_t mid = count / 2;
+    int left = (int)mid - 1;
+    uint32_t right = mid;
+    double deviation = 0.0;
+    for (uint32_t k = 0; k <= count / 2; ++k) {
+        double leftDeviation = left >= 0 ? median - sorted[left] : 1e300;
+        double rightDeviation = right < count ? sorted[right] - median : 1e300;
+        if (leftDeviation < rightDeviation) {
+            deviation = leftDeviation;
+            --left;
+        }
+        else {
+            deviation = rightDeviation;
+            ++right;
+        }
+    }
+    return deviation;
+}
+
+// Called once per line that has a frame time sample, all lines since the previous one belong to this frame.
+static void addFrameTime(Parser* parser, uint32_t lineIndex, double duration)
+{
+    HitchDetector* detector = &parser->hitchDetector;
+
+    if (detector->windowCount >= PARSER_HITCH_MIN_FRAMES) {
+        double median = detector->sorted[detector->windowCount / 2];
+        double spread = 1.4826 * sortedMad(detector->sorted, detector->windowCount, median);
+        // Perfectly stable frame times would make every tiny bump a hitch.
+        if (spread < 0.01 * median) {
+            spread = 0.01 * median;
+        }
+
+        double severity = spread > 0.0 ? (duration - median) / spread : 0.0;
+        if (severity >= PARSER_HITCH_MIN_SEVERITY && duration >= median * PARSER_HITCH_MIN_RATIO) {
+            BuschlaHitch* hitch = da_append_get(&parser->hitches);
+            hitch->frame = detector->lineHasFrameNumber ? (uint32_t)detector->lineFrameNumber : detector->frameCount;
+            hitch->duration = (float)duration;
+            hitch->median = (float)median;
+            hitch->severity = (float)severity;
+            hitch->lines.first = detector->frameFirstLine;
+            hitch->lines.count = lineIndex + 1 - detector->frameFirstLine;
+        }
+    }
+
+    bool windowFull = detector->windowCount == PARSER_HITCH_WINDOW;
+    double oldest = detector->window[detector->windowHead];
+    updateSortedWindow(detector->sorted, detector->windowCount, windowFull, oldest, duration);
+    detector->window[detector->windowHead] = duration;
+    detector->windowHead = (detector->windowHead + 1) % PARSER_HITCH_WINDOW;
+    if (!windowFull) {
+        ++detector->windowCount;
+    }
+
+    ++detector->frameCount;
+    detector->frameFirstLine = lineIndex + 1;
+}
+
+// Timestamps are only looked for at the start of a line.
+#define PARSER_TIMESTAMP_SEARCH_BYTES 64
+
+static bool parseDigits(const char* p, uint32_t count, int* valueOut)
+{
+    int value = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!isDigit(p[i])) {
+            return false;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    *valueOut = value;
+    return true;
+}
+
+// Finds the first "HH:MM:SS" (with optional ".fff" or ",fff") near the start of the line,
+// e.g. "[12:01:02.345]" or "2024-05-01T12:01:02Z". Returns seconds since midnight.
+// Dates are ignored, inputs usually disagree on whether they log one.
+static bool parseLineTimestamp(StrView line, double* secondsOut)
+{
+    uint32_t searchEnd = line.len < PARSER_TIMESTAMP_SEARCH_BYTES ? line.len : PARSER_TIMESTAMP_SEARCH_BYTES;
+    for (uint32_t i = 0; i + 8 <= searchEnd; ++i) {
+        const char* p = line.txt + i;
+        int hours, minutes, seconds;
+        if ((i > 0 && isDigit(p[-1])) || p[2] != ':' || p[5] != ':' ||
+            !parseDigits(p, 2, &hours) || !parseDigits(p + 3, 2, &minutes) || !parseDigits(p + 6, 2, &seconds)) {
+            continue;
+        }
+
+        double result = hours * 3600.0 + minutes * 60.0 + seconds;
+        uint32_t end = i + 8;
+        if (end + 1 < line.len && (line.txt[end] == '.' || line.txt[end] == ',') && isDigit(line.txt[end + 1])) {
+            double scale = 0.1;
+            for (++end; end < line.len && isDigit(line.txt[end]); ++end) {
+                result += (line.txt[end] - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+
+        *secondsOut = result;
+        return true;
+    }
+    return false;
+}
+
+static bool isScopeSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Finds the words "BEGIN <name>" or "END <name>" in a line (upper case only, "end" is too common in messages).
+static bool findScopeMarker(StrView line, bool* beginOut, StrView* nameOut)
+{
+    // Most lines have neither.
+    if (findBytes(line.txt, line.len, "BEGIN ", 6) == NULL && findBytes(line.txt, line.len, "END ", 4) == NULL) {
+        return false;
+    }
+
+    const char* p = line.txt;
+    const char* end = line.txt + line.len;
+    while (p < end) {
+        while (p < end && isScopeSpace(*p)) {
+            ++p;
+        }
+        const char* word = p;
+        while (p < end && !isScopeSpace(*p)) {
+            ++p;
+        }
+
+        size_t wordLength = p - word;
+        bool begin = wordLength == 5 && memcmp(word, "BEGIN", 5) == 0;
+        if (!begin && !(wordLength == 3 && memcmp(word, "END", 3) == 0)) {
+            continue;
+        }
+
+        while (p < end && isScopeSpace(*p)) {
+            ++p;
+        }
+        const char* name = p;
+        while (p < end && !isScopeSpace(*p)) {
+            ++p;
+        }
+        // "BEGIN Render:" and "BEGIN Render" are the same scope.
+        const char* nameEnd = p;
+        while (nameEnd > name && (nameEnd[-1] == ':' || nameEnd[-1] == ',' || nameEnd[-1] == ';')) {
+            --nameEnd;
+        }
+        if (nameEnd == name) {
+            return false;
+        }
+
+        *beginOut = begin;
+        nameOut->txt = name;
+        nameOut->len = (uint32_t)(nameEnd - name);
+        return true;
+    }
+    return false;
+}
+
+// Pairs BEGIN/END lines into scopes.
+// An END closes the innermost open scope with its name, and all scopes opened inside of it that did not end yet.
+// An END without an open scope of that name is ignored.
+static void matchScopeMarker(Parser* parser, uint32_t lineIndex)
+{
+    StrView line = parser->logLines.items[lineIndex].str;
+    bool begin;
+    StrView name;
+    if (!findScopeMarker(line, &begin, &name)) {
+        return;
+    }
+
+    double time = NAN;
+    parseLineTimestamp(line, &time);
+
+    uint32_t nameId = st_intern(&parser->scopeNames, name);
+    Uint32s* open = &parser->openScopes;
+    if (begin) {
+        BuschlaScope* scope = da_append_get(&parser->scopes);
+        scope->name.offset = nameId;
+        scope->name.len = name.len;
+        scope->firstLine = lineIndex;
+        scope->lastLine = BUSCHLA_SCOPE_NONE;
+        scope->depth = open->count;
+        scope->parent = open->count > 0 ? open->items[open->count - 1] : BUSCHLA_SCOPE_NONE;
+        scope->duration = NAN;
+        uint32_t scopeIndex = parser->scopes.count - 1;
+        da_append(&parser->scopeBeginTimes, time);
+        da_append(open, scopeIndex);
+        return;
+    }
+
+    uint32_t match = open->count;
+    while (match > 0 && parser->scopes.items[open->items[match - 1]].name.offset != nameId) {
+        --match;
+    }
+    if (match == 0) {
+        return;
+    }
+
+    // Values of this line are the ones not sketched yet, see finishLine.
+    double lineValue = parser->values.count > parser->sketchedValueCount ? parser->values.items[parser->values.count - 1] : NAN;
+    while (open->count >= match) {
+        uint32_t scopeIndex = open->items[--open->count];
+        BuschlaScope* scope = parser->scopes.items + scopeIndex;
+        scope->lastLine = lineIndex;
+        if (open->count + 1 != match) {
+            // Scopes inside that never ended have no duration.
+            continue;
+        }
+
+        double beginTime = parser->scopeBeginTimes.items[scopeIndex];
+        if (!isnan(beginTime) && !isnan(time)) {
+            double seconds = time - beginTime;
+            // Past midnight.
+            if (seconds < 0.0) {
+                seconds += 86400.0;
+            }
+            scope->duration = (float)(seconds * 1000.0);
+        }
+        else {
+            scope->duration = (float)lineValue;
+        }
+    }
+}
+
+// Counts the matches of every alert rule, lines belong to the frame that the next frame time ends.
+static void evaluateAlertRules(Parser* parser, uint32_t lineIndex)
+{
+    StrView line = parser->logLines.items[lineIndex].str;
+    uint64_t lineStep = parser->alertLineStep++;
+    for (uint32_t i = 0; i < parser->alertRules.count; ++i) {
+        AlertRule* rule = parser->alertRules.items + i;
+        uint32_t matches = findBytes(line.txt, line.len, rule->pattern.txt, rule->pattern.len) != NULL ? 1 : 0;
+        uint64_t step = rule->perFrame ? parser->hitchDetector.frameCount : lineStep;
+        if (!ar_update(rule, step, matches)) {
+            continue;
+        }
+
+        BuschlaAlert* alert = da_append_get(&parser->alerts);
+        alert->rule.offset = i;
+        alert->rule.len = 0;
+        alert->line = lineIndex;
+        alert->count = rule->total;
+        if (parser->printAlerts) {
+            printf("ALERT line %u: %s (%u in window)\n", parser->logLines.items[lineIndex].lineNum, rule->text, rule->total);
+            fflush(stdout);
+        }
+    }
+}
+
+// Replaces every number (decimal, fractional or 0x hex) with a single '#'.
+// out needs room for line.len bytes, returns the length of the template.
+static uint32_t maskNumbers(StrView line, char* out)
+{
+    uint32_t length = 0;
+    uint32_t i = 0;
+    while (i < line.len) {
+        const char* p = line.txt + i;
+        if (!isDigit(*p)) {
+            out[length++] = *p;
+            ++i;
+            continue;
+        }
+
+        if (p[0] == '0' && i + 2 < line.len && (p[1] == 'x' || p[1] == 'X') && isHexDigit(p[2])) {
+            i += 2;
+            while (i < line.len && isHexDigit(line.txt[i])) {
+                ++i;
+            }
+        }
+        else {
+            while (i < line.len && (isDigit(line.txt[i]) || (line.txt[i] == '.' && i + 1 < line.len && isDigit(line.txt[i + 1])))) {
+                ++i;
+            }
+        }
+        out[length++] = '#';
+    }
+    return length;
+}
+
+static void countLineTemplate(Parser* parser, uint32_t lineIndex)
+{
+    if (parser->templates.capacity == 0) {
+        tk_init(&parser->templates, PARSER_TEMPLATE_COUNT);
+    }
+
+    StrView line = parser->logLines.items[lineIndex].str;
+    if (line.len > parser->templateTextCapacity) {
+        parser->templateTextCapacity = line.len < 4096 ? 4096 : line.len;
+        parser->templateText = (char*)realloc(parser->templateText, parser->templateTextCapacity);
+        assert(parser->templateText != NULL);
+    }
+
+    uint32_t length = maskNumbers(line, parser->templateText);
+    tk_add(&parser->templates, hashBytes(parser->templateText, length), lineIndex);
+}
+
+static void finishLine(Parser* parser, LogLevel level, uint16_t channel)
+{
+    countLineTemplate(parser, parser->levels.count);
+    matchScopeMarker(parser, parser->levels.count);
+    evaluateAlertRules(parser, parser->levels.count);
+
+    HitchDetector* detector = &parser->hitchDetector;
+    if (detector->lineHasFrameTime) {
+        addFrameTime(parser, parser->levels.count, detector->lineFrameTime);
+    }
+    detector->lineHasFrameTime = false;
+    detector->lineHasFrameNumber = false;
+
+    for (uint32_t i = parser->sketchedValueCount; i < parser->values.count; ++i) {
+        vs_add(parser->keySketches.items + parser->valueKeys.items[i], parser->values.items[i]);
+    }
+    parser->sketchedValueCount = parser->values.count;
+
+    uint8_t levelByte = (uint8_t)level;
+    da_append(&parser->levels, levelByte);
+
+    da_append(&parser->lineChannels, channel);
+    if (channel != BUSCHLA_CHANNEL_NONE) {
+        ++parser->channelLineCounts.items[channel];
+    }
+
+    if (parser->storeTokens) {
+        da_append(&parser->lineTokens, parser->tokens.count);
+    }
+}
+
+static_assert(TOK_PATH <= 0xF, "TokenKind has to fit into the 4 kind bits of BuschlaToken");
+
+static void addToken(Parser* parser, LogLine* line, LexerToken token)
+{
+    uint32_t offset = (uint32_t)(token.str.txt - line->str.txt);
+    if (offset > BUSCHLA_TOKEN_MAX_OFFSET || token.str.len > BUSCHLA_TOKEN_MAX_LEN) {
+        return;
+    }
+
+    BuschlaToken packed = BUSCHLA_TOKEN(token.kind, offset, token.str.len);
+    da_append(&parser->tokens, packed);
+}
+
+// Words stop at digits, so "Forest_02" is two tokens: a field value runs to the next space or delimiter.
+static StrView extendFieldValue(StrView line, StrView value)
+{
+    const char* end = value.txt + value.len;
+    const char* lineEnd = line.txt + line.len;
+    while (end < lineEnd && *end != ' ' && *end != '\t' && strchr(",;)]}\"'", *end) == NULL) {
+        ++end;
+    }
+    value.len = (uint32_t)(end - value.txt);
+    return value;
+}
+
+template <const LexerDialect& Dialect>
+static void parseTextLine(Parser* parser, LogLine* line, uint32_t lineIndex)
+{
+    // go through line token by token, try to parse frame number, frame time, values and keywords.
+
+    Lexer lex;
+    memcpy(&lex.str, &line->str, sizeof(StrView));
+    lex.pos = lex.str.txt;
+
+    debugPrintf("parsing '%s':\n", line->str.txt);
+
+#define PARSER_TOKEN_LOOKBACK 5
+    LexerToken history[PARSER_TOKEN_LOOKBACK];
+    memset(history, 0, sizeof(history));
+
+    int historyHeadIndex = 0;
+    int wordIndex = 0;
+    LogLevel level = LOG_LEVEL_NONE;
+    uint16_t channel = BUSCHLA_CHANNEL_NONE;
+#define GET_HISTORY_INDEX(i) ((historyHeadIndex + (i) + PARSER_TOKEN_LOOKBACK) % PARSER_TOKEN_LOOKBACK)
+#define HISTORY_TOKEN(i) history[GET_HISTORY_INDEX(i)]
+    while (nextTokenSpecialized<Dialect>(&lex)) {
+        LexerToken currentToken = lex.token;
+        debugPrintf("(%s): '%.*s'\n", tokenKindStrs[currentToken.kind], currentToken.str.len, currentToken.str.txt);
+        if (lex.token.str.len == 0) {
+            assert(0 && "WHAT THE HELL=!=?");
+        }
+
+        history[historyHeadIndex] = currentToken;
+
+        if (parser->storeTokens) {
+            addToken(parser, line, currentToken);
+        }
+
+        LexerToken previousToken = HISTORY_TOKEN(-1);
+        LexerToken previousPreviousToken = HISTORY_TOKEN(-2);
+        // key: value and key=value
+        if ((currentToken.kind == TOK_INTEGER || currentToken.kind == TOK_FLOAT) &&
+                (isSpecialToken(previousToken, ':') || isSpecialToken(previousToken, '=')) &&
+                previousPreviousToken.kind == TOK_WORD) {
+            addValue(parser, lineIndex, previousPreviousToken.str, parseNumber(currentToken.str));
+        }
+        // key: word and key=word, "ERROR: message" is not a field.
+        else if ((currentToken.kind == TOK_WORD || currentToken.kind == TOK_PATH) &&
+                (isSpecialToken(previousToken, ':') || isSpecialToken(previousToken, '=')) &&
+                previousPreviousToken.kind == TOK_WORD &&
+                detectLogLevel(previousPreviousToken.str) == LOG_LEVEL_NONE) {
+            addField(parser, lineIndex, previousPreviousToken.str, extendFieldValue(line->str, currentToken.str));
+        }
+
+        if (currentToken.kind == TOK_WORD) {
+            addKeyword(parser, lineIndex, currentToken.str);
+        }
+
+        if (currentToken.kind == TOK_HEX) {
+            addHexEntity(parser, lineIndex, currentToken.str);
+        }
+        else if (parser->entityKeyCount > 0 && currentToken.kind != TOK_SINGLE_SPECIAL &&
+                (isSpecialToken(previousToken, ':') || isSpecialToken(previousToken, '=')) &&
+                previousPreviousToken.kind == TOK_WORD) {
+            addKeyEntity(parser, lineIndex, previousPreviousToken.str, extendFieldValue(line->str, currentToken.str));
+        }
+
+        if (level == LOG_LEVEL_NONE &&
+                wordIndex < PARSER_LEVEL_WORD_LIMIT &&
+                currentToken.kind == TOK_WORD) {
+            level = detectLogLevel(currentToken.str);
+        }
+
+        // A channel tag is a single word in brackets, e.g. [Render]
+        // Level tags like [ERROR] look the same, those are not channels.
+        if (channel == BUSCHLA_CHANNEL_NONE &&
+                wordIndex <= PARSER_CHANNEL_WORD_LIMIT &&
+                isSpecialToken(currentToken, ']') &&
+                previousToken.kind == TOK_WORD &&
+                isSpecialToken(previousPreviousToken, '[') &&
+                detectLogLevel(previousToken.str) == LOG_LEVEL_NONE) {
+            channel = internChannel(parser, previousToken.str);
+        }
+
+        historyHeadIndex = (historyHeadIndex + 1) % PARSER_TOKEN_LOOKBACK;
+        if (currentToken.kind == TOK_WORD) {
+            ++wordIndex;
+        }
+    }
+
+    finishLine(parser, level, channel);
+}
+
+// "0x" followed by hex digits only, like TOK_HEX.
+static bool isHexString(StrView str)
+{
+    if (str.len < 3 || str.txt[0] != '0' || str.txt[1] != 'x') {
+        return false;
+    }
+    for (uint32_t i = 2; i < str.len; ++i) {
+        if (!isHexDigit(str.txt[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool jsonKeyIs(StrView key, const char* name)
+{
+    return strlen(name) == key.len && strncasecmp(name, key.txt, key.len) == 0;
+}
+
+// Top-level fields of a JSON object go into the same structures as text logs:
+// numbers (and booleans) become values, strings become fields and keywords.
+// Well known fields ("level", "channel", ...) fill the level and channel columns.
+static void parseJsonLine(Parser* parser, LogLine* line, uint32_t lineIndex)
+{
+    LogLevel level = LOG_LEVEL_NONE;
+    uint16_t channel = BUSCHLA_CHANNEL_NONE;
+
+    if (!json_parseLine(&parser->json, line->str)) {
+        debugPrintf("line %u is not a JSON object, only using the fields found so far\n", line->lineNum);
+    }
+
+    for (uint32_t i = 0; i < parser->json.fields.count; ++i) {
+        JsonField* field = parser->json.fields.items + i;
+        if (field->kind == JSON_VALUE_NUMBER || field->kind == JSON_VALUE_STRING) {
+            addKeyEntity(parser, lineIndex, field->key, field->value);
+        }
+
+        switch (field->kind) {
+        case JSON_VALUE_NUMBER:
+            addValue(parser, lineIndex, field->key, parseNumber(field->value));
+            break;
+        case JSON_VALUE_TRUE:
+        case JSON_VALUE_FALSE:
+            addValue(parser, lineIndex, field->key, field->kind == JSON_VALUE_TRUE ? 1.0 : 0.0);
+            break;
+        case JSON_VALUE_STRING: {
+            if (level == LOG_LEVEL_NONE &&
+                (jsonKeyIs(field->key, "level") || jsonKeyIs(field->key, "severity"))) {
+                level = detectLogLevel(field->value);
+            }
+            else if (channel == BUSCHLA_CHANNEL_NONE && field->value.len > 0 &&
+                (jsonKeyIs(field->key, "channel") || jsonKeyIs(field->key, "category"))) {
+                channel = internChannel(parser, field->value);
+            }
+            else {
+                if (isHexString(field->value)) {
+                    addHexEntity(parser, lineIndex, field->value);
+                }
+                if (field->value.len > 0) {
+                    addField(parser, lineIndex, field->key, field->value);
+                }
+                addKeywordsFromText(parser, lineIndex, field->value);
+            }
+        } break;
+        default:
+            break;
+        }
+    }
+
+    finishLine(parser, level, channel);
+}
+
+static void parseLine(Parser* parser, LogLine* line)
+{
+    uint32_t lineIndex = parser->logLines.count - 1;
+    assert(line == parser->logLines.items + lineIndex);
+
+    if (!parser->skipTrigrams) {
+        addTrigrams(parser, lineIndex, line->str);
+    }
+
+    switch (parser->dialect) {
+    case DIALECT_JSON:
+        parseJsonLine(parser, line, lineIndex);
+        break;
+    case DIALECT_COLUMNS:
+        parseTextLine<lexerDialectColumns>(parser, line, lineIndex);
+        break;
+    case DIALECT_STATS:
+        parseTextLine<lexerDialectStats>(parser, line, lineIndex);
+        break;
+    default:
+        parseTextLine<lexerDialectText>(parser, line, lineIndex);
+        break;
+    }
+}
+
+//# -------------- Binary Logs (buschla_log.h) -------------- #//
+
+typedef struct {
+    FILE* stream;
+    uint8_t* buffer;
+    uint32_t capacity;
+    uint32_t pos;
+    uint32_t size;
+} BinaryReader;
+
+#define BINARY_READER_BLOCK_SIZE (1024 * 1024)
+// Larger reads (string and format lengths) can only come from a corrupt stream.
+#define BINARY_READER_MAX_SIZE (64u << 20)
+
+// Returns pointer to the next size bytes of the stream (valid until the next call), NULL at the end of the stream.
+// Sizes above BINARY_READER_MAX_SIZE end the stream as well.
+static const uint8_t* binaryRead(BinaryReader* reader, uint32_t size)
+{
+    if (size > BINARY_READER_MAX_SIZE) {
+        fprintf(stderr, "binary record of %u bytes, the stream is corrupt\n", size);
+        return NULL;
+    }
+
+    if (size > reader->size - reader->pos) {
+        uint32_t remaining = reader->size - reader->pos;
+        if (size > reader->capacity) {
+            reader->capacity = size + BINARY_READER_BLOCK_SIZE;
+        }
+        if (reader->buffer == NULL || reader->capacity > BINARY_READER_BLOCK_SIZE) {
+            uint8_t* buffer = (uint8_t*)malloc(reader->capacity);
+            assert(buffer != NULL);
+            memcpy(buffer, reader->buffer + reader->pos, remaining);
+            free(reader->buffer);
+            reader->buffer = buffer;
+        }
+        else {
+            memmove(reader->buffer, reader->buffer + reader->pos, remaining);
+        }
+
+        reader->pos = 0;
+        reader->size = remaining + (uint32_t)fread(reader->buffer + remaining, 1, reader->capacity - remaining, reader->stream);
+        if (size > reader->size) {
+            return NULL;
+        }
+    }
+
+    const uint8_t* result = reader->buffer + reader->pos;
+    reader->pos += size;
+    return result;
+}
+
+#define BINARY_READ(reader, type, valueOut) { \
+    const uint8_t* bytes = binaryRead((reader), sizeof(type)); \
+    if (bytes == NULL) { \
+        return false; \
+    } \
+    memcpy((valueOut), bytes, sizeof(type)); \
+}
+
+// Length modifiers _buschla_log_register accepts for a type, they are replaced when the conversion is compiled.
+static bool isLengthModifier(StrView length, uint8_t type)
+{
+    if (length.len == 0) {
+        return true;
+    }
+    if (type == BUSCHLA_LOG_ARG_F64) {
+        return length.len == 1 && length.txt[0] == 'l';
+    }
+    if (type != BUSCHLA_LOG_ARG_I64 && type != BUSCHLA_LOG_ARG_U64) {
+        return false;
+    }
+    if (length.len == 1) {
+        return strchr("hlqjzt", length.txt[0]) != NULL;
+    }
+    return length.len == 2 && length.txt[0] == length.txt[1] && (length.txt[0] == 'h' || length.txt[0] == 'l');
+}
+
+// Same rules as _buschla_log_register, returns the end of the conversion at p (which points behind the '%').
+// The format comes from the log file and goes to snprintf: returns NULL unless the conversion matches type
+// (diouxXc for integers, eEfFgGaA for F64, s for strings), so %n, long double and '*' are rejected,
+// as are widths and precisions with more than 3 digits.
+static const char* scanConversion(const char* p, const char* end, char* conversionOut, uint8_t type)
+{
+    const char* flagsStart = p;
+    uint32_t digitCount = 0;
+    while (p < end && strchr("-+ #0123456789.", *p) != NULL) {
+        digitCount = *p >= '0' && *p <= '9' ? digitCount + 1 : 0;
+        if (digitCount > 3) {
+            return NULL;
+        }
+        ++p;
+    }
+    const char* flagsEnd = p;
+    StrView length = { p, 0 };
+    while (p < end && strchr("hlLqjzt", *p) != NULL) {
+        ++p;
+    }
+    length.len = (uint32_t)(p - length.txt);
+    if (p == end || *p == '\0' || !isLengthModifier(length, type)) {
+        return NULL;
+    }
+
+    char c = *p;
+    const char* conversions = type == BUSCHLA_LOG_ARG_F64 ? "eEfFgGaA" : type == BUSCHLA_LOG_ARG_STR ? "s" : "diouxXc";
+    if (strchr(conversions, c) == NULL) {
+        return NULL;
+    }
+
+    // Integers are passed as 64 bits, except for %c which takes an int.
+    const char* lengthOut = (type == BUSCHLA_LOG_ARG_I64 || type == BUSCHLA_LOG_ARG_U64) && c != 'c' ? "ll" : "";
+    snprintf(conversionOut, 16, "%%%.*s%s%c", (int)(flagsEnd - flagsStart) > 8 ? 8 : (int)(flagsEnd - flagsStart), flagsStart, lengthOut, c);
+    return p + 1;
+}
+
+// Returns the key of "key: " or "key=" at the end of piece.
+static bool findValueKey(StrView piece, StrView* keyOut)
+{
+    const char* p = piece.txt + piece.len;
+    while (p > piece.txt && p[-1] == ' ') {
+        --p;
+    }
+    if (p == piece.txt || (p[-1] != ':' && p[-1] != '=')) {
+        return false;
+    }
+    --p;
+    while (p > piece.txt && p[-1] == ' ') {
+        --p;
+    }
+
+    const char* keyEnd = p;
+    while (p > piece.txt && (isLetter(p[-1]) || p[-1] == '_')) {
+        --p;
+    }
+    keyOut->txt = p;
+    keyOut->len = (uint32_t)(keyEnd - p);
+    return keyOut->len > 0;
+}
+
+// Splits the format string into literal pieces and conversions, and does all the work that
+// the text dialects do per line (level, channel, value keys, keywords) once per format.
+static void compileBinaryFormat(Parser* parser, uint32_t id, uint8_t argCount, const uint8_t* argTypes, StrView text)
+{
+    while (parser->binaryFormats.count < id) {
+        BinaryFormat* empty = da_append_get(&parser->binaryFormats);
+        memset(empty, 0, sizeof(BinaryFormat));
+    }
+
+    BinaryFormat* format = parser->binaryFormats.items + id - 1;
+    memset(format, 0, sizeof(BinaryFormat));
+    format->valid = true;
+    format->argCount = argCount;
+    memcpy(format->argTypes, argTypes, argCount);
+
+    const char* p = text.txt;
+    const char* end = text.txt + text.len;
+    const char* pieceStart = p;
+    uint8_t arg = 0;
+    while (p < end && arg < format->argCount) {
+        if (*p != '%') {
+            ++p;
+            continue;
+        }
+        if (p + 1 < end && p[1] == '%') {
+            p += 2;
+            continue;
+        }
+
+        format->pieces[arg].txt = pieceStart;
+        format->pieces[arg].len = (uint32_t)(p - pieceStart);
+        p = scanConversion(p + 1, end, format->conversions[arg], format->argTypes[arg]);
+        if (p == NULL) {
+            fprintf(stderr, "binary format %u: conversion %u does not match its argument, the events of this format are skipped\n", id, arg);
+            format->rejected = true;
+            return;
+        }
+        pieceStart = p;
+
+        StrView key;
+        format->keyIds[arg] = PARSER_NO_KEY;
+        if (format->argTypes[arg] != BUSCHLA_LOG_ARG_STR && findValueKey(format->pieces[arg], &key)) {
+            format->keyIds[arg] = internKey(parser, key);
+        }
+        ++arg;
+    }
+    if (arg < format->argCount) {
+        fprintf(stderr, "binary format %u has %u conversions for %u arguments, the events of this format are skipped\n", id, arg, format->argCount);
+        format->rejected = true;
+        return;
+    }
+    format->pieces[arg].txt = pieceStart;
+    format->pieces[arg].len = (uint32_t)(end - pieceStart);
+
+    // Keywords of the literal text
+    format->keywords.first = parser->binaryKeywordIds.count;
+    StrView word;
+    for (uint8_t i = 0; i <= format->argCount; ++i) {
+        const char* w = format->pieces[i].txt;
+        while (nextWord(&w, format->pieces[i].txt + format->pieces[i].len, &word)) {
+            if (word.len >= PARSER_KEYWORD_MIN_LENGTH) {
+                uint32_t keywordId = internKeyword(parser, word);
+                da_append(&parser->binaryKeywordIds, keywordId);
+            }
+        }
+    }
+    format->keywords.count = parser->binaryKeywordIds.count - format->keywords.first;
+
+    // Level and channel tags are part of the literal line prefix, e.g. "[Render] WARN ..."
+    format->level = LOG_LEVEL_NONE;
+    format->channel = BUSCHLA_CHANNEL_NONE;
+    StrView prefix = format->pieces[0];
+    const char* w = prefix.txt;
+    const char* prefixEnd = prefix.txt + prefix.len;
+    int wordIndex = 0;
+    while (nextWord(&w, prefixEnd, &word)) {
+        LogLevel level = detectLogLevel(word);
+        if (format->level == LOG_LEVEL_NONE && wordIndex < PARSER_LEVEL_WORD_LIMIT) {
+            format->level = level;
+        }
+        if (format->channel == BUSCHLA_CHANNEL_NONE && wordIndex <= PARSER_CHANNEL_WORD_LIMIT &&
+                level == LOG_LEVEL_NONE &&
+                word.txt > prefix.txt && word.txt[-1] == '[' &&
+                w < prefixEnd && *w == ']') {
+            format->channel = internChannel(parser, word);
+        }
+        ++wordIndex;
+    }
+}
+
+#define PARSER_BINARY_MAX_LINE 4096
+
+static bool parseBinaryEvent(Parser* parser, BinaryReader* reader, uint32_t lineNum, uint32_t frameKeyId, uint32_t timestampKeyId, uint64_t* firstTimestamp)
+{
+    uint32_t formatId;
+    uint64_t frame;
+    uint64_t timestamp;
+    BINARY_READ(reader, uint32_t, &formatId)
+    BINARY_READ(reader, uint64_t, &frame)
+    BINARY_READ(reader, uint64_t, &timestamp)
+
+    if (formatId == 0 || formatId > parser->binaryFormats.count || !parser->binaryFormats.items[formatId - 1].valid) {
+        fprintf(stderr, "binary event references unknown format %u\n", formatId);
+        return false;
+    }
+    BinaryFormat* format = parser->binaryFormats.items + formatId - 1;
+    if (format->rejected) {
+        // Only read the arguments, to get to the next record.
+        for (uint8_t i = 0; i < format->argCount; ++i) {
+            uint32_t argSize = sizeof(uint64_t);
+            if (format->argTypes[i] == BUSCHLA_LOG_ARG_STR) {
+                BINARY_READ(reader, uint32_t, &argSize)
+            }
+            if (binaryRead(reader, argSize) == NULL) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t lineIndex = parser->logLines.count;
+    if (*firstTimestamp == 0) {
+        *firstTimestamp = timestamp;
+    }
+
+    // Render the text, numbers go straight into the value columns.
+    char text[PARSER_BINARY_MAX_LINE];
+    uint32_t length = 0;
+#define APPEND_TEXT(txt, len) { \
+    uint32_t appendLength = (len); \
+    if (appendLength > PARSER_BINARY_MAX_LINE - 1 - length) { \
+        appendLength = PARSER_BINARY_MAX_LINE - 1 - length; \
+    } \
+    memcpy(text + length, (txt), appendLength); \
+    length += appendLength; \
+}
+#define APPEND_FORMATTED(...) { \
+    int formattedLength = snprintf(text + length, PARSER_BINARY_MAX_LINE - length, __VA_ARGS__); \
+    if (formattedLength > 0) { \
+        length += (uint32_t)formattedLength < PARSER_BINARY_MAX_LINE - 1 - length ? (uint32_t)formattedLength : PARSER_BINARY_MAX_LINE - 1 - length; \
+    } \
+}
+
+    bool hasFrameKey = false;
+    for (uint8_t i = 0; i < format->argCount; ++i) {
+        APPEND_TEXT(format->pieces[i].txt, format->pieces[i].len)
+
+        if (format->argTypes[i] == BUSCHLA_LOG_ARG_STR) {
+            uint32_t strLength;
+            BINARY_READ(reader, uint32_t, &strLength)
+            const uint8_t* str = binaryRead(reader, strLength);
+            if (str == NULL) {
+                return false;
+            }
+
+            StrView view = { (const char*)str, strLength };
+            addKeywordsFromText(parser, lineIndex, view);
+            APPEND_TEXT(str, strLength)
+            continue;
+        }
+
+        uint64_t bits;
+        BINARY_READ(reader, uint64_t, &bits)
+
+        double value;
+        switch (format->argTypes[i]) {
+        case BUSCHLA_LOG_ARG_I64:
+        case BUSCHLA_LOG_ARG_U64:
+            value = format->argTypes[i] == BUSCHLA_LOG_ARG_I64 ? (double)(int64_t)bits : (double)bits;
+            if (format->conversions[i][strlen(format->conversions[i]) - 1] == 'c') {
+                APPEND_FORMATTED(format->conversions[i], (int)bits)
+            }
+            else {
+                APPEND_FORMATTED(format->conversions[i], (unsigned long long)bits)
+            }
+            break;
+        default:
+            memcpy(&value, &bits, sizeof(double));
+            APPEND_FORMATTED(format->conversions[i], value)
+            break;
+        }
+
+        if (format->keyIds[i] != PARSER_NO_KEY) {
+            addValueForKey(parser, lineIndex, format->keyIds[i], value);
+            hasFrameKey |= format->keyIds[i] == frameKeyId;
+        }
+    }
+    APPEND_TEXT(format->pieces[format->argCount].txt, format->pieces[format->argCount].len)
+    text[length] = '\0';
+
+#undef APPEND_FORMATTED
+#undef APPEND_TEXT
+
+    // Frame and time since the first event are recorded for every event.
+    if (!hasFrameKey) {
+        addValueForKey(parser, lineIndex, frameKeyId, (double)frame);
+    }
+    addValueForKey(parser, lineIndex, timestampKeyId, (double)(timestamp - *firstTimestamp) * 1e-9);
+
+    for (uint32_t i = 0; i < format->keywords.count; ++i) {
+        addKeywordId(parser, lineIndex, parser->binaryKeywordIds.items[format->keywords.first + i]);
+    }
+
+    StrView lineView = { text, length };
+    LogLine* logLine = da_append_get(&parser->logLines);
+    logLine->lineNum = lineNum;
+    logLine->str.txt = ca_commit_view(&parser->textBuffer, lineView);
+    logLine->str.len = length;
+
+    if (!parser->skipTrigrams) {
+        addTrigrams(parser, lineIndex, logLine->str);
+    }
+
+    finishLine(parser, format->level, format->channel);
+    return true;
+}
+
+static bool parseBinaryFormat(Parser* parser, BinaryReader* reader)
+{
+    uint32_t id;
+    uint8_t argCount;
+    uint32_t length;
+    uint8_t argTypes[BUSCHLA_LOG_MAX_ARGS];
+    BINARY_READ(reader, uint32_t, &id)
+    BINARY_READ(reader, uint8_t, &argCount)
+    const uint8_t* types = binaryRead(reader, argCount);
+    if (types == NULL) {
+        return false;
+    }
+    // Without the argument sizes the events of this format can't be skipped, the stream is corrupt.
+    if (argCount > BUSCHLA_LOG_MAX_ARGS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < argCount; ++i) {
+        if (types[i] < BUSCHLA_LOG_ARG_I64 || types[i] > BUSCHLA_LOG_ARG_STR) {
+            return false;
+        }
+    }
+    memcpy(argTypes, types, argCount);
+    BINARY_READ(reader, uint32_t, &length)
+    const uint8_t* text = binaryRead(reader, length);
+    if (text == NULL || id == 0) {
+        return false;
+    }
+
+    // The pieces point into the format text, it has to outlive the reader buffer.
+    StrView textView = { (const char*)text, length };
+    textView.txt = ca_commit_view(&parser->binaryFormatText, textView);
+    compileBinaryFormat(parser, id, argCount, argTypes, textView);
+    return true;
+}
+
+// Reads all records of a stream written with buschla_log.h, every event becomes a log line.
+// Returns false if the stream is truncated (e.g. the game crashed) or corrupt,
+// all events before that are kept.
+static bool parseBinaryLog(Parser* parser, FILE* stream, uint32_t* linesOut)
+{
+    BinaryReader reader;
+    memset(&reader, 0, sizeof(BinaryReader));
+    reader.stream = stream;
+    reader.capacity = BINARY_READER_BLOCK_SIZE;
+
+    *linesOut = 0;
+    const uint8_t* magic = binaryRead(&reader, 8);
+    if (magic == NULL || memcmp(magic, "BUSCHLB", 7) != 0 || magic[7] != BUSCHLA_LOG_VERSION) {
+        fprintf(stderr, "not a binary buschla log (or unsupported version)\n");
+        free(reader.buffer);
+        return false;
+    }
+
+    StrView frameKey = { "frame", 5 };
+    StrView timestampKey = { "timestamp", 9 };
+    uint32_t frameKeyId = internKey(parser, frameKey);
+    uint32_t timestampKeyId = internKey(parser, timestampKey);
+    uint64_t firstTimestamp = 0;
+
+    bool ok = true;
+    const uint8_t* kind;
+    while (ok && (kind = binaryRead(&reader, 1)) != NULL) {
+        switch (*kind) {
+        case BUSCHLA_LOG_RECORD_FORMAT:
+            ok = parseBinaryFormat(parser, &reader);
+            break;
+        case BUSCHLA_LOG_RECORD_EVENT: {
+            uint32_t valueCount = parser->values.count;
+            uint32_t keywordLineCount = parser->keywordLines.count;
+            ok = parseBinaryEvent(parser, &reader, *linesOut + 1, frameKeyId, timestampKeyId, &firstTimestamp);
+            if (ok) {
+                ++*linesOut;
+            }
+            else {
+                // Drop what the incomplete event added so far.
+                for (uint32_t i = keywordLineCount; i < parser->keywordIds.count; ++i) {
+                    parser->keywordLastLines.items[parser->keywordIds.items[i]] = 0xFFFFFFFF;
+                }
+                parser->valueKeys.count = valueCount;
+                parser->valueLines.count = valueCount;
+                parser->values.count = valueCount;
+                parser->keywordIds.count = keywordLineCount;
+                parser->keywordLines.count = keywordLineCount;
+                parser->hitchDetector.lineHasFrameTime = false;
+                parser->hitchDetector.lineHasFrameNumber = false;
+            }
+        } break;
+        default:
+            fprintf(stderr, "unknown binary record kind %u\n", *kind);
+            ok = false;
+            break;
+        }
+    }
+
+    free(reader.buffer);
+    return ok;
+}
+
+#define _STR_(x) #x
+#define STR(x) _STR_(x)
+
+#define ALIGN_SECTION(x) (((x) + (BUSCHLA_SECTION_ALIGNMENT - 1)) & ~(uint64_t)(BUSCHLA_SECTION_ALIGNMENT - 1))
+
+// Counting sort of item indices by id, items with the same id keep their order.
+// rangesOut needs room for idCount entries, orderOut for count entries.
+static void groupById(const uint32_t* ids, uint32_t count, uint32_t idCount, BuschlaRange* rangesOut, uint32_t* orderOut)
+{
+    for (uint32_t id = 0; id < idCount; ++id) {
+        rangesOut[id].first = 0;
+        rangesOut[id].count = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        ++rangesOut[ids[i]].count;
+    }
+
+    uint32_t first = 0;
+    for (uint32_t id = 0; id < idCount; ++id) {
+        rangesOut[id].first = first;
+        first += rangesOut[id].count;
+        // Re-used as fill counter below, restored afterwards.
+        rangesOut[id].count = 0;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        BuschlaRange* range = rangesOut + ids[i];
+        orderOut[range->first + range->count] = i;
+        ++range->count;
+    }
+}
+
+typedef struct {
+    StrView name;
+    uint32_t id;
+} NamedId;
+
+// Byte order, a prefix comes first.
+static int compareNamedIds(const void* a, const void* b)
+{
+    StrView nameA = ((const NamedId*)a)->name;
+    StrView nameB = ((const NamedId*)b)->name;
+    int order = memcmp(nameA.txt, nameB.txt, nameA.len < nameB.len ? nameA.len : nameB.len);
+    if (order != 0) {
+        return order;
+    }
+    return nameA.len < nameB.len ? -1 : nameA.len > nameB.len ? 1 : 0;
+}
+
+DEFINE_DYNAMIC_ARRAY(StringPool, char)
+
+// Appends a null-terminated copy of str to the strings section.
+static BuschlaString addOutputString(StringPool* pool, StrView str)
+{
+    BuschlaString result;
+    result.offset = pool->count;
+    result.len = str.len;
+
+    uint32_t required = pool->count + str.len + 1;
+    if (required > pool->capacity) {
+        uint32_t capacity = pool->capacity < 4096 ? 4096 : pool->capacity;
+        while (capacity < required) {
+            capacity += capacity / 2;
+        }
+        da_reserve(pool, capacity);
+    }
+
+    memcpy(pool->items + pool->count, str.txt, str.len);
+    pool->items[pool->count + str.len] = '\0';
+    pool->count = required;
+
+    return result;
+}
+
+typedef struct {
+    // NULL if the section is written separately.
+    const void* items;
+    uint64_t count;
+    uint32_t stride;
+} OutputSection;
+
+static int compareTemplateCount(const void* a, const void* b)
+{
+    uint32_t countA = ((const TopKEntry*)a)->count;
+    uint32_t countB = ((const TopKEntry*)b)->count;
+    return countA < countB ? 1 : countA > countB ? -1 : 0;
+}
+
+static int compareHitchSeverity(const void* a, const void* b)
+{
+    float severityA = ((const BuschlaHitch*)a)->severity;
+    float severityB = ((const BuschlaHitch*)b)->severity;
+    return severityA < severityB ? 1 : severityA > severityB ? -1 : 0;
+}
+
+// TODO: I like the structure that we have in tryLoadBuschlaFile, also implement WRITE properly and put it in a header file!
+#define ERROR(fmt, ...) fprintf(stderr, __FILE__ ":" STR(__LINE__) " " fmt, __VA_ARGS__)
+#define SEEK(pos) { int ret = fseek(file, (long)(pos), SEEK_SET); if (ret != 0) { ERROR("fseek to %llu failed. returned %d: %s\n", (unsigned long long)(pos), ret, strerror(ret)); return 105; } }
+#define WRITE(ptr, size) { size_t written = fwrite((ptr), 1, (size), file); if (written != (size)) { ERROR("fwrite of '%s' failed\n", #ptr); return 110; } }
+
+// Lays out the sections after the header and writes them, textInFile is false for chunked and compressed text.
+static int writeSections(FILE* file, const LogLines* logLines, const OutputSection* sections, bool textInFile)
+{
+    // Files up to 4GB get the 32-bit version 2 header, larger files version 3.
+    // The layout is the same for both versions (only the header size differs), it is tried with the smaller one first.
+    BuschlaFileHeader header;
+    for (int version = BUSCHLA_FILE_VERSION_2; version <= BUSCHLA_FILE_VERSION_3; ++version) {
+        uint32_t headerSize = version == BUSCHLA_FILE_VERSION_2 ? BUSCHLA_HEADER_SIZE(BuschlaFileHeaderV2, SECTION_COUNT) : BUSCHLA_HEADER_SIZE(BuschlaFileHeader, SECTION_COUNT);
+        memset(&header, 0, sizeof(BuschlaFileHeader));
+        memcpy(header.magic, "BUSCHLA", sizeof(header.magic));
+        header.version = (uint8_t)version;
+        header.headerSize = headerSize;
+        header.sectionCount = SECTION_COUNT;
+
+        // Lay out all sections one after another.
+        uint64_t offset = headerSize;
+        for (int i = 0; i < SECTION_COUNT; ++i) {
+            offset = ALIGN_SECTION(offset);
+            header.sections[i].offset = offset;
+            header.sections[i].count = sections[i].count;
+            header.sections[i].stride = sections[i].stride;
+            offset += sections[i].count * sections[i].stride;
+        }
+        header.totalSize = offset;
+        if (header.totalSize <= UINT32_MAX) {
+            break;
+        }
+    }
+
+    // Chunked and compressed text is left out of the file, everything after it moves up.
+    uint64_t textFileShift = textInFile ? 0 : header.sections[SECTION_TEXT_BUFFER + 1].offset - header.sections[SECTION_TEXT_BUFFER].offset;
+
+    // The text is written line by line, at the offsets in lineOffsets.
+    if (textInFile) {
+        SEEK(header.sections[SECTION_TEXT_BUFFER].offset);
+        for (uint32_t i = 0; i < logLines->count; ++i) {
+            const LogLine* logLine = logLines->items + i;
+            WRITE(logLine->str.txt, logLine->str.len + 1);
+        }
+    }
+
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        if (sections[i].items == NULL || sections[i].count == 0) {
+            continue;
+        }
+
+        SEEK(header.sections[i].offset - (i > SECTION_TEXT_BUFFER ? textFileShift : 0));
+        WRITE(sections[i].items, sections[i].count * sections[i].stride);
+    }
+
+    // Empty sections at the end still get an aligned offset, pad the file up to totalSize.
+    fseek(file, 0, SEEK_END);
+    uint64_t fileEnd = (uint64_t)ftell(file);
+    if (fileEnd < header.totalSize - textFileShift) {
+        static const char padding[BUSCHLA_SECTION_ALIGNMENT] = { 0 };
+        size_t paddingSize = header.totalSize - textFileShift - fileEnd;
+        assert(paddingSize <= sizeof(padding));
+        WRITE(padding, paddingSize);
+    }
+
+    SEEK(0);
+    if (header.version == BUSCHLA_FILE_VERSION_2) {
+        BuschlaFileHeaderV2 headerV2;
+        memcpy(headerV2.magic, header.magic, sizeof(headerV2.magic));
+        headerV2.version = header.version;
+        headerV2.headerSize = header.headerSize;
+        headerV2.sectionCount = header.sectionCount;
+        headerV2.totalSize = (uint32_t)header.totalSize;
+        for (int i = 0; i < SECTION_COUNT; ++i) {
+            headerV2.sections[i].offset = (uint32_t)header.sections[i].offset;
+            headerV2.sections[i].count = (uint32_t)header.sections[i].count;
+            headerV2.sections[i].stride = header.sections[i].stride;
+        }
+        WRITE(&headerV2, header.headerSize);
+    }
+    else {
+        WRITE(&header, header.headerSize);
+    }
+
+    return 0;
+
+#undef WRITE
+#undef SEEK
+}
+
+static int writeOutput(FILE* file, Parser* parser)
+{
+    // Errors go to cleanup, which frees the buffers built below.
+    int result = 0;
+
+    LogLines* logLines = &parser->logLines;
+    uint32_t logLineCount = logLines->count;
+
+    // Group line indices by level with a counting sort, this keeps the lines of each level sorted.
+    // Lines without a level are not indexed, there are usually a lot of them and nobody filters for them.
+    BuschlaRange levelRanges[LOG_LEVEL_COUNT];
+    memset(levelRanges, 0, sizeof(levelRanges));
+    for (uint32_t i = 0; i < logLineCount; ++i) {
+        ++levelRanges[parser->levels.items[i]].count;
+    }
+    levelRanges[LOG_LEVEL_NONE].count = 0;
+
+    uint32_t levelLineCount = 0;
+    uint32_t levelFill[LOG_LEVEL_COUNT];
+    for (int level = 0; level < LOG_LEVEL_COUNT; ++level) {
+        levelRanges[level].first = levelLineCount;
+        levelFill[level] = levelLineCount;
+        levelLineCount += levelRanges[level].count;
+    }
+
+    uint32_t* levelLines = (uint32_t*)malloc(levelLineCount * sizeof(uint32_t) + 1);
+    assert(levelLines != NULL);
+    for (uint32_t i = 0; i < logLineCount; ++i) {
+        uint8_t level = parser->levels.items[i];
+        if (level != LOG_LEVEL_NONE) {
+            levelLines[levelFill[level]++] = i;
+        }
+    }
+
+    StringPool strings;
+    memset(&strings, 0, sizeof(StringPool));
+
+    uint32_t channelCount = parser->channelLineCounts.count;
+    BuschlaChannel* channels = (BuschlaChannel*)malloc(channelCount * sizeof(BuschlaChannel) + 1);
+    assert(channels != NULL);
+    for (uint32_t i = 0; i < channelCount; ++i) {
+        channels[i].name = addOutputString(&strings, parser->channelNames.strings.items[i].str);
+        channels[i].lineCount = parser->channelLineCounts.items[i];
+    }
+
+    uint32_t sourceCount = parser->sourceNames.strings.count;
+    BuschlaSource* sources = (BuschlaSource*)malloc(sourceCount * sizeof(BuschlaSource) + 1);
+    assert(sources != NULL);
+    for (uint32_t i = 0; i < sourceCount; ++i) {
+        sources[i].name = addOutputString(&strings, parser->sourceNames.strings.items[i].str);
+        sources[i].lineCount = 0;
+    }
+    for (uint32_t i = 0; i < parser->lineSources.count; ++i) {
+        ++sources[parser->lineSources.items[i]].lineCount;
+    }
+
+    // Values are stored grouped by key, so every key gets its own column of samples.
+    uint32_t keyCount = parser->keyNames.strings.count;
+    uint32_t valueCount = parser->values.count;
+    BuschlaKey* keys = (BuschlaKey*)malloc(keyCount * sizeof(BuschlaKey) + 1);
+    BuschlaRange* keyRanges = (BuschlaRange*)malloc(keyCount * sizeof(BuschlaRange) + 1);
+    uint32_t* valueOrder = (uint32_t*)malloc(valueCount * sizeof(uint32_t) + 1);
+    uint32_t* valueLines = (uint32_t*)malloc(valueCount * sizeof(uint32_t) + 1);
+    double* values = (double*)malloc(valueCount * sizeof(double) + 1);
+    assert(keys != NULL && keyRanges != NULL && valueOrder != NULL && valueLines != NULL && values != NULL);
+
+    groupById(parser->valueKeys.items, valueCount, keyCount, keyRanges, valueOrder);
+    for (uint32_t i = 0; i < valueCount; ++i) {
+        valueLines[i] = parser->valueLines.items[valueOrder[i]];
+        values[i] = parser->values.items[valueOrder[i]];
+    }
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        keys[i].name = addOutputString(&strings, parser->keyNames.strings.items[i].str);
+        keys[i].samples = keyRanges[i];
+    }
+
+    // Checkpoint c counts each key's samples before its first line, so a line's state is one checkpoint plus the
+    // samples since then. Only the keys with samples since the previous checkpoint get an entry: one per sample
+    // at most, instead of one per key for every checkpoint.
+    uint32_t checkpointCount = (logLineCount + BUSCHLA_CHECKPOINT_LINES - 1) / BUSCHLA_CHECKPOINT_LINES;
+    BuschlaValueCheckpoint* valueCheckpoints = (BuschlaValueCheckpoint*)malloc(valueCount * sizeof(BuschlaValueCheckpoint) + 1);
+    assert(valueCheckpoints != NULL);
+    uint32_t valueCheckpointCount = 0;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        const uint32_t* lines = valueLines + keyRanges[i].first;
+        for (uint32_t s = 0; s < keyRanges[i].count; ++s) {
+            uint32_t checkpoint = lines[s] / BUSCHLA_CHECKPOINT_LINES + 1;
+            if (checkpoint >= checkpointCount) {
+                break;
+            }
+            BuschlaValueCheckpoint* last = valueCheckpoints + valueCheckpointCount - 1;
+            if (valueCheckpointCount == 0 || last->key != i || last->checkpoint != checkpoint) {
+                last = valueCheckpoints + valueCheckpointCount++;
+                last->key = i;
+                last->checkpoint = checkpoint;
+            }
+            last->before = s + 1;
+        }
+    }
+
+    // Fields are stored grouped like values, each with its own dictionary and the smallest codes that fit it.
+    uint32_t fieldCount = parser->fieldNames.strings.count;
+    uint32_t fieldSampleCount = parser->fieldIds.count;
+    BuschlaField* fields = (BuschlaField*)malloc(fieldCount * sizeof(BuschlaField) + 1);
+    BuschlaRange* fieldRanges = (BuschlaRange*)malloc(fieldCount * sizeof(BuschlaRange) + 1);
+    uint32_t* fieldOrder = (uint32_t*)malloc(fieldSampleCount * sizeof(uint32_t) + 1);
+    uint32_t* fieldLines = (uint32_t*)malloc(fieldSampleCount * sizeof(uint32_t) + 1);
+    assert(fields != NULL && fieldRanges != NULL && fieldOrder != NULL && fieldLines != NULL);
+
+    groupById(parser->fieldIds.items, fieldSampleCount, fieldCount, fieldRanges, fieldOrder);
+    uint32_t fieldValueCount = 0;
+    uint32_t fieldCodeBytes = 0;
+    for (uint32_t i = 0; i < fieldCount; ++i) {
+        uint32_t dictionarySize = parser->fieldDictionaries.items[i].strings.count;
+        BuschlaField* field = fields + i;
+        field->name = addOutputString(&strings, parser->fieldNames.strings.items[i].str);
+        field->values.first = fieldValueCount;
+        field->values.count = dictionarySize;
+        field->samples = fieldRanges[i];
+        field->codeSize = dictionarySize <= 0x100 ? 1 : dictionarySize <= 0x10000 ? 2 : 4;
+        field->codeOffset = (fieldCodeBytes + field->codeSize - 1) / field->codeSize * field->codeSize;
+        fieldValueCount += dictionarySize;
+        fieldCodeBytes = field->codeOffset + field->samples.count * field->codeSize;
+    }
+
+    BuschlaFieldValue* fieldValues = (BuschlaFieldValue*)malloc(fieldValueCount * sizeof(BuschlaFieldValue) + 1);
+    uint8_t* fieldCodes = (uint8_t*)malloc(fieldCodeBytes + 1);
+    assert(fieldValues != NULL && fieldCodes != NULL);
+    for (uint32_t i = 0; i < fieldCount; ++i) {
+        StringTable* dictionary = parser->fieldDictionaries.items + i;
+        BuschlaFieldValue* values = fieldValues + fields[i].values.first;
+        for (uint32_t code = 0; code < dictionary->strings.count; ++code) {
+            values[code].str = addOutputString(&strings, dictionary->strings.items[code].str);
+            values[code].count = 0;
+        }
+
+        uint8_t* codes = fieldCodes + fields[i].codeOffset;
+        for (uint32_t j = 0; j < fields[i].samples.count; ++j) {
+            uint32_t sample = fieldOrder[fields[i].samples.first + j];
+            uint32_t code = parser->fieldCodes.items[sample];
+            fieldLines[fields[i].samples.first + j] = parser->fieldLines.items[sample];
+            ++values[code].count;
+            switch (fields[i].codeSize) {
+            case 1: codes[j] = (uint8_t)code; break;
+            case 2: ((uint16_t*)codes)[j] = (uint16_t)code; break;
+            default: ((uint32_t*)codes)[j] = code; break;
+            }
+        }
+    }
+
+    uint32_t keyBucketCount = 0;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        keyBucketCount += parser->keySketches.items[i].bucketCount;
+    }
+    BuschlaKeyStats* keyStats = (BuschlaKeyStats*)malloc(keyCount * sizeof(BuschlaKeyStats) + 1);
+    BuschlaBucket* keyBuckets = (BuschlaBucket*)malloc(keyBucketCount * sizeof(BuschlaBucket) + 1);
+    assert(keyStats != NULL && keyBuckets != NULL);
+    keyBucketCount = 0;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        vs_store(parser->keySketches.items + i, keyStats + i, keyBuckets, keyBucketCount);
+        keyBucketCount += keyStats[i].buckets.count;
+    }
+
+    // One segment tree per key over blocks of its samples, laid out as described at BuschlaAggregate.
+    uint32_t keyAggregateCount = 0;
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        uint32_t blockCount = (keyRanges[i].count + BUSCHLA_AGGREGATE_BLOCK_SAMPLES - 1) / BUSCHLA_AGGREGATE_BLOCK_SAMPLES;
+        keyStats[i].aggregates.first = keyAggregateCount;
+        keyStats[i].aggregates.count = blockCount * 2;
+        keyAggregateCount += blockCount * 2;
+    }
+    BuschlaAggregate* keyAggregates = (BuschlaAggregate*)malloc(keyAggregateCount * sizeof(BuschlaAggregate) + 1);
+    assert(keyAggregates != NULL);
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        BuschlaAggregate* nodes = keyAggregates + keyStats[i].aggregates.first;
+        uint32_t blockCount = keyStats[i].aggregates.count / 2;
+        const double* keyValues = values + keyRanges[i].first;
+        for (uint32_t block = 0; block < blockCount; ++block) {
+            uint32_t first = block * BUSCHLA_AGGREGATE_BLOCK_SAMPLES;
+            uint32_t end = first + BUSCHLA_AGGREGATE_BLOCK_SAMPLES < keyRanges[i].count ? first + BUSCHLA_AGGREGATE_BLOCK_SAMPLES : keyRanges[i].count;
+            BuschlaAggregate* leaf = nodes + blockCount + block;
+            leaf->min = keyValues[first];
+            leaf->max = keyValues[first];
+            leaf->sum = 0.0;
+            for (uint32_t j = first; j < end; ++j) {
+                leaf->min = keyValues[j] < leaf->min ? keyValues[j] : leaf->min;
+                leaf->max = keyValues[j] > leaf->max ? keyValues[j] : leaf->max;
+                leaf->sum += keyValues[j];
+            }
+        }
+        for (uint32_t node = blockCount; node-- > 1;) {
+            const BuschlaAggregate* left = nodes + node * 2;
+            const BuschlaAggregate* right = left + 1;
+            nodes[node].min = left->min < right->min ? left->min : right->min;
+            nodes[node].max = left->max > right->max ? left->max : right->max;
+            nodes[node].sum = left->sum + right->sum;
+        }
+        if (blockCount > 0) {
+            memset(nodes, 0, sizeof(BuschlaAggregate));
+        }
+    }
+
+    uint32_t keywordCount = parser->keywordNames.strings.count;
+    uint32_t keywordLineCount = parser->keywordLines.count;
+    BuschlaKeyword* keywords = (BuschlaKeyword*)malloc(keywordCount * sizeof(BuschlaKeyword) + 1);
+    BuschlaRange* keywordRanges = (BuschlaRange*)malloc(keywordCount * sizeof(BuschlaRange) + 1);
+    uint32_t* keywordOrder = (uint32_t*)malloc(keywordLineCount * sizeof(uint32_t) + 1);
+    uint32_t* keywordLines = (uint32_t*)malloc(keywordLineCount * sizeof(uint32_t) + 1);
+    assert(keywords != NULL && keywordRanges != NULL && keywordOrder != NULL && keywordLines != NULL);
+
+    groupById(parser->keywordIds.items, keywordLineCount, keywordCount, keywordRanges, keywordOrder);
+    for (uint32_t i = 0; i < keywordLineCount; ++i) {
+        keywordLines[i] = parser->keywordLines.items[keywordOrder[i]];
+    }
+    for (uint32_t i = 0; i < keywordCount; ++i) {
+        keywords[i].name = addOutputString(&strings, parser->keywordNames.strings.items[i].str);
+        keywords[i].lines = keywordRanges[i];
+    }
+
+    // Entities are sorted by name so the viewer can binary search them.
+    uint32_t entityCount = parser->entityNames.strings.count;
+    uint32_t entityLineCount = parser->entityLines.count;
+    BuschlaEntity* entities = (BuschlaEntity*)malloc(entityCount * sizeof(BuschlaEntity) + 1);
+    BuschlaRange* entityRanges = (BuschlaRange*)malloc(entityCount * sizeof(BuschlaRange) + 1);
+    uint32_t* entityOrder = (uint32_t*)malloc(entityLineCount * sizeof(uint32_t) + 1);
+    uint32_t* entityLines = (uint32_t*)malloc(entityLineCount * sizeof(uint32_t) + 1);
+    NamedId* sortedEntities = (NamedId*)malloc(entityCount * sizeof(NamedId) + 1);
+    assert(entities != NULL && entityRanges != NULL && entityOrder != NULL && entityLines != NULL && sortedEntities != NULL);
+
+    groupById(parser->entityIds.items, entityLineCount, entityCount, entityRanges, entityOrder);
+    for (uint32_t i = 0; i < entityLineCount; ++i) {
+        entityLines[i] = parser->entityLines.items[entityOrder[i]];
+    }
+    for (uint32_t i = 0; i < entityCount; ++i) {
+        sortedEntities[i].name = parser->entityNames.strings.items[i].str;
+        sortedEntities[i].id = i;
+    }
+    qsort(sortedEntities, entityCount, sizeof(NamedId), compareNamedIds);
+    for (uint32_t i = 0; i < entityCount; ++i) {
+        entities[i].name = addOutputString(&strings, sortedEntities[i].name);
+        entities[i].lines = entityRanges[sortedEntities[i].id];
+    }
+
+    // Trigrams are sorted by their bytes so the viewer can binary search them.
+    uint32_t trigramCount = parser->trigramKeys.count;
+    uint32_t trigramPostingCount = parser->trigramPostingIds.count;
+    BuschlaTrigram* trigrams = (BuschlaTrigram*)malloc(trigramCount * sizeof(BuschlaTrigram) + 1);
+    BuschlaRange* trigramRanges = (BuschlaRange*)malloc(trigramCount * sizeof(BuschlaRange) + 1);
+    uint32_t* trigramOrder = (uint32_t*)malloc(trigramPostingCount * sizeof(uint32_t) + 1);
+    uint32_t* trigramBlocks = (uint32_t*)malloc(trigramPostingCount * sizeof(uint32_t) + 1);
+    assert(trigrams != NULL && trigramRanges != NULL && trigramOrder != NULL && trigramBlocks != NULL);
+
+    groupById(parser->trigramPostingIds.items, trigramPostingCount, trigramCount, trigramRanges, trigramOrder);
+    for (uint32_t i = 0; i < trigramPostingCount; ++i) {
+        trigramBlocks[i] = parser->trigramPostingBlocks.items[trigramOrder[i]];
+    }
+    if (trigramCount > 0) {
+        uint32_t sortedCount = 0;
+        for (uint32_t trigram = 0; trigram < PARSER_TRIGRAM_COUNT; ++trigram) {
+            uint32_t id = parser->trigramIds[trigram];
+            if (id != 0) {
+                trigrams[sortedCount].trigram = trigram;
+                trigrams[sortedCount].blocks = trigramRanges[id - 1];
+                ++sortedCount;
+            }
+        }
+        assert(sortedCount == trigramCount);
+    }
+
+    // Worst hitches first, the viewer usually only shows the top of the list.
+    uint32_t hitchCount = parser->hitches.count;
+    BuschlaHitch* hitches = (BuschlaHitch*)malloc(hitchCount * sizeof(BuschlaHitch) + 1);
+    assert(hitches != NULL);
+    memcpy(hitches, parser->hitches.items, hitchCount * sizeof(BuschlaHitch));
+    qsort(hitches, hitchCount, sizeof(BuschlaHitch), compareHitchSeverity);
+
+    // Scopes that are still open run to the last line.
+    uint32_t scopeCount = parser->scopes.count;
+    uint32_t scopeNameCount = parser->scopeNames.strings.count;
+    BuschlaScope* scopes = (BuschlaScope*)malloc(scopeCount * sizeof(BuschlaScope) + 1);
+    BuschlaString* scopeNames = (BuschlaString*)malloc(scopeNameCount * sizeof(BuschlaString) + 1);
+    assert(scopes != NULL && scopeNames != NULL);
+    for (uint32_t i = 0; i < scopeNameCount; ++i) {
+        scopeNames[i] = addOutputString(&strings, parser->scopeNames.strings.items[i].str);
+    }
+    for (uint32_t i = 0; i < scopeCount; ++i) {
+        scopes[i] = parser->scopes.items[i];
+        scopes[i].name = scopeNames[scopes[i].name.offset];
+        if (scopes[i].lastLine == BUSCHLA_SCOPE_NONE) {
+            scopes[i].lastLine = logLineCount - 1;
+        }
+    }
+
+    uint32_t alertCount = parser->alerts.count;
+    BuschlaAlert* alerts = (BuschlaAlert*)malloc(alertCount * sizeof(BuschlaAlert) + 1);
+    BuschlaString* alertRuleTexts = (BuschlaString*)malloc(parser->alertRules.count * sizeof(BuschlaString) + 1);
+    assert(alerts != NULL && alertRuleTexts != NULL);
+    for (uint32_t i = 0; i < parser->alertRules.count; ++i) {
+        StrView text = { parser->alertRules.items[i].text, (uint32_t)strlen(parser->alertRules.items[i].text) };
+        alertRuleTexts[i] = addOutputString(&strings, text);
+    }
+    for (uint32_t i = 0; i < alertCount; ++i) {
+        alerts[i] = parser->alerts.items[i];
+        alerts[i].rule = alertRuleTexts[alerts[i].rule.offset];
+    }
+
+    // Most frequent templates first, the text is taken from the first counted line.
+    uint32_t templateCount = parser->templates.entryCount;
+    TopKEntry* templateEntries = (TopKEntry*)malloc(templateCount * sizeof(TopKEntry) + 1);
+    BuschlaTemplate* templates = (BuschlaTemplate*)malloc(templateCount * sizeof(BuschlaTemplate) + 1);
+    assert(templateEntries != NULL && templates != NULL);
+    memcpy(templateEntries, parser->templates.entries, templateCount * sizeof(TopKEntry));
+    qsort(templateEntries, templateCount, sizeof(TopKEntry), compareTemplateCount);
+    for (uint32_t i = 0; i < templateCount; ++i) {
+        TopKEntry* entry = templateEntries + i;
+        StrView line = logLines->items[entry->firstLine].str;
+        uint32_t length = maskNumbers(line, parser->templateText);
+        StrView text = { parser->templateText, length };
+        templates[i].text = addOutputString(&strings, text);
+        templates[i].count = entry->count;
+        templates[i].error = entry->error;
+        templates[i].firstLine = entry->firstLine;
+        templates[i].lastLine = entry->lastLine;
+    }
+
+    // The line table is stored as columns: text offsets (the lengths follow from the next offset),
+    // and line numbers only where they do not count up by one.
+    uint32_t* lineOffsets = (uint32_t*)malloc((logLineCount + 1) * sizeof(uint32_t));
+    BuschlaLineNumber* lineNumbers = (BuschlaLineNumber*)malloc(logLineCount * sizeof(BuschlaLineNumber) + 1);
+    assert(lineOffsets != NULL && lineNumbers != NULL);
+    Uint32s lineOffsetWraps;
+    memset(&lineOffsetWraps, 0, sizeof(Uint32s));
+    uint32_t lineNumberCount = 0;
+
+    uint64_t textBufferSize = 0;
+    for (uint32_t i = 0; i <= logLineCount; ++i) {
+        while (lineOffsetWraps.count < (textBufferSize >> 32)) {
+            da_append(&lineOffsetWraps, i);
+        }
+        lineOffsets[i] = (uint32_t)textBufferSize;
+        if (i == logLineCount) {
+            break;
+        }
+
+        uint32_t lineNum = logLines->items[i].lineNum;
+        uint32_t expectedLineNum = i > 0 ? logLines->items[i - 1].lineNum + 1 : 1;
+        if (lineNum != expectedLineNum) {
+            lineNumbers[lineNumberCount].line = i;
+            lineNumbers[lineNumberCount].lineNum = lineNum;
+            ++lineNumberCount;
+        }
+        textBufferSize += logLines->items[i].str.len + 1;
+    }
+
+    // With a chunk store the text goes into shared chunks instead of this file, see BuschlaChunk.
+    bool chunked = parser->chunkStore != NULL;
+    ChunkWriter* chunkWriter = NULL;
+    char chunkStorePath[PATH_MAX];
+    // Otherwise the text is compressed in blocks of whole lines, unless --raw-text is given.
+    bool compressed = !chunked && !parser->rawText && logLineCount > 0;
+    BuschlaTextBlocks textBlocks;
+    memset(&textBlocks, 0, sizeof(BuschlaTextBlocks));
+    uint8_t* textBlockData = NULL;
+    uint64_t textBlockDataSize = 0;
+    if (chunked) {
+        chunkWriter = (ChunkWriter*)malloc(sizeof(ChunkWriter));
+        assert(chunkWriter != NULL);
+        if (!cw_init(chunkWriter, parser->chunkStore)) {
+            ERROR("cannot use chunk store '%s'\n", parser->chunkStore);
+            result = 120;
+            goto cleanup;
+        }
+        for (uint32_t i = 0; i < logLineCount; ++i) {
+            cw_write(chunkWriter, logLines->items[i].str.txt, logLines->items[i].str.len + 1);
+        }
+        if (!cw_finish(chunkWriter)) {
+            ERROR("storing chunks in '%s' failed\n", parser->chunkStore);
+            result = 120;
+            goto cleanup;
+        }
+        printf("text stored in %u chunks, %u of them new (%.1f KB)\n",
+               chunkWriter->chunks.count, chunkWriter->newChunkCount, chunkWriter->newChunkBytes / 1024.0);
+
+        // Viewers may run in another directory.
+        if (realpath(parser->chunkStore, chunkStorePath) == NULL) {
+            snprintf(chunkStorePath, sizeof(chunkStorePath), "%s", parser->chunkStore);
+        }
+    }
+
+    if (compressed) {
+        char* blockText = NULL;
+        uint32_t blockTextCapacity = 0;
+        uint64_t textBlockDataCapacity = 0;
+        uint32_t firstLine = 0;
+        while (firstLine < logLineCount) {
+            // Lines are added up to BUSCHLA_TEXT_BLOCK_SIZE, a longer line is a block of its own.
+            uint32_t endLine = firstLine;
+            uint32_t blockSize = 0;
+            do {
+                blockSize += logLines->items[endLine].str.len + 1;
+                ++endLine;
+            } while (endLine < logLineCount && blockSize + logLines->items[endLine].str.len + 1 <= BUSCHLA_TEXT_BLOCK_SIZE);
+
+            if (blockTextCapacity < blockSize) {
+                blockTextCapacity = blockSize;
+                blockText = (char*)realloc(blockText, blockTextCapacity);
+                assert(blockText != NULL && "Buy more RAM lel");
+            }
+            uint32_t size = 0;
+            for (uint32_t i = firstLine; i < endLine; ++i) {
+                memcpy(blockText + size, logLines->items[i].str.txt, logLines->items[i].str.len + 1);
+                size += logLines->items[i].str.len + 1;
+            }
+
+            if (textBlockDataCapacity < textBlockDataSize + LZ_BOUND((uint64_t)blockSize)) {
+                textBlockDataCapacity = (textBlockDataSize + LZ_BOUND((uint64_t)blockSize)) * 2;
+                textBlockData = (uint8_t*)realloc(textBlockData, textBlockDataCapacity);
+                assert(textBlockData != NULL && "Buy more RAM lel");
+            }
+            BuschlaTextBlock* block = da_append_get(&textBlocks);
+            block->offset = textBlockDataSize;
+            block->size = lz_compress(blockText, blockSize, textBlockData + textBlockDataSize);
+            block->firstLine = firstLine;
+            textBlockDataSize += block->size;
+            firstLine = endLine;
+        }
+        free(blockText);
+        printf("text compressed in %u blocks (%.1f KB of %.1f KB)\n", textBlocks.count, textBlockDataSize / 1024.0, textBufferSize / 1024.0);
+    }
+
+    OutputSection sections[SECTION_COUNT];
+    memset(sections, 0, sizeof(sections));
+#define X(id, name, type) sections[id].stride = (uint32_t)sizeof(type);
+    BUSCHLA_FILE_SECTIONS(X)
+#undef X
+#define SET_SECTION(id, ptr, cnt) { sections[id].items = (ptr); sections[id].count = (cnt); }
+    SET_SECTION(SECTION_LINE_OFFSETS, lineOffsets, logLineCount + 1)
+    SET_SECTION(SECTION_LINE_OFFSET_WRAPS, lineOffsetWraps.items, lineOffsetWraps.count)
+    SET_SECTION(SECTION_LINE_NUMBERS, lineNumbers, lineNumberCount)
+    SET_SECTION(SECTION_TEXT_BUFFER, NULL, textBufferSize)
+    SET_SECTION(SECTION_LEVELS, parser->levels.items, parser->levels.count)
+    SET_SECTION(SECTION_LEVEL_RANGES, levelRanges, LOG_LEVEL_COUNT)
+    SET_SECTION(SECTION_LEVEL_LINES, levelLines, levelLineCount)
+    SET_SECTION(SECTION_STRINGS, strings.items, strings.count)
+    SET_SECTION(SECTION_CHANNELS, channels, channelCount)
+    SET_SECTION(SECTION_LINE_CHANNELS, parser->lineChannels.items, parser->lineChannels.count)
+    SET_SECTION(SECTION_KEYS, keys, keyCount)
+    SET_SECTION(SECTION_VALUE_LINES, valueLines, valueCount)
+    SET_SECTION(SECTION_VALUES, values, valueCount)
+    SET_SECTION(SECTION_FIELDS, fields, fieldCount)
+    SET_SECTION(SECTION_FIELD_VALUES, fieldValues, fieldValueCount)
+    SET_SECTION(SECTION_FIELD_LINES, fieldLines, fieldSampleCount)
+    SET_SECTION(SECTION_FIELD_CODES, fieldCodes, fieldCodeBytes)
+    SET_SECTION(SECTION_KEYWORDS, keywords, keywordCount)
+    SET_SECTION(SECTION_KEYWORD_LINES, keywordLines, keywordLineCount)
+    SET_SECTION(SECTION_ENTITIES, entities, entityCount)
+    SET_SECTION(SECTION_ENTITY_LINES, entityLines, entityLineCount)
+    SET_SECTION(SECTION_TRIGRAMS, trigrams, trigramCount)
+    SET_SECTION(SECTION_TRIGRAM_BLOCKS, trigramBlocks, trigramPostingCount)
+    SET_SECTION(SECTION_HITCHES, hitches, hitchCount)
+    SET_SECTION(SECTION_TOKENS, parser->tokens.items, parser->tokens.count)
+    SET_SECTION(SECTION_LINE_TOKENS, parser->lineTokens.items, parser->lineTokens.count)
+    SET_SECTION(SECTION_VALUE_CHECKPOINTS, valueCheckpoints, valueCheckpointCount)
+    SET_SECTION(SECTION_KEY_STATS, keyStats, keyCount)
+    SET_SECTION(SECTION_KEY_BUCKETS, keyBuckets, keyBucketCount)
+    SET_SECTION(SECTION_KEY_AGGREGATES, keyAggregates, keyAggregateCount)
+    SET_SECTION(SECTION_TEMPLATES, templates, templateCount)
+    SET_SECTION(SECTION_SOURCES, sources, sourceCount)
+    SET_SECTION(SECTION_LINE_SOURCES, parser->lineSources.items, parser->lineSources.count)
+    SET_SECTION(SECTION_SCOPES, scopes, scopeCount)
+    SET_SECTION(SECTION_ALERTS, alerts, alertCount)
+    if (chunked) {
+        SET_SECTION(SECTION_TEXT_CHUNKS, chunkWriter->chunks.items, chunkWriter->chunks.count)
+        SET_SECTION(SECTION_CHUNK_STORE, chunkStorePath, (uint32_t)strlen(chunkStorePath) + 1)
+    }
+    if (compressed) {
+        SET_SECTION(SECTION_TEXT_BLOCKS, textBlocks.items, textBlocks.count)
+        SET_SECTION(SECTION_TEXT_BLOCK_DATA, textBlockData, textBlockDataSize)
+    }
+#undef SET_SECTION
+
+    result = writeSections(file, logLines, sections, !chunked && !compressed);
+
+cleanup:
+    if (chunkWriter != NULL) {
+        cw_free(chunkWriter);
+        free(chunkWriter);
+    }
+    free(lineOffsets);
+    da_free(&textBlocks);
+    free(textBlockData);
+    free(lineNumbers);
+    da_free(&lineOffsetWraps);
+    free(hitches);
+    free(scopes);
+    free(scopeNames);
+    free(alerts);
+    free(alertRuleTexts);
+    free(templateEntries);
+    free(templates);
+    free(levelLines);
+    free(channels);
+    free(sources);
+    free(keys);
+    free(keyRanges);
+    free(valueOrder);
+    free(valueLines);
+    free(valueCheckpoints);
+    free(entities);
+    free(entityRanges);
+    free(entityOrder);
+    free(entityLines);
+    free(sortedEntities);
+    free(fields);
+    free(fieldRanges);
+    free(fieldOrder);
+    free(fieldLines);
+    free(fieldValues);
+    free(fieldCodes);
+    free(values);
+    free(keyStats);
+    free(keyBuckets);
+    free(keyAggregates);
+    free(keywords);
+    free(keywordRanges);
+    free(keywordOrder);
+    free(keywordLines);
+    free(trigrams);
+    free(trigramRanges);
+    free(trigramOrder);
+    free(trigramBlocks);
+    da_free(&strings);
+
+    return result;
+
+#undef ERROR
+}
+
+// Writes to a temporary file first, so a viewer never sees a half written file.
+static int writeOutputFile(Parser* parser, const char* fileName)
+{
+    char tmpFileName[PATH_MAX];
+    snprintf(tmpFileName, sizeof(tmpFileName), "%s.tmp", fileName);
+    FILE* outputFile = fopen(tmpFileName, "w");
+    if (outputFile == NULL) {
+        perror("fopen output");
+        return 100;
+    }
+
+    int exitCode = writeOutput(outputFile, parser);
+
+    int fcloseRet = fclose(outputFile);
+    if (fcloseRet != 0) {
+        perror("fclose output");
+    }
+
+    if (exitCode == 0 && rename(tmpFileName, fileName) != 0) {
+        perror("rename output");
+        exitCode = 100;
+    }
+    return exitCode;
+}
+
+static void appendLine(Parser* parser, StrView lineView, uint32_t lineNum)
+{
+    LogLine* logLine = da_append_get(&parser->logLines);
+    logLine->lineNum = lineNum;
+    logLine->str.txt = ca_commit_view(&parser->textBuffer, lineView);
+    logLine->str.len = lineView.len;
+
+    parseLine(parser, logLine);
+}
+
+static void beginParsing(Parser* parser)
+{
+    // Keys are interned again after a reset.
+    parser->frameKeyId = PARSER_NO_KEY;
+    parser->frameTimeKeyId = PARSER_NO_KEY;
+
+    if (parser->storeTokens) {
+        uint32_t firstToken = 0;
+        da_append(&parser->lineTokens, firstToken);
+    }
+}
+
+// Parses the whole stream with the parser's dialect, linesOut counts the lines read (events for binary logs).
+// Returns false if a binary log ended in the middle of a record, everything before it is kept.
+static bool parseInput(Parser* parser, FILE* inputFile, uint32_t* linesOut)
+{
+    *linesOut = 0;
+    if (parser->dialect == DIALECT_BINARY) {
+        if (!parseBinaryLog(parser, inputFile, linesOut)) {
+            fprintf(stderr, "binary log ended unexpectedly, keeping the %u events read so far\n", *linesOut);
+            return false;
+        }
+        return true;
+    }
+
+    LineReader reader;
+    lineReaderInit(&reader, inputFile);
+    while (true) {
+        StrView lineView;
+        lineView.len = 0;
+        lineView.txt = readLine(&reader, &lineView.len);
+
+        if (lineView.txt == NULL) {
+            break;
+        }
+
+        if (lineView.len > 0) {
+            appendLine(parser, lineView, *linesOut + 1);
+        }
+
+        ++*linesOut;
+    }
+    lineReaderFree(&reader);
+    return true;
+}
+
+// Input files given on the command line are merged into one log.
+#define PARSER_MAX_INPUTS 256
+
+// Input of a merged parse, holds its current line until it is the earliest of all inputs.
+typedef struct {
+    FILE* file;
+    LineReader reader;
+    uint16_t sourceId;
+    uint32_t lineNum;
+    StrView line;
+    // Timestamp of the current line, lines without one keep the timestamp of the line before.
+    // Seconds since midnight of the first day of this input.
+    double time;
+    uint32_t day;
+    double timeOfDay;
+} MergeSource;
+
+static bool mergeSourceBefore(const MergeSource* a, const MergeSource* b)
+{
+    return a->time < b->time || (a->time == b->time && a->sourceId < b->sourceId);
+}
+
+// Moves to the next non-empty line, returns false at the end of the input.
+static bool mergeSourceAdvance(MergeSource* source)
+{
+    while (true) {
+        source->line.len = 0;
+        source->line.txt = readLine(&source->reader, &source->line.len);
+        if (source->line.txt == NULL) {
+            return false;
+        }
+
+        ++source->lineNum;
+        if (source->line.len > 0) {
+            double timeOfDay;
+            if (parseLineTimestamp(source->line, &timeOfDay)) {
+                // Jumping back by more than half a day means the log went past midnight.
+                if (source->time != -INFINITY && timeOfDay < source->timeOfDay - 43200.0) {
+                    ++source->day;
+                }
+                source->timeOfDay = timeOfDay;
+                source->time = source->day * 86400.0 + timeOfDay;
+            }
+            return true;
+        }
+    }
+}
+
+static void mergeHeapSiftDown(MergeSource** heap, uint32_t count, uint32_t position)
+{
+    while (true) {
+        uint32_t first = position;
+        uint32_t left = position * 2 + 1;
+        uint32_t right = left + 1;
+        if (left < count && mergeSourceBefore(heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < count && mergeSourceBefore(heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == position) {
+            return;
+        }
+        MergeSource* tmp = heap[position];
+        heap[position] = heap[first];
+        heap[first] = tmp;
+        position = first;
+    }
+}
+
+// Parses several line based inputs into one log, ordered by the timestamps of the lines (k-way merge).
+// Only the current line of every input is held in memory while merging.
+// Lines without a timestamp stay right after the line before them, lines before the first timestamp come first.
+// Every line records its input in lineSources. Returns false if an input could not be opened.
+static bool parseMerged(Parser* parser, const char** fileNames, uint32_t fileCount, uint32_t* linesOut)
 {
-    static char* buffer = NULL;
-    static uint32_t capacity = 0;
+    *linesOut = 0;
+    if (fileCount > BUSCHLA_CHANNEL_NONE) {
+        fprintf(stderr, "cannot merge more than %u inputs\n", BUSCHLA_CHANNEL_NONE);
+        return false;
+    }
 
-    if (stream == NULL) {
-        *lengthOut = 0;
-        return NULL;
+    MergeSource* sources = (MergeSource*)calloc(fileCount, sizeof(MergeSource));
+    MergeSource** heap = (MergeSource**)calloc(fileCount, sizeof(MergeSource*));
+    assert(sources != NULL && heap != NULL);
+
+    bool ok = true;
+    uint32_t openCount = 0;
+    for (uint32_t i = 0; i < fileCount && ok; ++i) {
+        MergeSource* source = sources + i;
+        source->file = fopen(fileNames[i], "r");
+        if (source->file == NULL) {
+            fprintf(stderr, "fopen input '%s': %s\n", fileNames[i], strerror(errno));
+            ok = false;
+            break;
+        }
+        ++openCount;
+
+        lineReaderInit(&source->reader, source->file);
+        StrView name = { fileNames[i], (uint32_t)strlen(fileNames[i]) };
+        source->sourceId = (uint16_t)st_intern(&parser->sourceNames, name);
+        source->time = -INFINITY;
     }
 
-    uint32_t length = 0;
+    uint32_t heapCount = 0;
+    for (uint32_t i = 0; i < openCount && ok; ++i) {
+        if (mergeSourceAdvance(sources + i)) {
+            heap[heapCount++] = sources + i;
+        }
+    }
+    for (uint32_t i = heapCount / 2; ok && i-- > 0;) {
+        mergeHeapSiftDown(heap, heapCount, i);
+    }
+
+    while (ok && heapCount > 0) {
+        MergeSource* source = heap[0];
+        appendLine(parser, source->line, source->lineNum);
+        da_append(&parser->lineSources, source->sourceId);
+        ++*linesOut;
+
+        if (!mergeSourceAdvance(source)) {
+            heap[0] = heap[--heapCount];
+        }
+        mergeHeapSiftDown(heap, heapCount, 0);
+    }
+
+    for (uint32_t i = 0; i < openCount; ++i) {
+        lineReaderFree(&sources[i].reader);
+        fclose(sources[i].file);
+    }
+    free(sources);
+    free(heap);
+    return ok;
+}
+
+// Drops all parsed lines, but keeps the options and allocations.
+static void resetParser(Parser* parser)
+{
+    // ca_reset only reuses the last chunk, a daemon worker would keep the text of every file it converted.
+    ca_free(&parser->textBuffer);
+    da_reset(&parser->logLines);
+    da_reset(&parser->levels);
+
+    st_free(&parser->channelNames);
+    da_reset(&parser->channelLineCounts);
+    da_reset(&parser->lineChannels);
+
+    st_free(&parser->sourceNames);
+    da_reset(&parser->lineSources);
+
+    st_free(&parser->keyNames);
+    da_reset(&parser->valueKeys);
+    da_reset(&parser->valueLines);
+    da_reset(&parser->values);
+
+    st_free(&parser->fieldNames);
+    for (uint32_t i = 0; i < parser->fieldDictionaries.count; ++i) {
+        st_free(parser->fieldDictionaries.items + i);
+    }
+    da_reset(&parser->fieldDictionaries);
+    da_reset(&parser->fieldIds);
+    da_reset(&parser->fieldLines);
+    da_reset(&parser->fieldCodes);
+
+    for (uint32_t i = 0; i < parser->keySketches.count; ++i) {
+        vs_free(parser->keySketches.items + i);
+    }
+    da_reset(&parser->keySketches);
+    parser->sketchedValueCount = 0;
+
+    st_free(&parser->keywordNames);
+    da_reset(&parser->keywordIds);
+    da_reset(&parser->keywordLines);
+    da_reset(&parser->keywordLastLines);
+
+    st_free(&parser->entityNames);
+    da_reset(&parser->entityIds);
+    da_reset(&parser->entityLines);
+    da_reset(&parser->entityLastLines);
+
+    for (uint32_t i = 0; i < parser->trigramKeys.count; ++i) {
+        parser->trigramIds[parser->trigramKeys.items[i]] = 0;
+    }
+    da_reset(&parser->trigramKeys);
+    da_reset(&parser->trigramLastBlocks);
+    da_reset(&parser->trigramPostingIds);
+    da_reset(&parser->trigramPostingBlocks);
+
+    da_reset(&parser->tokens);
+    da_reset(&parser->lineTokens);
+
+    // The frame time window carries over into the next segment.
+    da_reset(&parser->hitches);
+    parser->hitchDetector.frameFirstLine = 0;
+
+    tk_free(&parser->templates);
+
+    st_free(&parser->scopeNames);
+    da_reset(&parser->scopes);
+    da_reset(&parser->scopeBeginTimes);
+    da_reset(&parser->openScopes);
+
+    da_reset(&parser->alerts);
+
+    // Format ids refer to key and keyword ids of the tables cleared above, every binary log defines its own.
+    da_reset(&parser->binaryFormats);
+    da_reset(&parser->binaryKeywordIds);
+    ca_free(&parser->binaryFormatText);
+
+    beginParsing(parser);
+}
+
+// The current segment is rewritten at most this often while lines are coming in.
+#define PARSER_LIVE_FLUSH_MS 250
+// Writing the whole segment takes longer the more lines it has, the next write waits at least this many times
+// as long as the last one took. The ring is not read while writing, so at most a fifth of the time is spent on it.
+#define PARSER_LIVE_FLUSH_WRITE_FACTOR 4
+// Game-style lines take about 2µs each to write (-O2), a full segment of this size is written in about 100ms.
+#define PARSER_LIVE_DEFAULT_SEGMENT_LINES 50000
+
+// Parses lines from a live channel (see buschla_live.h) until the producer closes it.
+// Lines go to out.0000.buschla, after segmentLines lines out.0001.buschla is started, ...
+static int runLive(Parser* parser, const char* channelName, const char* outputFileName, uint32_t segmentLines)
+{
+    char segmentBase[PATH_MAX];
+    snprintf(segmentBase, sizeof(segmentBase), "%s", outputFileName);
+    size_t baseLength = strlen(segmentBase);
+    if (baseLength > 8 && strcmp(segmentBase + baseLength - 8, ".buschla") == 0) {
+        segmentBase[baseLength - 8] = '\0';
+    }
+
+    BuschlaLive live;
+    printf("waiting for live channel '%s'\n", channelName);
+    while (!buschla_live_attach(&live, channelName)) {
+        usleep(100 * 1000);
+    }
+    printf("attached to live channel '%s' (%u bytes ring)\n", channelName, live.header->capacity);
+
+    beginParsing(parser);
+
+    uint32_t segmentIndex = 0;
+    uint32_t lineNum = 0;
+    bool unflushed = false;
+    int exitCode = 0;
+    Timer flushTimer;
+    timerBegin(&flushTimer);
+    float lastWriteMs = 0.0f;
+    uint64_t reportedDrops = buschla_live_load_acquire(&live.header->droppedRecords);
+
+    char segmentFileName[PATH_MAX + 32];
+#define WRITE_SEGMENT() { \
+    snprintf(segmentFileName, sizeof(segmentFileName), "%s.%04u.buschla", segmentBase, segmentIndex); \
+    Timer writeTimer; \
+    timerBegin(&writeTimer); \
+    exitCode = writeOutputFile(parser, segmentFileName); \
+    if (exitCode != 0) { \
+        break; \
+    } \
+    timerEnd(&writeTimer); \
+    lastWriteMs = writeTimer.elapsedMs; \
+    unflushed = false; \
+    timerBegin(&flushTimer); \
+}
+
     while (true) {
-        char c;
-        size_t count = fread(&c, 1, 1, stream);
-        if (count != 1) {
-            if (length == 0) {
-                *lengthOut = 0;
-                return NULL;
+        // Checked before reading, so the lines written right before closing are not missed.
+        bool closed = buschla_live_closed(&live);
+
+        uint32_t readCount = 0;
+        uint32_t recordSize = 0;
+        const char* record;
+        while ((record = buschla_live_read(&live, &recordSize)) != NULL) {
+            ++readCount;
+
+            // Producers should write one line per record, but don't trust them.
+            uint32_t lineStart = 0;
+            for (uint32_t i = 0; i <= recordSize; ++i) {
+                if (i < recordSize && record[i] != '\n' && record[i] != '\r') {
+                    continue;
+                }
+
+                StrView lineView = { record + lineStart, i - lineStart };
+                lineStart = i + 1;
+                if (lineView.len == 0) {
+                    continue;
+                }
+
+                appendLine(parser, lineView, ++lineNum);
+                unflushed = true;
             }
 
-            break;
+            if (parser->logLines.count >= segmentLines) {
+                WRITE_SEGMENT()
+                printf("finished segment %u (%u lines)\n", segmentIndex, parser->logLines.count);
+                ++segmentIndex;
+                resetParser(parser);
+            }
         }
-
-        if (c == '\n') {
+        buschla_live_release(&live);
+        if (exitCode != 0) {
             break;
         }
 
-        // Ignore other non-printable characters
-        // 0x7F is DEL
-        if (ASCII_IS_CONTROL(c) || UTF8_IS_CONTINUATION(c)) {
-            continue;
+        timerEnd(&flushTimer);
+        float flushIntervalMs = lastWriteMs * PARSER_LIVE_FLUSH_WRITE_FACTOR;
+        if (flushIntervalMs < PARSER_LIVE_FLUSH_MS) {
+            flushIntervalMs = PARSER_LIVE_FLUSH_MS;
         }
-
-        bool isAscii = c >= 0 && c < 0x80;
-        bool isCodePointStart = UTF8_IS_START(c);
-
-        bool addToBuffer = isAscii;
-        if (isCodePointStart) {
-            c = '?';
-            addToBuffer = true;
+        if (unflushed && (closed || flushTimer.elapsedMs >= flushIntervalMs)) {
+            WRITE_SEGMENT()
         }
 
-        if (addToBuffer) {
-            assert(length <= capacity);
-            if (capacity == 0 || length == capacity) {
-                capacity = (capacity == 0) ? 4096 : (capacity + capacity / 2);
-                buffer = (char*)realloc(buffer, capacity);
-            }
+        uint64_t drops = buschla_live_load_acquire(&live.header->droppedRecords);
+        if (drops != reportedDrops) {
+            printf("ring full, producer dropped %lu lines (%lu in total)\n", (unsigned long)(drops - reportedDrops), (unsigned long)drops);
+            reportedDrops = drops;
+        }
 
-            buffer[length] = c;
-            ++length;
+        if (closed) {
+            break;
+        }
+        if (readCount == 0) {
+            usleep(1000);
         }
     }
 
-    *lengthOut = length;
-    return buffer;
-}
+#undef WRITE_SEGMENT
 
-#define TOKEN_KINDS(X) \
-    X(TOK_EOF) \
-    X(TOK_SINGLE_SPECIAL) \
-    X(TOK_INTEGER) \
-    X(TOK_HEX) \
-    X(TOK_BINARY) \
-    X(TOK_FLOAT) \
-    X(TOK_WORD) \
-    X(TOK_PATH)
-// TODO: DateTime
+    printf("live channel closed after %u lines in %u segments, producer dropped %lu lines\n",
+           lineNum, segmentIndex + 1, (unsigned long)live.header->droppedRecords);
+    buschla_live_detach(&live);
 
-typedef enum {
- #define X(x) x,
-    TOKEN_KINDS(X)
-#undef X
-} TokenKind;
+    return exitCode;
+}
 
-const char* tokenKindStrs[] = {
- #define X(x) #x,
-    TOKEN_KINDS(X)
-#undef X
-};
+//# -------------- Daemon -------------- #//
 
-typedef struct {
-    TokenKind kind;
-    StrView str;
-} LexerToken;
+#define PARSER_DAEMON_DEFAULT_WORKERS 2
+#define PARSER_DAEMON_DEFAULT_QUEUE 64
+// How often the directory watcher is polled and the metrics are printed.
+#define PARSER_DAEMON_POLL_MS 50
+#define PARSER_DAEMON_METRICS_MS 10000
+// Files modified more recently than this are left alone by directory scans, they are probably still being written.
+// Their change notification (or the next scan) picks them up.
+#define PARSER_DAEMON_SETTLE_MS 2000
+// Scans are repeated at most this often while some files were left out.
+#define PARSER_DAEMON_SCAN_MS 1000
 
 typedef struct {
-    StrView str;
-    const char* pos;
+    char path[PATH_MAX];
+    // Started when the job is queued.
+    Timer latency;
+} DaemonJob;
 
-    LexerToken token;
-} Lexer;
+// Jobs waiting for a worker, shared by all threads (guarded by mutex).
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t jobAvailable;
+
+    // Ring buffer, the daemon stops taking new files while capacity jobs are waiting.
+    // It has room for workerCount more, the files that changed while a worker converted them are queued again.
+    DaemonJob* jobs;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    bool stopping;
+
+    // Path each worker is converting, empty while idle.
+    char (*activePaths)[PATH_MAX];
+    // Set when the active path changes during the conversion, the output misses the new data.
+    bool* activeChanged;
+    uint32_t workerCount;
+
+    // Totals since the daemon started, except peakCount which is reset with every metrics line.
+    uint32_t peakCount;
+    uint32_t converted;
+    uint32_t failed;
+    uint64_t lines;
+    uint64_t bytes;
+    double latencyMs;
+} DaemonQueue;
 
-static bool isWhiteSpace(char c)
+typedef struct {
+    DaemonQueue* queue;
+    uint32_t index;
+    const char* outputDir;
+    pthread_t thread;
+    // Options are copied from the parser set up by main, each worker keeps its allocations between files.
+    Parser parser;
+    ParserDialect dialect;
+} DaemonWorker;
+
+static volatile sig_atomic_t daemonStopRequested = 0;
+
+static void requestDaemonStop(int signal)
 {
-    return c == ' ' || c == '\t';
+    (void)signal;
+    daemonStopRequested = 1;
 }
 
-static bool isDigit(char c)
+static bool endsWith(const char* str, const char* suffix)
 {
-    return c >= '0' && c <= '9';
+    size_t length = strlen(str);
+    size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(str + length - suffixLength, suffix) == 0;
 }
 
-static bool isHexDigit(char c)
+static const char* baseName(const char* path)
 {
-    return (c >= '0' && c <= '9') ||
-           (c >= 'a' && c <= 'f') ||
-           (c >= 'A' && c <= 'F');
+    const char* slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
 }
 
-static bool isLetter(char c)
+// Skips our own output, temporary and hidden files.
+static bool isDaemonInput(const char* path)
 {
-    return (c >= 'a' && c <= 'z') ||
-           (c >= 'A' && c <= 'Z');
+    const char* name = baseName(path);
+    return name[0] != '.' && !endsWith(name, ".buschla") && !endsWith(name, ".tmp");
 }
 
-static bool isPath(char c)
+// Next to the log (game.log -> game.log.buschla), or in outputDir if there is one.
+static void daemonOutputPath(const char* inputPath, const char* outputDir, char* pathOut, size_t size)
 {
-    return (c >= 'a' && c <= 'z') ||
-           (c >= 'A' && c <= 'Z') ||
-           c == ':' || c == '.' || c == '/' || c == '\\';
+    if (outputDir != NULL) {
+        snprintf(pathOut, size, "%s/%s.buschla", outputDir, baseName(inputPath));
+    }
+    else {
+        snprintf(pathOut, size, "%s.buschla", inputPath);
+    }
 }
 
-static bool nextToken(Lexer* lex)
+// True if there is no output yet, or the log was modified after it was written.
+static bool daemonNeedsConversion(const char* inputPath, const char* outputDir)
 {
-#define RETURN_TOKEN(_kind) { \
-    lex->pos = p; \
-    lex->token.kind = (_kind); \
-    lex->token.str.txt = tokenStart; \
-    lex->token.str.len = p - tokenStart; \
-    return true; \
-}
-
-    const char* p = lex->pos;
-    while (isWhiteSpace(*p)) {
-        ++p;
-    }
-
-    const char* tokenStart = p;
-    switch (*p) {
-    case '\0':
+    struct stat input;
+    if (stat(inputPath, &input) != 0 || !S_ISREG(input.st_mode)) {
         return false;
-    case '0': {
-        if (p[1] == 'x' && isHexDigit(p[2])) {
-            p += 2;
-            while (isHexDigit(*p)) {
-                ++p;
-            }
-
-            RETURN_TOKEN(TOK_HEX)
-        }
-
-        if (p[1] == 'b') {
-            p += 2;
-            while (*p == '0' || *p == '1') {
-                ++p;
-            }
-            RETURN_TOKEN(TOK_BINARY)
-        }
-    } // Fall through on purpose!
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-lex_integer:
-        while (isDigit(*p)) {
-            ++p;
-        }
-
-        if (*p == 'e' || *p == 'E') {
-            goto lex_float_exponent;
-        }
+    }
 
-        if (*p == '.') {
-            ++p;
-            while (isDigit(*p)) {
-                ++p;
-            }
+    char outputPath[PATH_MAX + 16];
+    daemonOutputPath(inputPath, outputDir, outputPath, sizeof(outputPath));
+    struct stat output;
+    if (stat(outputPath, &output) != 0) {
+        return true;
+    }
 
-            if (*p == 'e' || *p == 'E') {
-lex_float_exponent:
-                ++p;
-                if (*p == '+' || *p == '-') {
-                    ++p;
-                }
-                while (isDigit(*p)) {
-                    ++p;
-                }
-            }
+    return input.st_mtim.tv_sec > output.st_mtim.tv_sec ||
+           (input.st_mtim.tv_sec == output.st_mtim.tv_sec && input.st_mtim.tv_nsec > output.st_mtim.tv_nsec);
+}
 
-            RETURN_TOKEN(TOK_FLOAT)
-        }
+// Returns false if the queue is full.
+// Files that are already queued are not added again, the ones being converted are queued again when they are done.
+static bool daemonEnqueue(DaemonQueue* queue, const char* path)
+{
+    pthread_mutex_lock(&queue->mutex);
 
-        RETURN_TOKEN(TOK_INTEGER)
-    }
-    break;
-    case '-':
-        if (p[1] == '.' && isDigit(p[2])) {
-            ++p;
-            goto lex_integer;
-        }
-    case '.':
-    case '+': {
-        if (isDigit(p[1])) {
-            ++p;
-            goto lex_integer;
-        }
-    } // Fall through on purpose!
-    case ':':
-    case '=':
-    case '|':
-    case '(':
-    case ')':
-    case '[':
-    case ']':
-    case '<':
-    case '>': {
-lex_single_special:
-        ++p;
-        RETURN_TOKEN(TOK_SINGLE_SPECIAL)
+    bool known = false;
+    uint32_t ringSize = queue->capacity + queue->workerCount;
+    for (uint32_t i = 0; i < queue->count && !known; ++i) {
+        known = strcmp(queue->jobs[(queue->head + i) % ringSize].path, path) == 0;
     }
-    break;
-    case '~': {
-        if (p[1] != '/') {
-            goto lex_single_special;
-        }
-    } // Fall through on purpose!
-    case '/': {
-lex_path:
-        while (isPath(*p)) {
-            ++p;
+    for (uint32_t i = 0; i < queue->workerCount && !known; ++i) {
+        if (strcmp(queue->activePaths[i], path) == 0) {
+            queue->activeChanged[i] = true;
+            known = true;
         }
-        RETURN_TOKEN(TOK_PATH)
     }
-    break;
-    default: {
-        // Windows absolute paths start with 'A:/' or 'A:\'
-        if (isLetter(*p) && p[1] == ':' && (p[2] == '/' || p[2] == '\\')) {
-            goto lex_path;
-        }
 
-        while (isLetter(*p) || *p == '_') {
-            ++p;
+    bool full = queue->count >= queue->capacity;
+    if (!known && !full) {
+        DaemonJob* job = queue->jobs + (queue->head + queue->count) % ringSize;
+        snprintf(job->path, sizeof(job->path), "%s", path);
+        timerBegin(&job->latency);
+        ++queue->count;
+        if (queue->count > queue->peakCount) {
+            queue->peakCount = queue->count;
         }
-        RETURN_TOKEN(TOK_WORD)
-    }
-    break;
+        pthread_cond_signal(&queue->jobAvailable);
     }
 
-    return false;
-
-#undef RETURN_TOKEN
+    pthread_mutex_unlock(&queue->mutex);
+    return known || !full;
 }
 
-static void parseLine(LogLine* line)
+static bool daemonQueueFull(DaemonQueue* queue)
 {
-    // go through line token by token, try to parse frame number, frame time, values and keywords.
-
-    Lexer lex;
-    memcpy(&lex.str, &line->str, sizeof(StrView));
-    lex.pos = lex.str.txt;
+    pthread_mutex_lock(&queue->mutex);
+    bool full = queue->count >= queue->capacity;
+    pthread_mutex_unlock(&queue->mutex);
+    return full;
+}
 
-    printf("parsing '%s':\n", line->str.txt);
+// Queues every log in the directory that has no up-to-date output.
+// Returns false if some were left out, because the queue filled up or they are still being written.
+static bool daemonScanDirectory(DaemonQueue* queue, const char* directory, const char* outputDir)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
 
-#define PARSER_TOKEN_LOOKBACK 5
-    LexerToken history[PARSER_TOKEN_LOOKBACK];
-    memset(history, 0, sizeof(history));
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        perror("opendir");
+        return true;
+    }
 
-    int historyHeadIndex = 0;
-#define GET_HISTORY_INDEX(i) ((historyHeadIndex + (i) + PARSER_TOKEN_LOOKBACK) % PARSER_TOKEN_LOOKBACK)
-#define HISTORY_TOKEN(i) history[GET_HISTORY_INDEX(i)]
-    while (nextToken(&lex)) {
-        LexerToken currentToken = lex.token;
-        printf("(%s): '%.*s'\n", tokenKindStrs[currentToken.kind], currentToken.str.len, currentToken.str.txt);
-        if (lex.token.str.len == 0) {
-            assert(0 && "WHAT THE HELL=!=?");
+    bool complete = true;
+    char path[PATH_MAX];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        if (!isDaemonInput(path) || !daemonNeedsConversion(path, outputDir)) {
+            continue;
         }
 
-        history[historyHeadIndex] = currentToken;
-
-        LexerToken previousToken = HISTORY_TOKEN(-1);
-        LexerToken previousPreviousToken = HISTORY_TOKEN(-2);
-        if (currentToken.kind == TOK_INTEGER &&
-                previousToken.kind == TOK_SINGLE_SPECIAL &&
-                *previousToken.str.txt == ':' &&
-                previousPreviousToken.kind == TOK_WORD) {
-            printf("found value!\n'%.*s' = '%.*s'\n", previousPreviousToken.str.len, previousPreviousToken.str.txt, currentToken.str.len, currentToken.str.txt);
+        struct stat input;
+        if (stat(path, &input) == 0) {
+            double ageMs = (double)(now.tv_sec - input.st_mtim.tv_sec) * 1e3 + (double)(now.tv_nsec - input.st_mtim.tv_nsec) * 1e-6;
+            if (ageMs < PARSER_DAEMON_SETTLE_MS) {
+                complete = false;
+                continue;
+            }
         }
 
-        historyHeadIndex = (historyHeadIndex + 1) % PARSER_TOKEN_LOOKBACK;
+        if (!daemonEnqueue(queue, path)) {
+            complete = false;
+            break;
+        }
     }
-}
 
-#define _STR_(x) #x
-#define STR(x) _STR_(x)
+    closedir(dir);
+    return complete;
+}
 
-static int writeOutput(FILE* file, Chars* textBuffer, LogLines* logLines)
+static void* runDaemonWorker(void* arg)
 {
-    // TODO: I like the structure that we have in tryLoadBuschlaFile, also implement WRITE properly and put it in a header file!
-#define ERROR(fmt, ...) fprintf(stderr, __FILE__ ":" STR(__LINE__) " " fmt, __VA_ARGS__)
-#define SEEK(pos) { int ret = fseek(file, (pos), SEEK_SET); if (ret != 0) { ERROR("fseek to %d failed. returned %d: %s\n", (pos), ret, strerror(ret)); return 105; } }
-#define WRITE(ptr, size) { size_t written = fwrite((ptr), 1, (size), file); if (written != (size)) { ERROR("fwrite of '%s' failed\n", #ptr); return 110; } }
+    DaemonWorker* worker = (DaemonWorker*)arg;
+    DaemonQueue* queue = worker->queue;
+    Parser* parser = &worker->parser;
+    beginParsing(parser);
 
-    BuschlaFileHeader header;
-    uint32_t headerSize = (uint32_t)sizeof(BuschlaFileHeader);
-    memset(&header, 0xdc, headerSize);
+    while (true) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->count == 0 && !queue->stopping) {
+            pthread_cond_wait(&queue->jobAvailable, &queue->mutex);
+        }
+        if (queue->count == 0) {
+            pthread_mutex_unlock(&queue->mutex);
+            break;
+        }
+        DaemonJob job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % (queue->capacity + queue->workerCount);
+        --queue->count;
+        snprintf(queue->activePaths[worker->index], PATH_MAX, "%s", job.path);
+        pthread_mutex_unlock(&queue->mutex);
+
+        char outputPath[PATH_MAX + 16];
+        daemonOutputPath(job.path, worker->outputDir, outputPath, sizeof(outputPath));
+
+        // Files written with buschla_log.h are always binary.
+        parser->dialect = endsWith(job.path, ".bblog") ? DIALECT_BINARY : worker->dialect;
+
+        uint32_t lines = 0;
+        uint64_t bytes = 0;
+        int exitCode = 50;
+        FILE* inputFile = fopen(job.path, "r");
+        if (inputFile != NULL) {
+            parseInput(parser, inputFile, &lines);
+            bytes = (uint64_t)ftell(inputFile);
+            fclose(inputFile);
+            exitCode = writeOutputFile(parser, outputPath);
+
+            // Files have nothing to do with each other, unlike live segments.
+            resetParser(parser);
+            memset(&parser->hitchDetector, 0, sizeof(HitchDetector));
+            for (uint32_t i = 0; i < parser->alertRules.count; ++i) {
+                ar_reset(parser->alertRules.items + i);
+            }
+            parser->alertLineStep = 0;
+        }
+        else {
+            fprintf(stderr, "[daemon] cannot open '%s': %s\n", job.path, strerror(errno));
+        }
+        timerEnd(&job.latency);
+
+        pthread_mutex_lock(&queue->mutex);
+        queue->activePaths[worker->index][0] = '\0';
+        if (queue->activeChanged[worker->index] && !queue->stopping) {
+            // There is always room, this worker took a job out and every worker queues at most one again.
+            DaemonJob* again = queue->jobs + (queue->head + queue->count) % (queue->capacity + queue->workerCount);
+            snprintf(again->path, sizeof(again->path), "%s", job.path);
+            timerBegin(&again->latency);
+            ++queue->count;
+            pthread_cond_signal(&queue->jobAvailable);
+        }
+        queue->activeChanged[worker->index] = false;
+        if (exitCode == 0) {
+            ++queue->converted;
+            queue->lines += lines;
+            queue->bytes += bytes;
+            queue->latencyMs += job.latency.elapsedMs;
+        }
+        else {
+            ++queue->failed;
+        }
+        pthread_mutex_unlock(&queue->mutex);
 
-    header.headerSize = headerSize;
+        if (exitCode == 0) {
+            printf("[daemon] converted '%s' (%u lines) to '%s' after %.0fms\n", job.path, lines, outputPath, job.latency.elapsedMs);
+        }
+    }
 
-    memcpy(header.magic, "BUSCHLA", sizeof(header.magic));
-    header.version = 1;
+    return NULL;
+}
 
-    uint32_t logLineStride = (uint32_t)sizeof(LogLine);
-    header.logLineStride = logLineStride;
+typedef struct {
+    uint32_t converted;
+    uint64_t lines;
+    uint64_t bytes;
+} DaemonTotals;
 
-    uint32_t logLinesOffset = headerSize;
-    header.logLinesOffset = logLinesOffset;
+static void printDaemonMetrics(DaemonQueue* queue, DaemonTotals* last, float intervalMs)
+{
+    pthread_mutex_lock(&queue->mutex);
+    uint32_t count = queue->count;
+    uint32_t peakCount = queue->peakCount;
+    queue->peakCount = count;
+    uint32_t busy = 0;
+    for (uint32_t i = 0; i < queue->workerCount; ++i) {
+        busy += queue->activePaths[i][0] != '\0' ? 1 : 0;
+    }
+    DaemonTotals totals = { queue->converted, queue->lines, queue->bytes };
+    uint32_t failed = queue->failed;
+    double latencyMs = queue->latencyMs;
+    pthread_mutex_unlock(&queue->mutex);
+
+    double seconds = intervalMs * 1e-3;
+    printf("[daemon] queue %u/%u (peak %u), busy workers %u/%u, converted %u (+%u), failed %u, "
+           "%.0f lines/s, %.2f MB/s, avg latency %.0fms\n",
+           count, queue->capacity, peakCount, busy, queue->workerCount,
+           totals.converted, totals.converted - last->converted, failed,
+           (double)(totals.lines - last->lines) / seconds,
+           (double)(totals.bytes - last->bytes) / (1024.0 * 1024.0) / seconds,
+           totals.converted > 0 ? latencyMs / totals.converted : 0.0);
+    fflush(stdout);
+    *last = totals;
+}
 
-    uint32_t logLineCount = logLines->count;
-    header.logLineCount = logLineCount;
+// Converts every log that appears in directory (and the ones already there) until SIGINT/SIGTERM.
+// Workers take files from a bounded queue. While the queue is full, change notifications are not read,
+// anything missed in the meantime is found by scanning the directory again once there is room.
+static int runDaemon(Parser* parser, const char* directory, const char* outputDir, uint32_t workerCount, uint32_t queueCapacity)
+{
+    DirWatcherState watcher;
+    memset(&watcher, 0, sizeof(DirWatcherState));
+    DirWatcherConfig_AppendDirectory(&watcher.config, directory);
+    if (!DirWatcher_Init(&watcher)) {
+        return 1;
+    }
 
-    uint32_t textBufferOffset = logLinesOffset + logLineCount * logLineStride;
-    header.textBufferOffset = textBufferOffset;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestDaemonStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    DaemonQueue queue;
+    memset(&queue, 0, sizeof(DaemonQueue));
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.jobAvailable, NULL);
+    queue.capacity = queueCapacity;
+    queue.jobs = (DaemonJob*)calloc(queueCapacity + workerCount, sizeof(DaemonJob));
+    queue.workerCount = workerCount;
+    queue.activePaths = (char (*)[PATH_MAX])calloc(workerCount, PATH_MAX);
+    queue.activeChanged = (bool*)calloc(workerCount, sizeof(bool));
+    assert(queue.jobs != NULL && queue.activePaths != NULL && queue.activeChanged != NULL);
+
+    DaemonWorker* workers = (DaemonWorker*)calloc(workerCount, sizeof(DaemonWorker));
+    assert(workers != NULL);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers[i].queue = &queue;
+        workers[i].index = i;
+        workers[i].outputDir = outputDir;
+        workers[i].parser = *parser;
+        // Every worker counts in windows of its own.
+        memset(&workers[i].parser.alertRules, 0, sizeof(AlertRules));
+        for (uint32_t r = 0; r < parser->alertRules.count; ++r) {
+            da_append(&workers[i].parser.alertRules, parser->alertRules.items[r]);
+        }
+        workers[i].dialect = parser->dialect;
+        int ret = pthread_create(&workers[i].thread, NULL, runDaemonWorker, workers + i);
+        assert(ret == 0 && "pthread_create failed");
+    }
 
-    uint32_t currentLogLineOffset = logLinesOffset;
-    uint32_t currentTextBufferOffset = textBufferOffset;
-    for (uint32_t i = 0; i < logLines->count; ++i) {
-        uint32_t textAddress = currentTextBufferOffset;
+    printf("[daemon] watching '%s' with %u workers (queue of %u)\n", directory, workerCount, queueCapacity);
+    fflush(stdout);
+
+    DaemonTotals lastTotals;
+    memset(&lastTotals, 0, sizeof(DaemonTotals));
+    Timer metricsTimer;
+    timerBegin(&metricsTimer);
+
+    // The first scan picks up the logs that arrived while the daemon was not running.
+    bool needsScan = true;
+    Timer scanTimer;
+    memset(&scanTimer, 0, sizeof(Timer));
+    scanTimer.elapsedMs = PARSER_DAEMON_SCAN_MS;
+    while (!daemonStopRequested) {
+        if (daemonQueueFull(&queue)) {
+            needsScan = true;
+        }
+        else {
+            if (needsScan && scanTimer.elapsedMs >= PARSER_DAEMON_SCAN_MS) {
+                needsScan = !daemonScanDirectory(&queue, directory, outputDir);
+                timerBegin(&scanTimer);
+            }
 
-        LogLine* logLine = logLines->items + i;
-        uint32_t textLength = logLine->str.len;
+            DirWatcherEvent event;
+            while (!daemonQueueFull(&queue) && DirWatcher_PollEvent(&watcher, &event)) {
+                if (event.type != DIRWATCHER_EVENT_FILE_CHANGED) {
+                    continue;
+                }
+                for (int i = 0; i < event.fileChanged.count; ++i) {
+                    const char* path = event.fileChanged.paths[i];
+                    if (isDaemonInput(path) && !daemonEnqueue(&queue, path)) {
+                        needsScan = true;
+                    }
+                }
+            }
+        }
 
-        SEEK(currentTextBufferOffset);
-        WRITE(logLine->str.txt, textLength + 1);
-        currentTextBufferOffset += textLength + 1;
+        if (watcher.pipeClosed) {
+            fprintf(stderr, "[daemon] directory watcher stopped\n");
+            break;
+        }
 
-        logLine->str.txt = (const char*)(uint64_t)textAddress;
+        timerEnd(&scanTimer);
+        timerEnd(&metricsTimer);
+        if (metricsTimer.elapsedMs >= PARSER_DAEMON_METRICS_MS) {
+            printDaemonMetrics(&queue, &lastTotals, metricsTimer.elapsedMs);
+            timerBegin(&metricsTimer);
+        }
 
-        SEEK(currentLogLineOffset);
-        WRITE(logLine, logLineStride);
-        currentLogLineOffset += logLineStride;
+        usleep(PARSER_DAEMON_POLL_MS * 1000);
     }
 
-    assert(currentLogLineOffset == textBufferOffset);
+    // Files in progress are finished, the ones still queued are picked up by the next start.
+    printf("[daemon] stopping\n");
+    pthread_mutex_lock(&queue.mutex);
+    queue.stopping = true;
+    queue.count = 0;
+    pthread_cond_broadcast(&queue.jobAvailable);
+    pthread_mutex_unlock(&queue.mutex);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
 
-    header.textBufferSize = currentTextBufferOffset - textBufferOffset;
-    header.totalSize = textBufferOffset + header.textBufferSize;
+    timerEnd(&metricsTimer);
+    printDaemonMetrics(&queue, &lastTotals, metricsTimer.elapsedMs);
 
-    SEEK(0);
-    WRITE(&header, headerSize);
+    DirWatcher_Shutdown(&watcher);
+    free(workers);
+    free(queue.jobs);
+    free(queue.activePaths);
+    free(queue.activeChanged);
+    pthread_cond_destroy(&queue.jobAvailable);
+    pthread_mutex_destroy(&queue.mutex);
 
     return 0;
+}
 
-#undef WRITE
-#undef ERROR
-#undef SEEK
+#define PARSER_CACHE_DEFAULT_MB 1024
+
+// bench.cpp includes the parser to benchmark its parse path, without the command line.
+#ifndef BUSCHLA_PARSER_NO_MAIN
+
+// Everything besides the inputs that changes the output, see parse_cache.h.
+// Any rebuild of the parser starts over, the output format has no version of its own.
+static void describeParseOptions(Parser* parser, uint32_t inputCount, char* out, size_t size)
+{
+    int length = snprintf(out, size, "build %s %s, sections %d, inputs %u, dialect %s, frame key %s, frame time key %s, trigrams %d, tokens %d, chunk store %s, raw text %d",
+        __DATE__, __TIME__, SECTION_COUNT, inputCount, parserDialectNames[parser->dialect], parser->frameKey, parser->frameTimeKey,
+        !parser->skipTrigrams, parser->storeTokens, parser->chunkStore != NULL ? parser->chunkStore : "-", parser->rawText);
+    for (uint32_t i = 0; i < parser->alertRules.count && length > 0 && (size_t)length < size; ++i) {
+        length += snprintf(out + length, size - length, ", alert %s", parser->alertRules.items[i].text);
+    }
+    for (uint32_t i = 0; i < parser->entityKeyCount && length > 0 && (size_t)length < size; ++i) {
+        length += snprintf(out + length, size - length, ", entity key %s", parser->entityKeys[i]);
+    }
 }
 
 static void printUsage(int argc, char** argv)
 {
-    printf("Usage: %s <input file path>\n", argv[0]);
+    printf("Usage: %s [options] <input file path>\n", argv[0]);
+    printf("       %s [options] <input file path> <input file path>...  (merged by timestamp)\n", argv[0]);
+    printf("       %s [options] --live <channel name>\n", argv[0]);
+    printf("       %s [options] --daemon <directory>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -o <path>            output file (default: out.buschla)\n");
+    printf("  --live <name>        parse lines from a live channel (see buschla_live.h) into segments out.0000.buschla, ...\n");
+    printf("  --segment-lines <n>  lines per live segment (default: %d)\n", PARSER_LIVE_DEFAULT_SEGMENT_LINES);
+    printf("  --daemon <dir>       convert every log that appears in dir to <log>.buschla (into the -o directory if given), until stopped\n");
+    printf("  --workers <n>        daemon: number of files converted in parallel (default: %d)\n", PARSER_DAEMON_DEFAULT_WORKERS);
+    printf("  --queue <n>          daemon: files waiting for a worker before new ones are deferred (default: %d)\n", PARSER_DAEMON_DEFAULT_QUEUE);
+    printf("  --frame-key <key>    value key holding the frame number (default: frame)\n");
+    printf("  --frame-time-key <key>  value key holding the frame time, used to detect hitches (default: time)\n");
+    printf("  --no-trigrams        do not build the trigram index for substring search\n");
+    printf("  --chunk-store <dir>  store the text in deduplicated chunks in dir, shared by all files written with it\n");
+    printf("  --raw-text           do not compress the text (files get larger, lines are read without decompressing)\n");
+    printf("  --entity-key <key>   values of key (\"key: 42\" or \"key=abc\") are entities like hex values, can be given up to %d times\n", PARSER_MAX_ENTITY_KEYS);
+    printf("  --alert <rule>       report when a text is found too often, e.g. \"OutOfMemory > 50 in 1000 frames\" (or lines),\n");
+    printf("                       can be given several times, alerts are stored in the output and printed with --live\n");
+    printf("  --cache <dir>        reuse the output of earlier runs with the same inputs and options, kept in dir\n");
+    printf("  --cache-size <MB>    size of the cache before the least recently used files are deleted (default: %d)\n", PARSER_CACHE_DEFAULT_MB);
+    printf("  --tokens             store the lexer tokens of every line (text dialects only)\n");
+    printf("  --dialect <dialect>  input format:");
+    for (int i = 0; i < DIALECT_COUNT; ++i) {
+        printf(" %s", parserDialectNames[i]);
+    }
+    printf(" (default: %s)\n", parserDialectNames[DIALECT_TEXT]);
 }
 
 int main(int argc, char** argv)
@@ -403,19 +3286,163 @@ int main(int argc, char** argv)
     Timer timer;
     timerBegin(&timer);
 
-    // TODO: What kind of command line options do we want?
-    // and how do we parse them?
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.frameKey = "frame";
+    parser.frameTimeKey = "time";
 
-    // FIXME: For now: assume the first option is the file name we want to read.
+    const char* fileNames[PARSER_MAX_INPUTS];
+    uint32_t fileCount = 0;
+    const char* outputFileName = "out.buschla";
+    bool hasOutputFileName = false;
+    const char* liveChannelName = NULL;
+    uint32_t segmentLines = PARSER_LIVE_DEFAULT_SEGMENT_LINES;
+    const char* daemonDirectory = NULL;
+    uint32_t daemonWorkers = PARSER_DAEMON_DEFAULT_WORKERS;
+    uint32_t daemonQueue = PARSER_DAEMON_DEFAULT_QUEUE;
+    const char* cacheDirectory = NULL;
+    uint64_t cacheMegabytes = PARSER_CACHE_DEFAULT_MB;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-o") == 0 && hasValue) {
+            outputFileName = argv[++i];
+            hasOutputFileName = true;
+        }
+        else if (strcmp(arg, "--live") == 0 && hasValue) {
+            liveChannelName = argv[++i];
+        }
+        else if (strcmp(arg, "--segment-lines") == 0 && hasValue) {
+            int value = atoi(argv[++i]);
+            segmentLines = value > 0 ? (uint32_t)value : 1;
+        }
+        else if (strcmp(arg, "--daemon") == 0 && hasValue) {
+            daemonDirectory = argv[++i];
+        }
+        else if (strcmp(arg, "--workers") == 0 && hasValue) {
+            int value = atoi(argv[++i]);
+            daemonWorkers = value > 0 ? (uint32_t)value : 1;
+        }
+        else if (strcmp(arg, "--queue") == 0 && hasValue) {
+            int value = atoi(argv[++i]);
+            daemonQueue = value > 0 ? (uint32_t)value : 1;
+        }
+        else if (strcmp(arg, "--frame-key") == 0 && hasValue) {
+            parser.frameKey = argv[++i];
+        }
+        else if (strcmp(arg, "--frame-time-key") == 0 && hasValue) {
+            parser.frameTimeKey = argv[++i];
+        }
+        else if (strcmp(arg, "--no-trigrams") == 0) {
+            parser.skipTrigrams = true;
+        }
+        else if (strcmp(arg, "--chunk-store") == 0 && hasValue) {
+            parser.chunkStore = argv[++i];
+        }
+        else if (strcmp(arg, "--raw-text") == 0) {
+            parser.rawText = true;
+        }
+        else if (strcmp(arg, "--entity-key") == 0 && hasValue && parser.entityKeyCount < PARSER_MAX_ENTITY_KEYS) {
+            parser.entityKeys[parser.entityKeyCount++] = argv[++i];
+        }
+        else if (strcmp(arg, "--alert") == 0 && hasValue) {
+            AlertRule* rule = da_append_get(&parser.alertRules);
+            if (!ar_parse(rule, argv[++i])) {
+                fprintf(stderr, "invalid alert rule '%s', expected '<text> > <count> in <window> lines|frames'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "--cache") == 0 && hasValue) {
+            cacheDirectory = argv[++i];
+        }
+        else if (strcmp(arg, "--cache-size") == 0 && hasValue) {
+            long value = atol(argv[++i]);
+            cacheMegabytes = value > 0 ? (uint64_t)value : 0;
+        }
+        else if (strcmp(arg, "--tokens") == 0) {
+            parser.storeTokens = true;
+        }
+        else if (strcmp(arg, "--dialect") == 0 && hasValue) {
+            const char* name = argv[++i];
+            int dialect = 0;
+            while (dialect < DIALECT_COUNT && strcmp(name, parserDialectNames[dialect]) != 0) {
+                ++dialect;
+            }
+            if (dialect == DIALECT_COUNT) {
+                fprintf(stderr, "unknown dialect '%s'\n", name);
+                printUsage(argc, argv);
+                return 1;
+            }
+            parser.dialect = (ParserDialect)dialect;
+        }
+        else if (arg[0] != '-' && fileCount < PARSER_MAX_INPUTS) {
+            fileNames[fileCount++] = arg;
+        }
+        else {
+            printUsage(argc, argv);
+            return 1;
+        }
+    }
 
-    if (argc != 2) {
+    if (liveChannelName != NULL) {
+        parser.printAlerts = true;
+        return runLive(&parser, liveChannelName, outputFileName, segmentLines);
+    }
+
+    if (daemonDirectory != NULL) {
+        return runDaemon(&parser, daemonDirectory, hasOutputFileName ? outputFileName : NULL, daemonWorkers, daemonQueue);
+    }
+
+    if (fileCount == 0) {
         printUsage(argc, argv);
         return 1;
     }
 
+    ParseCache cache;
+    bool cacheUsed = false;
+    if (cacheDirectory != NULL) {
+        char options[4096];
+        describeParseOptions(&parser, fileCount, options, sizeof(options));
+        cacheUsed = pc_init(&cache, cacheDirectory, cacheMegabytes << 20, fileNames, fileCount, options);
+        if (cacheUsed && pc_fetch(&cache, outputFileName)) {
+            timerEnd(&timer);
+            printf("got '%s' from the parse cache\ntook %.3fms\n", outputFileName, timer.elapsedMs);
+            return 0;
+        }
+    }
+
     //# -------------- Read Input -------------- #//
 
-    char* fileName = argv[1];
+    if (fileCount > 1) {
+        if (parser.dialect == DIALECT_BINARY) {
+            fprintf(stderr, "binary logs cannot be merged\n");
+            return 1;
+        }
+
+        printf("merging %u inputs by timestamp (dialect: %s)\n", fileCount, parserDialectNames[parser.dialect]);
+        beginParsing(&parser);
+
+        uint32_t lines = 0;
+        bool merged;
+        TIME_SCOPE(mergeTimer) {
+            merged = parseMerged(&parser, fileNames, fileCount, &lines);
+        }
+        if (!merged) {
+            return 50;
+        }
+        printf("merged %u lines in %.3fms\n", lines, mergeTimer.elapsedMs);
+
+        int exitCode = writeOutputFile(&parser, outputFileName);
+        if (exitCode == 0 && cacheUsed) {
+            pc_store(&cache, outputFileName);
+        }
+        timerEnd(&timer);
+        printf("finished writing file\ntook %.3fms\n", timer.elapsedMs);
+        return exitCode;
+    }
+
+    const char* fileName = fileNames[0];
 
     printf("opening file '%s' for read\n", fileName);
     FILE* inputFile = fopen(fileName, "r");
@@ -424,37 +3451,16 @@ int main(int argc, char** argv)
         return 50;
     }
 
-    Chars textBuffer;
-    memset(&textBuffer, 0, sizeof(Chars));
-    LogLines logLines;
-    memset(&logLines, 0, sizeof(LogLines));
-
-    printf("parsing log lines\n");
-
-    int lines = 0;
-    while (true) {
-        StrView lineView;
-        lineView.len = 0;
-        lineView.txt = fetchLine(inputFile, &lineView.len);
-
-        // TODO: If first line is empty, then we parse nothing ?!
-        if (lineView.txt == NULL) {
-            break;
-        }
-
-        if (lineView.len > 0) {
-            LogLine* logLine = da_append_get(&logLines);
-            logLine->lineNum = lines + 1;
-            logLine->str.txt = ca_commit_view(&textBuffer, lineView);
-            logLine->str.len = lineView.len;
+    printf("parsing log lines (dialect: %s)\n", parserDialectNames[parser.dialect]);
 
-            parseLine(logLine);
-        }
+    beginParsing(&parser);
 
-        ++lines;
+    uint32_t lines = 0;
+    TIME_SCOPE(parseTimer) {
+        parseInput(&parser, inputFile, &lines);
     }
 
-    printf("parsed %u lines\n", lines);
+    printf("parsed %u lines in %.3fms\n", lines, parseTimer.elapsedMs);
 
     int fcloseRet = fclose(inputFile);
     if (fcloseRet != 0) {
@@ -463,25 +3469,15 @@ int main(int argc, char** argv)
 
     printf("finished parsing file\n");
 
-    // ca_dump(stdout, &textBuffer);
+    // ca_dump(stdout, &parser.textBuffer);
 
     //# -------------- Write Output -------------- #//
 
-    const char* outputFileName = "out.buschla";
-    printf("opening file '%s' for write\n", outputFileName);
-    FILE* outputFile = fopen(outputFileName, "w");
-    if (outputFile == NULL) {
-        perror("fopen output");
-        return 100;
-    }
-
-    int exitCode = writeOutput(outputFile, &textBuffer, &logLines);
-
-    // TODO: if an error occured while writing, should we delete the output file?
-
-    fcloseRet = fclose(outputFile);
-    if (fcloseRet != 0) {
-        perror("fclose output");
+    // Written next to the output and renamed, the output may be a hard link into the parse cache.
+    printf("writing file '%s'\n", outputFileName);
+    int exitCode = writeOutputFile(&parser, outputFileName);
+    if (exitCode == 0 && cacheUsed) {
+        pc_store(&cache, outputFileName);
     }
 
     timerEnd(&timer);
@@ -498,11 +3494,8 @@ int main(int argc, char** argv)
     // MEMBER(BuschlaFileHeader, version);
     // MEMBER(BuschlaFileHeader, headerSize);
     // MEMBER(BuschlaFileHeader, totalSize);
-    // MEMBER(BuschlaFileHeader, logLineCount);
-    // MEMBER(BuschlaFileHeader, logLineStride);
-    // MEMBER(BuschlaFileHeader, logLinesOffset);
-    // MEMBER(BuschlaFileHeader, textBufferSize);
-    // MEMBER(BuschlaFileHeader, textBufferOffset);
+    // MEMBER(BuschlaFileHeader, sections);
 
     return exitCode;
 }
+#endif
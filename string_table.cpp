@@ -0,0 +1,91 @@
+#include "string_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+#define STRING_TABLE_INITIAL_CAPACITY 256
+
+static uint32_t* _st_find_slot(StringTable* table, StrView str, uint64_t hash) {
+    uint32_t mask = table->slotCapacity - 1;
+    uint32_t index = (uint32_t)hash & mask;
+    while (true) {
+        uint32_t* slot = table->slots + index;
+        if (*slot == 0) {
+            return slot;
+        }
+
+        InternedString* interned = table->strings.items + (*slot - 1);
+        if (interned->hash == hash &&
+            interned->str.len == str.len &&
+            memcmp(interned->str.txt, str.txt, str.len) == 0) {
+            return slot;
+        }
+
+        index = (index + 1) & mask;
+    }
+}
+
+static void _st_grow(StringTable* table) {
+    uint32_t newCapacity = table->slotCapacity == 0 ? STRING_TABLE_INITIAL_CAPACITY : table->slotCapacity * 2;
+
+    free(table->slots);
+    table->slots = (uint32_t*)calloc(newCapacity, sizeof(uint32_t));
+    assert(table->slots != NULL && "Buy more RAM lel");
+    table->slotCapacity = newCapacity;
+
+    // Re-insert all strings.
+    uint32_t mask = newCapacity - 1;
+    for (uint32_t id = 0; id < table->strings.count; ++id) {
+        uint32_t index = (uint32_t)table->strings.items[id].hash & mask;
+        while (table->slots[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        table->slots[index] = id + 1;
+    }
+}
+
+uint32_t st_intern(StringTable* table, StrView str) {
+    // Keep the load factor below 1/2.
+    if ((table->strings.count + 1) * 2 > table->slotCapacity) {
+        _st_grow(table);
+    }
+
+    uint64_t hash = hashBytes(str.txt, str.len);
+    uint32_t* slot = _st_find_slot(table, str, hash);
+    if (*slot != 0) {
+        return *slot - 1;
+    }
+
+    InternedString* interned = da_append_get(&table->strings);
+    interned->str.txt = ca_commit_view(&table->chars, str);
+    interned->str.len = str.len;
+    interned->hash = hash;
+
+    *slot = table->strings.count;
+    return table->strings.count - 1;
+}
+
+uint32_t st_find(StringTable* table, StrView str) {
+    if (table->slotCapacity == 0) {
+        return STRING_TABLE_NOT_FOUND;
+    }
+
+    uint64_t hash = hashBytes(str.txt, str.len);
+    uint32_t* slot = _st_find_slot(table, str, hash);
+    return *slot != 0 ? *slot - 1 : STRING_TABLE_NOT_FOUND;
+}
+
+void st_free(StringTable* table) {
+    for (uint32_t i = 0; i < table->chars.count; ++i) {
+        free(table->chars.items[i].content);
+    }
+    da_free(&table->chars);
+    da_free(&table->strings);
+
+    free(table->slots);
+    table->slots = NULL;
+    table->slotCapacity = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "dynamic_array.h"
+
+// Assigns dense ids (0, 1, 2, ...) to strings, in the order they are first interned.
+// Used to build dictionaries (channels, keys, keywords, ...) while parsing.
+
+#define STRING_TABLE_NOT_FOUND 0xFFFFFFFF
+
+typedef struct {
+    StrView str;
+    uint64_t hash;
+} InternedString;
+
+DEFINE_DYNAMIC_ARRAY(InternedStrings, InternedString)
+
+typedef struct {
+    // Owns the content of all interned strings.
+    Chars chars;
+    // Indexed by id.
+    InternedStrings strings;
+
+    // Open addressing hash table, stores id + 1 (0 marks an empty slot).
+    uint32_t* slots;
+    // Always a power of 2.
+    uint32_t slotCapacity;
+} StringTable;
+
+// Returns the id of the given string, adds it if it was not interned yet.
+uint32_t st_intern(StringTable* table, StrView str);
+
+// Returns the id of the given string or STRING_TABLE_NOT_FOUND.
+uint32_t st_find(StringTable* table, StrView str);
+
+void st_free(StringTable* table);
@@ -0,0 +1,197 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buschla_log.h"
+
+// Tests for buschla-parser, build and run with 'make test'.
+// The parser is included like in bench.cpp, every test returns the number of failed checks.
+
+#define CHECK(condition) { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        ++failures; \
+    } \
+}
+
+static void writeTestFormat(BuschlaLogger* logger, uint32_t id, uint8_t argCount, const uint8_t* argTypes, const char* text)
+{
+    uint32_t length = (uint32_t)strlen(text);
+    _buschla_log_u8(logger, BUSCHLA_LOG_RECORD_FORMAT);
+    _buschla_log_u32(logger, id);
+    _buschla_log_u8(logger, argCount);
+    _buschla_log_bytes(logger, argTypes, argCount);
+    _buschla_log_u32(logger, length);
+    _buschla_log_bytes(logger, text, length);
+}
+
+// Writes an event with the same bits for every argument, STR arguments get "str".
+static void writeTestEvent(BuschlaLogger* logger, uint32_t formatId, uint8_t argCount, const uint8_t* argTypes, uint64_t bits)
+{
+    _buschla_log_u8(logger, BUSCHLA_LOG_RECORD_EVENT);
+    _buschla_log_u32(logger, formatId);
+    _buschla_log_u64(logger, 1);
+    _buschla_log_u64(logger, 1000);
+    for (uint8_t i = 0; i < argCount; ++i) {
+        if (argTypes[i] == BUSCHLA_LOG_ARG_STR) {
+            _buschla_log_u32(logger, 3);
+            _buschla_log_bytes(logger, "str", 3);
+        }
+        else {
+            _buschla_log_u64(logger, bits);
+        }
+    }
+}
+
+// FORMAT records come from the log file, a conversion that doesn't match its argument must not reach snprintf.
+// The events of such formats are skipped, the events around them are kept.
+static int testMalformedBinaryFormats()
+{
+    int failures = 0;
+
+    typedef struct {
+        uint8_t argCount;
+        uint8_t argTypes[2];
+        const char* text;
+    } TestFormat;
+    const TestFormat formats[] = {
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "ok %d" },
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "bad %s" },
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "bad %n" },
+        { 1, { BUSCHLA_LOG_ARG_U64 }, "bad %lln" },
+        { 1, { BUSCHLA_LOG_ARG_F64 }, "bad %Lf" },
+        { 1, { BUSCHLA_LOG_ARG_F64 }, "bad %d" },
+        { 1, { BUSCHLA_LOG_ARG_STR }, "bad %f" },
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "bad %*d" },
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "bad %99999d" },
+        { 1, { BUSCHLA_LOG_ARG_I64 }, "bad %" },
+        { 2, { BUSCHLA_LOG_ARG_I64, BUSCHLA_LOG_ARG_STR }, "bad %d" },
+        { 2, { BUSCHLA_LOG_ARG_STR, BUSCHLA_LOG_ARG_F64 }, "ok %s %.2f" },
+    };
+    const uint32_t formatCount = sizeof(formats) / sizeof(formats[0]);
+
+    BuschlaLogger* logger = (BuschlaLogger*)calloc(1, sizeof(BuschlaLogger));
+    logger->file = tmpfile();
+    assert(logger->file != NULL);
+    _buschla_log_bytes(logger, "BUSCHLB", 7);
+    _buschla_log_u8(logger, BUSCHLA_LOG_VERSION);
+    for (uint32_t i = 0; i < formatCount; ++i) {
+        writeTestFormat(logger, i + 1, formats[i].argCount, formats[i].argTypes, formats[i].text);
+    }
+    double number = 2.5;
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    for (uint32_t i = 0; i < formatCount; ++i) {
+        writeTestEvent(logger, i + 1, formats[i].argCount, formats[i].argTypes, formats[i].argTypes[0] == BUSCHLA_LOG_ARG_I64 ? 7 : bits);
+    }
+    buschla_log_flush(logger);
+    rewind(logger->file);
+
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.frameKey = "frame";
+    parser.frameTimeKey = "time";
+    parser.dialect = DIALECT_BINARY;
+    uint32_t eventCount = 0;
+    CHECK(parseBinaryLog(&parser, logger->file, &eventCount));
+    CHECK(eventCount == formatCount);
+    CHECK(parser.logLines.count == 2);
+    if (parser.logLines.count == 2) {
+        LogLine* first = parser.logLines.items;
+        LogLine* last = parser.logLines.items + 1;
+        CHECK(first->lineNum == 1 && first->str.len == 4 && memcmp(first->str.txt, "ok 7", 4) == 0);
+        CHECK(last->lineNum == formatCount && last->str.len == 11 && memcmp(last->str.txt, "ok str 2.50", 11) == 0);
+    }
+
+    // Without the argument sizes the stream can't be read any further.
+    rewind(logger->file);
+    logger->bufferCount = 0;
+    _buschla_log_bytes(logger, "BUSCHLB", 7);
+    _buschla_log_u8(logger, BUSCHLA_LOG_VERSION);
+    const uint8_t unknownType = 9;
+    writeTestFormat(logger, 1, 1, &unknownType, "bad %d");
+    buschla_log_flush(logger);
+    rewind(logger->file);
+    resetParser(&parser);
+    CHECK(!parseBinaryLog(&parser, logger->file, &eventCount));
+
+    fclose(logger->file);
+    free(logger);
+    return failures;
+}
+
+static bool closeTo(double a, double b)
+{
+    double scale = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return fabs(a - b) <= 1e-9 * (scale > 1.0 ? scale : 1.0);
+}
+
+// Merging the sketches of two parts of a stream gives the sketch of the whole stream.
+static int testValueSketchMerge()
+{
+    int failures = 0;
+
+    ValueSketch first;
+    ValueSketch second;
+    ValueSketch combined;
+    ValueSketch empty;
+    memset(&first, 0, sizeof(ValueSketch));
+    memset(&second, 0, sizeof(ValueSketch));
+    memset(&combined, 0, sizeof(ValueSketch));
+    memset(&empty, 0, sizeof(ValueSketch));
+
+    srand(42);
+    for (uint32_t i = 0; i < 5000; ++i) {
+        // Different ranges for the parts, so the mean shifts and the buckets overlap only partly.
+        double value = i < 3000 ? (rand() % 100000) * 0.01 : (rand() % 1000) * -7.5 + 12.0;
+        vs_add(i < 3000 ? &first : &second, value);
+        vs_add(&combined, value);
+    }
+
+    vs_merge(&empty, &first);
+    vs_merge(&first, &second);
+
+    BuschlaKeyStats mergedStats;
+    BuschlaKeyStats combinedStats;
+    BuschlaBucket* mergedBuckets = (BuschlaBucket*)malloc(first.bucketCount * sizeof(BuschlaBucket));
+    BuschlaBucket* combinedBuckets = (BuschlaBucket*)malloc(combined.bucketCount * sizeof(BuschlaBucket));
+    vs_store(&first, &mergedStats, mergedBuckets, 0);
+    vs_store(&combined, &combinedStats, combinedBuckets, 0);
+
+    CHECK(first.count == combined.count);
+    CHECK(mergedStats.min == combinedStats.min);
+    CHECK(mergedStats.max == combinedStats.max);
+    CHECK(closeTo(first.mean, combined.mean));
+    CHECK(closeTo(first.m2, combined.m2));
+    CHECK(first.bucketCount == combined.bucketCount);
+    if (first.bucketCount == combined.bucketCount) {
+        CHECK(memcmp(mergedBuckets, combinedBuckets, first.bucketCount * sizeof(BuschlaBucket)) == 0);
+    }
+
+    // Merging into an empty sketch copies the other one.
+    CHECK(empty.count == 3000 && empty.bucketCount > 0);
+
+    free(mergedBuckets);
+    free(combinedBuckets);
+    vs_free(&first);
+    vs_free(&second);
+    vs_free(&combined);
+    vs_free(&empty);
+    return failures;
+}
+
+int main()
+{
+    int failures = 0;
+    failures += testMalformedBinaryFormats();
+    failures += testValueSketchMerge();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
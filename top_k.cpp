@@ -0,0 +1,144 @@
+#include "top_k.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void tk_init(TopK* topK, uint32_t capacity) {
+    assert(capacity > 0);
+    memset(topK, 0, sizeof(TopK));
+    topK->capacity = capacity;
+
+    // Keep the load factor below 1/2.
+    topK->slotCapacity = 1;
+    while (topK->slotCapacity < capacity * 2) {
+        topK->slotCapacity *= 2;
+    }
+
+    topK->entries = (TopKEntry*)calloc(capacity, sizeof(TopKEntry));
+    topK->heap = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    topK->heapPositions = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    topK->slots = (uint32_t*)calloc(topK->slotCapacity, sizeof(uint32_t));
+    assert(topK->entries != NULL && topK->heap != NULL && topK->heapPositions != NULL && topK->slots != NULL && "Buy more RAM lel");
+}
+
+static uint32_t* _tk_find_slot(TopK* topK, uint64_t hash) {
+    uint32_t mask = topK->slotCapacity - 1;
+    uint32_t index = (uint32_t)hash & mask;
+    while (topK->slots[index] != 0 && topK->entries[topK->slots[index] - 1].hash != hash) {
+        index = (index + 1) & mask;
+    }
+    return topK->slots + index;
+}
+
+// Backward shift deletion, so lookups never need tombstones.
+static void _tk_remove_slot(TopK* topK, uint32_t* slot) {
+    uint32_t mask = topK->slotCapacity - 1;
+    uint32_t hole = (uint32_t)(slot - topK->slots);
+    uint32_t index = hole;
+    while (true) {
+        index = (index + 1) & mask;
+        if (topK->slots[index] == 0) {
+            break;
+        }
+
+        // Entries whose home slot lies cyclically in (hole, index] have to stay.
+        uint32_t home = (uint32_t)topK->entries[topK->slots[index] - 1].hash & mask;
+        bool stays = hole <= index ? (hole < home && home <= index) : (hole < home || home <= index);
+        if (!stays) {
+            topK->slots[hole] = topK->slots[index];
+            hole = index;
+        }
+    }
+    topK->slots[hole] = 0;
+}
+
+static void _tk_swap_heap(TopK* topK, uint32_t a, uint32_t b) {
+    uint32_t entryA = topK->heap[a];
+    uint32_t entryB = topK->heap[b];
+    topK->heap[a] = entryB;
+    topK->heap[b] = entryA;
+    topK->heapPositions[entryA] = b;
+    topK->heapPositions[entryB] = a;
+}
+
+// Counts only ever grow, so entries only move down.
+static void _tk_sift_down(TopK* topK, uint32_t position) {
+    while (true) {
+        uint32_t smallest = position;
+        uint32_t left = position * 2 + 1;
+        uint32_t right = left + 1;
+        if (left < topK->entryCount && topK->entries[topK->heap[left]].count < topK->entries[topK->heap[smallest]].count) {
+            smallest = left;
+        }
+        if (right < topK->entryCount && topK->entries[topK->heap[right]].count < topK->entries[topK->heap[smallest]].count) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            return;
+        }
+        _tk_swap_heap(topK, position, smallest);
+        position = smallest;
+    }
+}
+
+void tk_add(TopK* topK, uint64_t hash, uint32_t line) {
+    uint32_t* slot = _tk_find_slot(topK, hash);
+    if (*slot != 0) {
+        uint32_t entryIndex = *slot - 1;
+        TopKEntry* entry = topK->entries + entryIndex;
+        ++entry->count;
+        entry->lastLine = line;
+        _tk_sift_down(topK, topK->heapPositions[entryIndex]);
+        return;
+    }
+
+    if (topK->entryCount < topK->capacity) {
+        // New entries start with a count of 1, which is never more than any other count.
+        uint32_t entryIndex = topK->entryCount++;
+        TopKEntry* entry = topK->entries + entryIndex;
+        entry->hash = hash;
+        entry->count = 1;
+        entry->error = 0;
+        entry->firstLine = line;
+        entry->lastLine = line;
+
+        // Append at the end of the heap and move up in front of larger counts.
+        uint32_t position = entryIndex;
+        topK->heap[position] = entryIndex;
+        topK->heapPositions[entryIndex] = position;
+        while (position > 0) {
+            uint32_t parent = (position - 1) / 2;
+            if (topK->entries[topK->heap[parent]].count <= entry->count) {
+                break;
+            }
+            _tk_swap_heap(topK, position, parent);
+            position = parent;
+        }
+
+        *slot = entryIndex + 1;
+        return;
+    }
+
+    // Take over the entry with the smallest count.
+    uint32_t entryIndex = topK->heap[0];
+    TopKEntry* entry = topK->entries + entryIndex;
+    _tk_remove_slot(topK, _tk_find_slot(topK, entry->hash));
+
+    entry->hash = hash;
+    entry->error = entry->count;
+    ++entry->count;
+    entry->firstLine = line;
+    entry->lastLine = line;
+    _tk_sift_down(topK, 0);
+
+    *_tk_find_slot(topK, hash) = entryIndex + 1;
+}
+
+void tk_free(TopK* topK) {
+    free(topK->entries);
+    free(topK->heap);
+    free(topK->heapPositions);
+    free(topK->slots);
+    memset(topK, 0, sizeof(TopK));
+}
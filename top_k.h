@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+// Finds the most frequent items of a stream in O(capacity) memory (Space-Saving, Metwally et al.).
+// Items are identified by a 64-bit hash.
+// When all entries are taken, a new item replaces the entry with the smallest count and inherits
+// that count as its error, so count overestimates the real frequency by at most error.
+// Every item that makes up more than 1/capacity of the stream is guaranteed to have an entry.
+
+typedef struct {
+    uint64_t hash;
+    uint32_t count;
+    uint32_t error;
+    // Lines of the first and last occurrence since the item got its entry.
+    uint32_t firstLine;
+    uint32_t lastLine;
+} TopKEntry;
+
+typedef struct {
+    uint32_t capacity;
+    TopKEntry* entries;
+    uint32_t entryCount;
+
+    // Min-heap of entry indices by count, heapPositions is indexed by entry.
+    uint32_t* heap;
+    uint32_t* heapPositions;
+
+    // Open addressing hash table, stores entry index + 1 (0 marks an empty slot).
+    uint32_t* slots;
+    // Always a power of 2.
+    uint32_t slotCapacity;
+} TopK;
+
+void tk_init(TopK* topK, uint32_t capacity);
+
+void tk_add(TopK* topK, uint64_t hash, uint32_t line);
+
+void tk_free(TopK* topK);
@@ -6,10 +6,14 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -282,6 +286,129 @@ void hexdump(FILE* stream, void* memory, size_t size, size_t itemSize) {
     putc('\n', stream);
 }
 
+static inline uint64_t _hash_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+
+    // Consume 8 bytes at a time, the tail is padded with zeros.
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = _hash_mix(h ^ word) + 0x9e3779b97f4a7c15ULL;
+        p += 8;
+        size -= 8;
+    }
+
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, p, size);
+        h = _hash_mix(h ^ word) + 0x9e3779b97f4a7c15ULL;
+    }
+
+    return _hash_mix(h);
+}
+
+const char* findBytes(const char* haystack, size_t haystackSize, const char* needle, size_t needleSize) {
+    if (needleSize == 0) {
+        return haystack;
+    }
+#ifdef LINUX
+    return (const char*)memmem(haystack, haystackSize, needle, needleSize);
+#else
+    const char* end = haystack + haystackSize;
+    const char* p = haystack;
+    while (end - p >= (ptrdiff_t)needleSize) {
+        p = (const char*)memchr(p, needle[0], end - p - needleSize + 1);
+        if (p == NULL) {
+            return NULL;
+        }
+        if (memcmp(p, needle, needleSize) == 0) {
+            return p;
+        }
+        ++p;
+    }
+    return NULL;
+#endif
+}
+
+#ifdef WINDOWS
+const void* mapFile(const char* path, size_t* sizeOut) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "CreateFile(%s) failed: %lu\n", path, GetLastError());
+        return NULL;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        fprintf(stderr, "%s is empty\n", path);
+        CloseHandle(file);
+        return NULL;
+    }
+
+    // The view keeps the mapping (and the file) open.
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        fprintf(stderr, "CreateFileMapping(%s) failed: %lu\n", path, GetLastError());
+        return NULL;
+    }
+    const void* memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (memory == NULL) {
+        fprintf(stderr, "MapViewOfFile(%s) failed: %lu\n", path, GetLastError());
+        return NULL;
+    }
+
+    *sizeOut = (size_t)size.QuadPart;
+    return memory;
+}
+
+void unmapFile(const void* memory, size_t size) {
+    (void)size;
+    UnmapViewOfFile(memory);
+}
+#else
+const void* mapFile(const char* path, size_t* sizeOut) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "open(%s): %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s is empty or cannot be read\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    // The mapping stays valid after closing the descriptor.
+    void* memory = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "mmap(%s): %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    *sizeOut = (size_t)st.st_size;
+    return memory;
+}
+
+void unmapFile(const void* memory, size_t size) {
+    munmap((void*)memory, size);
+}
+#endif
+
 #define TIMER_CLOCK_ID CLOCK_MONOTONIC_RAW
 #define NANOS_PER_SEC 1000000000
 // The maximum time span representable is 584 years.
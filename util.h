@@ -55,6 +55,18 @@ char* splitAtLastOccurence(char* src, char c);
 
 void hexdump(FILE* stream, void* memory, size_t size, size_t itemSize = 0);
 
+// Non-cryptographic 64-bit hash, good enough for hash tables and fingerprints.
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Returns pointer to the first occurence of needle in haystack, NULL if there is none.
+// memmem on Linux.
+const char* findBytes(const char* haystack, size_t haystackSize, const char* needle, size_t needleSize);
+
+// Maps a whole file read-only into memory, the pages are shared with every other process mapping it.
+// Returns NULL on error (also for empty files), sizeOut receives the file size.
+const void* mapFile(const char* path, size_t* sizeOut);
+void unmapFile(const void* memory, size_t size);
+
 typedef struct {
     uint64_t begin;
     uint64_t end;
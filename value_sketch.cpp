@@ -0,0 +1,143 @@
+#include "value_sketch.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VALUE_SKETCH_INITIAL_CAPACITY 64
+
+static uint32_t _vs_hash(uint32_t bucket) {
+    return bucket * 2654435761u;
+}
+
+static void _vs_grow(ValueSketch* sketch) {
+    uint32_t newCapacity = sketch->bucketCapacity == 0 ? VALUE_SKETCH_INITIAL_CAPACITY : sketch->bucketCapacity * 2;
+    uint32_t* newKeys = (uint32_t*)calloc(newCapacity, sizeof(uint32_t));
+    uint32_t* newCounts = (uint32_t*)calloc(newCapacity, sizeof(uint32_t));
+    assert(newKeys != NULL && newCounts != NULL && "Buy more RAM lel");
+
+    // Re-insert all buckets.
+    uint32_t mask = newCapacity - 1;
+    for (uint32_t i = 0; i < sketch->bucketCapacity; ++i) {
+        if (sketch->bucketKeys[i] == 0) {
+            continue;
+        }
+        uint32_t index = _vs_hash(sketch->bucketKeys[i]) & mask;
+        while (newKeys[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        newKeys[index] = sketch->bucketKeys[i];
+        newCounts[index] = sketch->bucketCounts[i];
+    }
+
+    free(sketch->bucketKeys);
+    free(sketch->bucketCounts);
+    sketch->bucketKeys = newKeys;
+    sketch->bucketCounts = newCounts;
+    sketch->bucketCapacity = newCapacity;
+}
+
+static void _vs_add_bucket(ValueSketch* sketch, uint32_t bucket, uint32_t count) {
+    // Keep the load factor below 1/2.
+    if ((sketch->bucketCount + 1) * 2 > sketch->bucketCapacity) {
+        _vs_grow(sketch);
+    }
+
+    uint32_t key = bucket + 1;
+    uint32_t mask = sketch->bucketCapacity - 1;
+    uint32_t index = _vs_hash(key) & mask;
+    while (sketch->bucketKeys[index] != 0 && sketch->bucketKeys[index] != key) {
+        index = (index + 1) & mask;
+    }
+
+    if (sketch->bucketKeys[index] == 0) {
+        sketch->bucketKeys[index] = key;
+        ++sketch->bucketCount;
+    }
+    sketch->bucketCounts[index] += count;
+}
+
+void vs_add(ValueSketch* sketch, double value) {
+    if (value != value) {
+        return;
+    }
+
+    if (sketch->count == 0) {
+        sketch->min = value;
+        sketch->max = value;
+    }
+    else {
+        sketch->min = value < sketch->min ? value : sketch->min;
+        sketch->max = value > sketch->max ? value : sketch->max;
+    }
+
+    ++sketch->count;
+    double delta = value - sketch->mean;
+    sketch->mean += delta / sketch->count;
+    sketch->m2 += delta * (value - sketch->mean);
+
+    _vs_add_bucket(sketch, buschlaBucketOf(value), 1);
+}
+
+void vs_merge(ValueSketch* sketch, const ValueSketch* other) {
+    if (other->count == 0) {
+        return;
+    }
+
+    if (sketch->count == 0) {
+        sketch->min = other->min;
+        sketch->max = other->max;
+        sketch->mean = other->mean;
+        sketch->m2 = other->m2;
+    }
+    else {
+        // Chan et al., combines two partial Welford sums.
+        double count = (double)sketch->count + (double)other->count;
+        double delta = other->mean - sketch->mean;
+        sketch->min = other->min < sketch->min ? other->min : sketch->min;
+        sketch->max = other->max > sketch->max ? other->max : sketch->max;
+        sketch->mean += delta * other->count / count;
+        sketch->m2 += other->m2 + delta * delta * sketch->count * other->count / count;
+    }
+    sketch->count += other->count;
+
+    for (uint32_t i = 0; i < other->bucketCapacity; ++i) {
+        if (other->bucketKeys[i] != 0) {
+            _vs_add_bucket(sketch, other->bucketKeys[i] - 1, other->bucketCounts[i]);
+        }
+    }
+}
+
+static int _vs_compare_buckets(const void* a, const void* b) {
+    uint32_t bucketA = ((const BuschlaBucket*)a)->bucket;
+    uint32_t bucketB = ((const BuschlaBucket*)b)->bucket;
+    return bucketA < bucketB ? -1 : bucketA > bucketB ? 1 : 0;
+}
+
+void vs_store(const ValueSketch* sketch, BuschlaKeyStats* statsOut, BuschlaBucket* bucketsOut, uint32_t firstBucket) {
+    statsOut->min = sketch->min;
+    statsOut->max = sketch->max;
+    statsOut->mean = sketch->mean;
+    statsOut->m2 = sketch->m2;
+    statsOut->count = sketch->count;
+    statsOut->buckets.first = firstBucket;
+    statsOut->buckets.count = sketch->bucketCount;
+
+    BuschlaBucket* buckets = bucketsOut + firstBucket;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < sketch->bucketCapacity; ++i) {
+        if (sketch->bucketKeys[i] != 0) {
+            buckets[count].bucket = sketch->bucketKeys[i] - 1;
+            buckets[count].count = sketch->bucketCounts[i];
+            ++count;
+        }
+    }
+    assert(count == sketch->bucketCount);
+    qsort(buckets, count, sizeof(BuschlaBucket), _vs_compare_buckets);
+}
+
+void vs_free(ValueSketch* sketch) {
+    free(sketch->bucketKeys);
+    free(sketch->bucketCounts);
+    memset(sketch, 0, sizeof(ValueSketch));
+}
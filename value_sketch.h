@@ -0,0 +1,39 @@
+#pragma once
+
+#include "buschla_file.h"
+#include "dynamic_array.h"
+
+// Running statistics and a log-bucketed histogram (see buschlaBucketOf) of a stream of values.
+// Sketches of different parts of a log can be merged and give the same result as a single sketch
+// over all values, so parse chunks or multiple files can be combined without the raw samples.
+
+typedef struct {
+    uint32_t count;
+    double min;
+    double max;
+    double mean;
+    // Sum of squared differences from the mean (Welford).
+    double m2;
+
+    // Open addressing hash table of the non-empty buckets.
+    // bucketKeys stores bucket + 1 (0 marks an empty slot).
+    uint32_t* bucketKeys;
+    uint32_t* bucketCounts;
+    // Always a power of 2.
+    uint32_t bucketCapacity;
+    uint32_t bucketCount;
+} ValueSketch;
+
+DEFINE_DYNAMIC_ARRAY(ValueSketches, ValueSketch)
+
+// NaNs are ignored.
+void vs_add(ValueSketch* sketch, double value);
+
+// Adds all values of other, the result matches a single sketch over both streams (up to rounding).
+void vs_merge(ValueSketch* sketch, const ValueSketch* other);
+
+// Writes the statistics to statsOut and the non-empty buckets to bucketsOut[firstBucket..], sorted by bucket.
+// bucketsOut needs room for sketch->bucketCount more entries.
+void vs_store(const ValueSketch* sketch, BuschlaKeyStats* statsOut, BuschlaBucket* bucketsOut, uint32_t firstBucket);
+
+void vs_free(ValueSketch* sketch);